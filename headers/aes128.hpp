@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <gsl/gsl>
+
+using Aes128Key = std::array<uint8_t, 16>;
+using Aes128Block = std::array<uint8_t, 16>;
+
+//
+// FIPS-197's AES-128, to encrypt the packages and files PkgWriter writes
+//
+// Only encryption is done here, decrypting them is left to libuncso2
+//
+class Aes128
+{
+public:
+    static constexpr const std::size_t BLOCK_SIZE = 16;
+
+    Aes128( const Aes128Key& key ) noexcept;
+    ~Aes128() = default;
+
+public:
+    void EncryptBlock( uint8_t* pBlock ) const noexcept;
+    // in place, the data's size must be a multiple of the block size
+    void EncryptCbc( gsl::span<uint8_t> data,
+                     const Aes128Block& iv = {} ) const noexcept;
+
+    // the size data must be padded to for it to be encrypted
+    static inline uint64_t GetPaddedSize( uint64_t iSize ) noexcept;
+
+private:
+    static constexpr const std::size_t ROUNDS_NUM = 10;
+
+    std::array<uint8_t, BLOCK_SIZE * ( ROUNDS_NUM + 1 )> m_RoundKeys;
+};
+
+inline uint64_t Aes128::GetPaddedSize( uint64_t iSize ) noexcept
+{
+    return ( iSize + BLOCK_SIZE - 1 ) / BLOCK_SIZE * BLOCK_SIZE;
+}
@@ -1,21 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
 
-#include <QCoreApplication>
-#include <QModelIndex>
-#include <QVariant>
-
 namespace fs = std::filesystem;
 
 class ArchiveDirectoryNode;
 
 class ArchiveBaseNode
 {
-    Q_DECLARE_TR_FUNCTIONS( ArchiveBaseNode )
-
 public:
     ArchiveBaseNode( const fs::path& itemPath,
                      ArchiveDirectoryNode* pParentNode = nullptr );
@@ -24,7 +19,6 @@ public:
     ArchiveDirectoryNode* GetParentNode() const;
     void SetParentNode( ArchiveDirectoryNode* pNewParent );
 
-    virtual QVariant GetData( int column ) = 0;
     int GetRow() const;
 
     inline const fs::path& GetPath() const;
@@ -49,8 +43,3 @@ inline size_t ArchiveBaseNode::GetPathHash() const
 {
     return this->m_iPathHash;
 }
-
-inline ArchiveBaseNode* IndexToGenericNode( const QModelIndex& index )
-{
-    return static_cast<ArchiveBaseNode*>( index.internalPointer() );
-}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "archivebasenode.hpp"
+#include "pkgfilesystemshared.hpp"
+#include "pkgownerset.hpp"
 
-#include <set>
+#include <algorithm>
 #include <vector>
 
 class ArchiveDirectoryNode : public ArchiveBaseNode
@@ -25,7 +27,6 @@ public:
     ArchiveBaseNode* GetChildContaining( const fs::path& path ) const;
     int GetLocationOf( const ArchiveBaseNode* pChild ) const;
 
-    virtual QVariant GetData( int column ) override;
     int GetRow() const;
 
     virtual uint64_t GetDecryptedSize() const override;
@@ -34,11 +35,14 @@ public:
 
     inline bool HasFileChild() const;
 
-private:
-    std::set<std::string_view> GetChildrenPkgOwners() const;
+    void AddOwnerPkg( PkgFileId pkgId );
+    inline const PkgOwnerSet& GetOwnerPkgs() const;
 
 private:
     std::vector<ArchiveBaseNode*> m_vChildNodes;
+
+    // the owners of every file node below this directory
+    PkgOwnerSet m_OwnerPkgs;
 };
 
 template <typename CompareType>
@@ -61,21 +65,15 @@ inline bool ArchiveDirectoryNode::HasFileChild() const
     return false;
 }
 
-inline ArchiveDirectoryNode* BaseToDirectoryNode( ArchiveBaseNode* baseNode )
+inline const PkgOwnerSet& ArchiveDirectoryNode::GetOwnerPkgs() const
 {
-    if ( baseNode == nullptr || baseNode->IsDirectory() == false )
-        return nullptr;
-
-    return static_cast<ArchiveDirectoryNode*>( baseNode );
+    return this->m_OwnerPkgs;
 }
 
-inline ArchiveDirectoryNode* IndexToDirectoryNode( const QModelIndex& index )
+inline ArchiveDirectoryNode* BaseToDirectoryNode( ArchiveBaseNode* baseNode )
 {
-    ArchiveBaseNode* pNode =
-        static_cast<ArchiveBaseNode*>( index.internalPointer() );
-
-    if ( pNode == nullptr || pNode->IsDirectory() == false )
+    if ( baseNode == nullptr || baseNode->IsDirectory() == false )
         return nullptr;
 
-    return static_cast<ArchiveDirectoryNode*>( pNode );
+    return static_cast<ArchiveDirectoryNode*>( baseNode );
 }
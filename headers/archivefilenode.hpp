@@ -1,64 +1,86 @@
 #pragma once
 
+#include <cstdint>
 #include <string_view>
 
 #include "archivebasenode.hpp"
-
-namespace uc2
-{
-class PkgEntry;
-}  // namespace uc2
+#include "pkgfilesystemshared.hpp"
 
 class ArchiveDirectoryNode;
+class EntryFlagDetection;
+
+struct PkgEntryMetadata;
 
 class ArchiveFileNode : public ArchiveBaseNode
 {
 public:
-    ArchiveFileNode( const fs::path& ownerPkgPath, uc2::PkgEntry* pPkgEntry,
+    ArchiveFileNode( const fs::path& ownerPkgPath, PkgFileId ownerPkgId,
+                     std::size_t iEntryIndex, const PkgEntryMetadata& entry,
                      ArchiveDirectoryNode* pParentNode = nullptr );
     virtual ~ArchiveFileNode();
 
-    virtual QVariant GetData( int column ) override;
-
     virtual uint64_t GetDecryptedSize() const override;
 
     std::string_view GetOwnerPkgFilename() const;
+    inline PkgFileId GetOwnerPkgId() const;
 
     virtual bool IsDirectory() const override;
 
-    inline uc2::PkgEntry* GetPkgEntry() const;
+    // the entry's index in its owner's entries, once the owner is parsed
+    inline std::size_t GetEntryIndex() const;
 
-private:
-    QString GetFileTypeColumnString() const;
+    void SetEntryFlags( const EntryFlagDetection& detection );
+    inline std::uint8_t GetEntryFlags() const;
+    inline bool AreEntryFlagsDetected() const;
+    inline bool IsEncryptedFile() const;
+    inline bool IsLzmaTexture() const;
 
 private:
     std::string m_szOwnerPkgFilename;
+    PkgFileId m_iOwnerPkgId;
 
-    uc2::PkgEntry* m_pPkgEntry;
+    std::size_t m_iEntryIndex;
 
     uint64_t m_iDecryptedSize;
+
+    // a mask of EntryFlagsEnum
+    std::uint8_t m_iEntryFlags;
 };
 
-inline uc2::PkgEntry* ArchiveFileNode::GetPkgEntry() const
+inline PkgFileId ArchiveFileNode::GetOwnerPkgId() const
 {
-    return this->m_pPkgEntry;
+    return this->m_iOwnerPkgId;
 }
 
-inline ArchiveFileNode* BaseToFileNode( ArchiveBaseNode* baseNode )
+inline std::size_t ArchiveFileNode::GetEntryIndex() const
 {
-    if ( baseNode == nullptr || baseNode->IsDirectory() == true )
-        return nullptr;
+    return this->m_iEntryIndex;
+}
 
-    return static_cast<ArchiveFileNode*>( baseNode );
+inline std::uint8_t ArchiveFileNode::GetEntryFlags() const
+{
+    return this->m_iEntryFlags;
 }
 
-inline ArchiveFileNode* IndexToFileNode( const QModelIndex& index )
+inline bool ArchiveFileNode::AreEntryFlagsDetected() const
 {
-    ArchiveBaseNode* pNode =
-        static_cast<ArchiveBaseNode*>( index.internalPointer() );
+    return ( this->m_iEntryFlags & EF_Detected ) != 0;
+}
+
+inline bool ArchiveFileNode::IsEncryptedFile() const
+{
+    return ( this->m_iEntryFlags & EF_EncryptedFile ) != 0;
+}
 
-    if ( pNode->IsDirectory() == true )
+inline bool ArchiveFileNode::IsLzmaTexture() const
+{
+    return ( this->m_iEntryFlags & EF_LzmaTexture ) != 0;
+}
+
+inline ArchiveFileNode* BaseToFileNode( ArchiveBaseNode* baseNode )
+{
+    if ( baseNode == nullptr || baseNode->IsDirectory() == true )
         return nullptr;
 
-    return static_cast<ArchiveFileNode*>( pNode );
+    return static_cast<ArchiveFileNode*>( baseNode );
 }
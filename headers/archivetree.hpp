@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "archivedirectorynode.hpp"
+#include "cancellationtoken.hpp"
+#include "fileproperties.hpp"
+#include "gamedatainfo.hpp"
+#include "loadedpkgfiles.hpp"
+#include "pkgfilesystemshared.hpp"
+
+namespace fs = std::filesystem;
+
+class ArchiveBaseNode;
+class ArchiveFileNode;
+class IndexMetadataCache;
+
+struct PkgEntryMetadata;
+
+//
+// The loaded packages and the tree of their files, without anything about
+// how they're shown, so PkgFileModel and the command line tool share it
+//
+class ArchiveTree
+{
+public:
+    using DirectoryNodeMap =
+        std::unordered_map<std::string, ArchiveDirectoryNode*>;
+
+    ArchiveTree();
+    ~ArchiveTree();
+
+public:
+    bool LoadPackage( const fs::path& pkgPath, GameProvider provider,
+                      bool bIndependentLoad = true,
+                      IndexMetadataCache* pMetadataCache = nullptr );
+    // the metadata of the index's packages is cached in metadataCacheDir,
+    // unless it's empty. The tree must be cleared if it fails
+    bool LoadIndex( const fs::path& indexPath, GameProvider provider,
+                    const fs::path& metadataCacheDir,
+                    std::atomic<int>& outLoadProgress,
+                    std::atomic<int>& outPkgNum,
+                    const CancellationToken& cancelToken );
+
+    void Clear();
+
+    // the path starts at the root, nullptr if there's no such node
+    ArchiveBaseNode* FindNode( std::string_view nodePath );
+
+    inline ArchiveDirectoryNode* GetRootNode() noexcept;
+    inline const ArchiveDirectoryNode* GetRootNode() const noexcept;
+    inline const DirectoryNodeMap& GetDirectoryNodes() const noexcept;
+
+    inline const LoadedPkgFiles& GetLoadedPkgFiles() const noexcept;
+    inline const FileProperties& GetFileProperties() const noexcept;
+    inline const fs::path& GetParentPath() const noexcept;
+
+    inline void SetEntryFlagDetection( bool bEnabled ) noexcept;
+
+    inline const std::string& GetError() const noexcept;
+    inline bool IsIndexLoaded() const noexcept;
+
+private:
+    // a package whose entry types are detected once the index is loaded
+    struct PendingDetection;
+
+    // the entry types are detected later if pvPendingDetections is set
+    bool LoadPackageInternal(
+        const fs::path& pkgPath, GameProvider provider, bool bIndependentLoad,
+        IndexMetadataCache* pMetadataCache,
+        std::vector<PendingDetection>* pvPendingDetections );
+    void DetectPendingEntryFlags(
+        std::vector<PendingDetection>& vPendingDetections,
+        const CancellationToken& cancelToken );
+
+    std::vector<ArchiveFileNode*> CreateChildren(
+        const std::vector<PkgEntryMetadata>& vEntries,
+        const fs::path& pkgPath, PkgFileId pkgId );
+
+private:
+    DirectoryNodeMap m_DirectoryNodes;
+    LoadedPkgFiles m_PkgFiles;
+
+    ArchiveDirectoryNode m_RootNode;
+
+    fs::path m_ParentPath;
+    FileProperties m_FileProps;
+
+    std::string m_szLastError;
+
+    bool m_bIsIndexLoaded;
+    bool m_bDetectEntryFlags;
+
+private:
+    ArchiveTree& operator=( const ArchiveTree& ) = delete;
+    ArchiveTree( const ArchiveTree& ) = delete;
+};
+
+inline ArchiveDirectoryNode* ArchiveTree::GetRootNode() noexcept
+{
+    return &this->m_RootNode;
+}
+
+inline const ArchiveDirectoryNode* ArchiveTree::GetRootNode() const noexcept
+{
+    return &this->m_RootNode;
+}
+
+inline const ArchiveTree::DirectoryNodeMap& ArchiveTree::GetDirectoryNodes()
+    const noexcept
+{
+    return this->m_DirectoryNodes;
+}
+
+inline const LoadedPkgFiles& ArchiveTree::GetLoadedPkgFiles() const noexcept
+{
+    return this->m_PkgFiles;
+}
+
+inline const FileProperties& ArchiveTree::GetFileProperties() const noexcept
+{
+    return this->m_FileProps;
+}
+
+inline const fs::path& ArchiveTree::GetParentPath() const noexcept
+{
+    return this->m_ParentPath;
+}
+
+inline void ArchiveTree::SetEntryFlagDetection( bool bEnabled ) noexcept
+{
+    this->m_bDetectEntryFlags = bEnabled;
+}
+
+inline const std::string& ArchiveTree::GetError() const noexcept
+{
+    return this->m_szLastError;
+}
+
+inline bool ArchiveTree::IsIndexLoaded() const noexcept
+{
+    return this->m_bIsIndexLoaded;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include <QMetaType>
+#include <QObject>
+
+#include "cancellationtoken.hpp"
+#include "extractionstats.hpp"
+
+// sent across threads by throughputChanged
+Q_DECLARE_METATYPE( ThroughputSample )
+
+//
+// Runs a job in a worker thread, telling the thread that started it when
+// it's done with completed, so that thread never waits for the job
+//
+// The job reports its progress through atomic counters. A reporter thread
+// next to the job sends them with progressChanged and maxProgressChanged
+// when they change, at most about the display's rate, and the signals are
+// queued to the calling thread, which doesn't have to poll them
+//
+// Jobs that fill in GetStats get a progress weighted by their bytes instead,
+// and their throughput sent with throughputChanged
+//
+class BackgroundJob : public QObject
+{
+    Q_OBJECT
+public:
+    using job_t = std::function<bool( BackgroundJob& job )>;
+
+    BackgroundJob( job_t job );
+    ~BackgroundJob();
+
+public:
+    void Start();
+
+    inline bool IsRunning() const noexcept;
+
+    // these may be written by the job from any thread
+    inline std::atomic<int>& GetProgress() noexcept;
+    inline std::atomic<int>& GetMaxProgress() noexcept;
+    inline ExtractionStats& GetStats() noexcept;
+
+    inline const CancellationToken& GetCancelToken() const noexcept;
+    inline bool WasCancelled() const noexcept;
+
+public slots:
+    void Cancel();
+
+signals:
+    void progressChanged( int iProgress );
+    void maxProgressChanged( int iMaxProgress );
+    void throughputChanged( const ThroughputSample& sample );
+
+    // emitted in the starting thread once the job returns
+    void completed( bool bSucceeded );
+
+    // emitted from the worker thread once the job returns
+    void finished();
+
+private slots:
+    void OnFinished();
+
+private:
+    void RunInWorker() noexcept;
+    void RunReporter();
+    // the throughput is always sent by the last report
+    void ReportProgress( bool bLastReport );
+
+private:
+    job_t m_Job;
+
+    std::atomic<int> m_iProgress;
+    std::atomic<int> m_iMaxProgress;
+
+    ExtractionStats m_Stats;
+
+    // only used by the thread reporting the progress
+    ThroughputMeter m_ThroughputMeter;
+    int m_iReportsNum;
+    // the last values sent to the calling thread
+    int m_iReportedProgress;
+    int m_iReportedMaxProgress;
+
+    // wakes up the reporter once the job returns
+    std::mutex m_ReporterLock;
+    std::condition_variable m_ReporterCond;
+    bool m_bJobReturned;
+
+    std::atomic<bool> m_bResult;
+    bool m_bRunning;
+
+    CancellationToken m_CancelToken;
+
+    friend class BackgroundJobRunnable;
+};
+
+inline std::atomic<int>& BackgroundJob::GetProgress() noexcept
+{
+    return this->m_iProgress;
+}
+
+inline std::atomic<int>& BackgroundJob::GetMaxProgress() noexcept
+{
+    return this->m_iMaxProgress;
+}
+
+inline ExtractionStats& BackgroundJob::GetStats() noexcept
+{
+    return this->m_Stats;
+}
+
+inline bool BackgroundJob::IsRunning() const noexcept
+{
+    return this->m_bRunning;
+}
+
+inline const CancellationToken& BackgroundJob::GetCancelToken() const noexcept
+{
+    return this->m_CancelToken;
+}
+
+inline bool BackgroundJob::WasCancelled() const noexcept
+{
+    return this->m_CancelToken.IsCancelled();
+}
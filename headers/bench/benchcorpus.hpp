@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "archivetree.hpp"
+#include "gamedatainfo.hpp"
+
+namespace fs = std::filesystem;
+
+class ArchiveBaseNode;
+class ArchiveFileNode;
+
+enum BenchSizeClassEnum
+{
+    // generated corpora mix every size, mostly small ones
+    BSC_All = 0,
+    // up to 64 KiB
+    BSC_Small,
+    // up to 1 MiB
+    BSC_Medium,
+    // generated up to 4 MiB
+    BSC_Large,
+    BSC_Count
+};
+
+//
+// The packages the benchmarks run on, with their data read into memory so
+// the benchmarks measure the work and not the disk
+//
+// Entries are decrypted in place, so a package must be prepared again before
+// its entries are decrypted again
+//
+class BenchCorpus
+{
+public:
+    struct CorpusEntry
+    {
+        PkgFileId iPkgId;
+        std::size_t iEntryIndex;
+        uint64_t iDecryptedSize;
+    };
+
+    // an entry's data after the package's decryption
+    struct SpecialFile
+    {
+        std::string szFilename;
+        std::vector<uint8_t> vData;
+    };
+
+public:
+    BenchCorpus();
+    ~BenchCorpus() = default;
+
+public:
+    // an index only has its first iMaxPkgFilesNum packages loaded
+    bool Load( const fs::path& archivePath, GameProvider provider,
+               std::size_t iMaxPkgFilesNum );
+    // writes an archive of iEntriesNum files sized by sizeDist in workDir
+    // with PkgWriter, then loads it
+    bool Generate( const fs::path& workDir, GameProvider provider,
+                   std::size_t iEntriesNum, BenchSizeClassEnum sizeDist );
+
+    // restores the package's data and parses it again, so its entries can
+    // be decrypted
+    bool PreparePkgFile( PkgFileId iPkgId );
+    // only restores the header, for it to be decrypted and parsed again
+    void ResetPkgFileHeader( PkgFileId iPkgId );
+    void ReleasePkgFileData( PkgFileId iPkgId );
+    inline uint64_t GetPkgFileHeaderSize( PkgFileId iPkgId ) const;
+
+    static const char* GetSizeClassName( BenchSizeClassEnum sizeClass );
+    // in package and entry order, so they're read from memory in sequence
+    std::vector<CorpusEntry> GetEntries( BenchSizeClassEnum sizeClass,
+                                         std::size_t iMaxEntriesNum ) const;
+
+    inline ArchiveTree& GetTree() noexcept;
+    inline const std::vector<fs::path>& GetPkgFilePaths() const noexcept;
+    inline GameProvider GetProvider() const noexcept;
+    std::vector<ArchiveBaseNode*> GetFileNodes() const;
+
+    inline const std::vector<SpecialFile>& GetEncryptedFiles() const noexcept;
+    inline const std::vector<SpecialFile>& GetLzmaTextures() const noexcept;
+
+    inline const std::string& GetError() const noexcept;
+
+private:
+    bool ReadSpecialFiles();
+    void CollectFileNodes( ArchiveBaseNode* pNode );
+
+private:
+    ArchiveTree m_Tree;
+    GameProvider m_Provider;
+
+    std::vector<fs::path> m_vPkgFilePaths;
+    // indexed by PkgFileId, the data as it's on the disk
+    std::vector<std::vector<uint8_t>> m_vPristinePkgData;
+    // the buffers the packages decrypt in
+    std::vector<std::vector<uint8_t>> m_vWorkPkgData;
+    std::vector<uint64_t> m_vHeaderSizes;
+
+    std::vector<ArchiveFileNode*> m_vFileNodes;
+
+    std::vector<SpecialFile> m_vEncryptedFiles;
+    std::vector<SpecialFile> m_vLzmaTextures;
+
+    std::string m_szLastError;
+
+private:
+    BenchCorpus& operator=( const BenchCorpus& ) = delete;
+    BenchCorpus( const BenchCorpus& ) = delete;
+};
+
+inline ArchiveTree& BenchCorpus::GetTree() noexcept
+{
+    return this->m_Tree;
+}
+
+inline const std::vector<fs::path>& BenchCorpus::GetPkgFilePaths() const
+    noexcept
+{
+    return this->m_vPkgFilePaths;
+}
+
+inline GameProvider BenchCorpus::GetProvider() const noexcept
+{
+    return this->m_Provider;
+}
+
+inline uint64_t BenchCorpus::GetPkgFileHeaderSize( PkgFileId iPkgId ) const
+{
+    return this->m_vHeaderSizes.at( iPkgId );
+}
+
+inline const std::vector<BenchCorpus::SpecialFile>&
+BenchCorpus::GetEncryptedFiles() const noexcept
+{
+    return this->m_vEncryptedFiles;
+}
+
+inline const std::vector<BenchCorpus::SpecialFile>&
+BenchCorpus::GetLzmaTextures() const noexcept
+{
+    return this->m_vLzmaTextures;
+}
+
+inline const std::string& BenchCorpus::GetError() const noexcept
+{
+    return this->m_szLastError;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gsl/gsl>
+
+//
+// Helpers for the small binary files we keep next to the user's data,
+// like the index metadata cache or the extraction manifests
+//
+// These files are only read back on the machine that wrote them, so values
+// are written in the host's byte order
+//
+class BinaryBufferWriter
+{
+public:
+    BinaryBufferWriter( std::vector<uint8_t>& vOutBuffer )
+        : m_vOutBuffer( vOutBuffer )
+    {
+    }
+
+    template <typename T>
+    void Write( T value )
+    {
+        static_assert( std::is_trivially_copyable_v<T> == true );
+
+        const std::size_t iOffset = this->m_vOutBuffer.size();
+        this->m_vOutBuffer.resize( iOffset + sizeof( T ) );
+        std::memcpy( &this->m_vOutBuffer[iOffset], &value, sizeof( T ) );
+    }
+
+    void WriteString( const std::string& szValue )
+    {
+        this->Write( gsl::narrow<uint32_t>( szValue.size() ) );
+        this->m_vOutBuffer.insert( this->m_vOutBuffer.end(), szValue.begin(),
+                                   szValue.end() );
+    }
+
+private:
+    std::vector<uint8_t>& m_vOutBuffer;
+};
+
+// every read is bounds checked, since the files may have been truncated
+class BinaryBufferReader
+{
+public:
+    BinaryBufferReader( gsl::span<const uint8_t> buffer )
+        : m_Buffer( buffer ), m_iOffset( 0 )
+    {
+    }
+
+    template <typename T>
+    bool Read( T& outValue ) noexcept
+    {
+        static_assert( std::is_trivially_copyable_v<T> == true );
+
+        if ( this->GetBytesLeft() < sizeof( T ) )
+        {
+            return false;
+        }
+
+        std::memcpy( &outValue, &this->m_Buffer[this->m_iOffset],
+                     sizeof( T ) );
+        this->m_iOffset += sizeof( T );
+        return true;
+    }
+
+    bool ReadString( std::string& outValue )
+    {
+        uint32_t iLength;
+
+        if ( this->Read( iLength ) == false ||
+             this->GetBytesLeft() < iLength )
+        {
+            return false;
+        }
+
+        auto pBegin = reinterpret_cast<const char*>(
+            &this->m_Buffer[this->m_iOffset] );
+        outValue.assign( pBegin, iLength );
+        this->m_iOffset += iLength;
+        return true;
+    }
+
+    bool Skip( std::size_t iBytes ) noexcept
+    {
+        if ( this->GetBytesLeft() < iBytes )
+        {
+            return false;
+        }
+
+        this->m_iOffset += iBytes;
+        return true;
+    }
+
+    inline std::size_t GetBytesLeft() const noexcept
+    {
+        return this->m_Buffer.size() - this->m_iOffset;
+    }
+
+private:
+    gsl::span<const uint8_t> m_Buffer;
+    std::size_t m_iOffset;
+};
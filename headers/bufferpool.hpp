@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <gsl/gsl>
+
+//
+// Hands out reusable byte buffers grouped in power of two size classes
+//
+// Buffers go back to the pool when their handle is destroyed, as long as
+// the pool isn't holding more than its retention limit
+//
+class BufferPool
+{
+public:
+    class Buffer
+    {
+    public:
+        Buffer() noexcept;
+        Buffer( Buffer&& other ) noexcept;
+        Buffer& operator=( Buffer&& other ) noexcept;
+        ~Buffer();
+
+        inline std::uint8_t* GetData() const noexcept;
+        inline std::uint64_t GetSize() const noexcept;
+        inline gsl::span<std::uint8_t> GetSpan() const noexcept;
+
+        inline bool IsValid() const noexcept;
+
+        void Reset() noexcept;
+
+    private:
+        Buffer( BufferPool* pOwner, std::unique_ptr<std::uint8_t[]> pData,
+                std::size_t iSizeClass, std::uint64_t iSize ) noexcept;
+
+    private:
+        BufferPool* m_pOwner;
+        std::unique_ptr<std::uint8_t[]> m_pData;
+        std::size_t m_iSizeClass;
+        std::uint64_t m_iSize;
+
+        Buffer( const Buffer& ) = delete;
+        Buffer& operator=( const Buffer& ) = delete;
+
+        friend class BufferPool;
+    };
+
+public:
+    BufferPool( std::uint64_t iMaxRetainedBytes = DEFAULT_MAX_RETAINED_BYTES );
+    ~BufferPool();
+
+public:
+    Buffer Acquire( std::uint64_t iSize );
+
+    void Trim();
+
+private:
+    void Release( std::unique_ptr<std::uint8_t[]> pData,
+                  std::size_t iSizeClass ) noexcept;
+
+    static std::size_t GetSizeClass( std::uint64_t iSize ) noexcept;
+    static std::uint64_t GetClassCapacity( std::size_t iSizeClass ) noexcept;
+
+private:
+    // the smallest class holds 64 KiB, the biggest 2 GiB
+    static constexpr const std::size_t MIN_CLASS_SHIFT = 16;
+    static constexpr const std::size_t NUM_SIZE_CLASSES = 16;
+    static constexpr const std::uint64_t DEFAULT_MAX_RETAINED_BYTES =
+        256 * 1024 * 1024;
+
+    std::mutex m_Lock;
+    std::array<std::vector<std::unique_ptr<std::uint8_t[]>>, NUM_SIZE_CLASSES>
+        m_FreeBuffers;
+
+    std::uint64_t m_iRetainedBytes;
+    const std::uint64_t m_iMaxRetainedBytes;
+
+private:
+    BufferPool& operator=( const BufferPool& ) = delete;
+    BufferPool( const BufferPool& ) = delete;
+};
+
+inline std::uint8_t* BufferPool::Buffer::GetData() const noexcept
+{
+    return this->m_pData.get();
+}
+
+inline std::uint64_t BufferPool::Buffer::GetSize() const noexcept
+{
+    return this->m_iSize;
+}
+
+inline gsl::span<std::uint8_t> BufferPool::Buffer::GetSpan() const noexcept
+{
+    return { this->m_pData.get(),
+             gsl::narrow_cast<std::size_t>( this->m_iSize ) };
+}
+
+inline bool BufferPool::Buffer::IsValid() const noexcept
+{
+    return this->m_pData != nullptr;
+}
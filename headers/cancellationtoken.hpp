@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+
+//
+// Lets a thread ask a running job to stop
+//
+// Jobs check it between units of work (packages, entries), so they stop
+// at a point where nothing is left half written
+//
+class CancellationToken
+{
+public:
+    CancellationToken() : m_bCancelled( false ) {}
+    ~CancellationToken() = default;
+
+public:
+    inline void Cancel() noexcept;
+    inline bool IsCancelled() const noexcept;
+
+private:
+    std::atomic<bool> m_bCancelled;
+
+private:
+    CancellationToken& operator=( const CancellationToken& ) = delete;
+    CancellationToken( const CancellationToken& ) = delete;
+};
+
+inline void CancellationToken::Cancel() noexcept
+{
+    this->m_bCancelled.store( true, std::memory_order_relaxed );
+}
+
+inline bool CancellationToken::IsCancelled() const noexcept
+{
+    return this->m_bCancelled.load( std::memory_order_relaxed );
+}
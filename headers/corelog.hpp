@@ -0,0 +1,55 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+enum class LogLevel
+{
+    Debug = 0,
+    Warning,
+    Critical
+};
+
+using LogSinkFn = void ( * )( LogLevel level, std::string_view message );
+
+//
+// Where the archive core's messages go, standard error unless the
+// application hands them to its own logging
+//
+// The sink is called from any thread
+//
+void SetLogSink( LogSinkFn sink ) noexcept;
+void WriteLogMessage( LogLevel level, std::string_view message );
+
+// the arguments are separated by spaces
+template <typename... Args>
+inline void WriteLog( LogLevel level, const Args&... args )
+{
+    std::ostringstream messageStream;
+    bool bFirstArg = true;
+
+    ( ( messageStream << ( bFirstArg == true ? "" : " " ) << args,
+        bFirstArg = false ),
+      ... );
+
+    WriteLogMessage( level, messageStream.str() );
+}
+
+template <typename... Args>
+inline void LogDebug( const Args&... args )
+{
+    WriteLog( LogLevel::Debug, args... );
+}
+
+template <typename... Args>
+inline void LogWarning( const Args&... args )
+{
+    WriteLog( LogLevel::Warning, args... );
+}
+
+template <typename... Args>
+inline void LogCritical( const Args&... args )
+{
+    WriteLog( LogLevel::Critical, args... );
+}
@@ -22,6 +22,10 @@ public:
 public:
     uc2::PkgIndex::ptr_t&& GetPkgIndexOwnership() noexcept;
 
+    // the packages listed by a parsed index
+    static std::vector<std::string_view> GetPkgFilenames(
+        uc2::PkgIndex* pIndex );
+
 private:
     bool TryDetectProvider();
 
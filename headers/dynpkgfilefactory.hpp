@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -15,8 +16,19 @@ enum class GameProvider;
 class DynamicPkgFileFactory
 {
 public:
+    // how much of the package is read and has its header decrypted
+    enum class LoadMode
+    {
+        // the package can't be parsed until it's given its data
+        BaseHeader,
+        FullHeader,
+        // the entries can be decrypted too, while the factory is alive
+        WholeFile
+    };
+
     DynamicPkgFileFactory( const fs::path& pkgFilePath );
-    DynamicPkgFileFactory( const fs::path& pkgFilePath, GameProvider provider );
+    DynamicPkgFileFactory( const fs::path& pkgFilePath, GameProvider provider,
+                           LoadMode loadMode = LoadMode::FullHeader );
     ~DynamicPkgFileFactory();
 
 public:
@@ -25,14 +37,14 @@ public:
 
 private:
     bool LoadBaseFileHeader();
-    bool LoadFullFileHeader();
+    bool LoadFullFileHeader( bool bWholeFile = false );
 
     bool TryDetectProvider();
     bool TrySpecificProvider( GameProvider provider );
 
-    static std::pair<bool, GameProvider> TestCsKeys(
-        uc2::PkgFile* pPkgFile, std::vector<uint8_t>& vPkgFileData );
-    static bool TestTfoKeys( uc2::PkgFile* pPkgFile );
+    static uc2::PkgFile::ptr_t TryDecryptWithProvider(
+        const std::string& pkgFilename, std::vector<uint8_t>& vPkgFileData,
+        GameProvider provider ) noexcept;
 
 private:
     const fs::path& m_PkgFilePath;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <gsl/gsl>
 
 namespace uc2
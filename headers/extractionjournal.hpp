@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "extractionmanifest.hpp"
+
+namespace fs = std::filesystem;
+
+//
+// An append only log of the files and packages an extraction finished, and
+// of the packages it couldn't load, kept in the output directory until the
+// extraction succeeds
+//
+// If the extraction dies halfway, extracting to the same directory again
+// trusts the journal instead of checking the files on the disk, and
+// resumes where it stopped. A file is only journaled after it was fully
+// written, and every record has a checksum, so a record torn by a crash is
+// dropped along with whatever comes after it
+//
+// Files are journaled in memory and written out with their package, or
+// when enough of them piled up. Thread safe
+//
+class ExtractionJournal
+{
+public:
+    struct JournaledFile
+    {
+        std::string szTargetPath;
+        ExtractedFileSource source;
+        // relative to the output directory
+        std::string szResultPath;
+    };
+
+public:
+    ExtractionJournal( const fs::path& outPath );
+    ~ExtractionJournal();
+
+public:
+    // reads what an interrupted extraction left behind
+    bool Open();
+    // the extraction is done, there's nothing left to resume
+    void Remove();
+
+    bool IsFileDone( const std::string& szTargetPath,
+                     const ExtractedFileSource& source,
+                     std::string& outResultPath );
+    // only for extractions of every package, whose files have their own
+    // path as target
+    bool IsPkgFileDone( const std::string& szPkgFilename,
+                        const PkgFileStamp& pkgStamp, uint8_t iOptions );
+    std::vector<JournaledFile> GetPkgFileFiles(
+        const std::string& szPkgFilename );
+    // the packages that couldn't be loaded, with why, until they're done
+    std::unordered_map<std::string, std::string> GetFailedPkgFiles();
+
+    void AddFile( JournaledFile file );
+    // also writes out the journaled files
+    void AddPkgFile( const std::string& szPkgFilename,
+                     const PkgFileStamp& pkgStamp, uint8_t iOptions );
+    // also writes out the journaled files
+    void AddFailedPkgFile( const std::string& szPkgFilename,
+                           const std::string& szError );
+    void Flush();
+
+private:
+    struct DonePkgFile
+    {
+        PkgFileStamp stamp;
+        uint8_t iOptions;
+    };
+
+    void AppendRecord( const std::vector<uint8_t>& vPayload );
+    void FlushInternal();
+
+private:
+    fs::path m_JournalPath;
+
+    std::mutex m_Lock;
+
+    // by the target paths
+    std::unordered_map<std::string, JournaledFile> m_Files;
+    // by the packages' filename
+    std::unordered_map<std::string, DonePkgFile> m_PkgFiles;
+    std::unordered_map<std::string, std::string> m_FailedPkgFiles;
+
+    // opened with the first write
+    std::ofstream m_JournalStream;
+    std::vector<uint8_t> m_vPendingRecords;
+
+private:
+    ExtractionJournal& operator=( const ExtractionJournal& ) = delete;
+    ExtractionJournal( const ExtractionJournal& ) = delete;
+};
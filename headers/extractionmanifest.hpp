@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "indexmetadatacache.hpp"
+
+namespace fs = std::filesystem;
+
+enum ExtractionOptionsEnum : uint8_t
+{
+    EO_None = 0,
+    EO_Decrypt = 1 << 0,
+    EO_Decompress = 1 << 1,
+};
+
+// what an output file was extracted from, and how
+struct ExtractedFileSource
+{
+    std::string szPkgFilename;
+    PkgFileStamp pkgStamp;
+    std::string szEntryPath;
+    uint64_t iEntryBytes;
+    // a mask of ExtractionOptionsEnum
+    uint8_t iOptions;
+
+    bool operator==( const ExtractedFileSource& other ) const noexcept;
+};
+
+//
+// The files extracted to an output directory, kept inside it so extracting
+// to it again can skip the files that are already up to date
+//
+// A file is up to date when its source package has the same stamp, it was
+// extracted with the same options and its output wasn't changed since.
+// Since a patch replaces whole packages, only the files of the changed
+// packages get extracted again
+//
+// Thread safe
+//
+class ExtractionManifest
+{
+public:
+    ExtractionManifest( const fs::path& outPath );
+    ~ExtractionManifest() = default;
+
+public:
+    bool Load();
+    bool Save();
+
+    // the target path is relative to the output directory
+    bool IsUpToDate( const std::string& szTargetPath,
+                     const ExtractedFileSource& source );
+    // how many of the package's files are up to date at their own path,
+    // where extracting every package puts them
+    std::size_t CountUpToDate( const std::string& szPkgFilename,
+                               const PkgFileStamp& pkgStamp,
+                               uint8_t iOptions );
+
+    void Record( const std::string& szTargetPath, ExtractedFileSource source,
+                 const fs::path& resultPath );
+
+private:
+    struct ExtractedFile
+    {
+        ExtractedFileSource source;
+        // relative to the output directory, decrypted files are renamed
+        std::string szResultPath;
+        uint64_t iResultSize;
+        int64_t iResultModifiedTime;
+    };
+
+    bool IsResultUnchanged( const ExtractedFile& file ) const;
+
+private:
+    fs::path m_OutPath;
+    fs::path m_ManifestPath;
+
+    std::mutex m_Lock;
+
+    // by the target paths
+    std::unordered_map<std::string, ExtractedFile> m_Files;
+    // the target paths of each package's files, as they were loaded
+    std::unordered_map<std::string, std::vector<std::string>> m_PkgFileTargets;
+
+    bool m_bChanged;
+
+private:
+    ExtractionManifest& operator=( const ExtractionManifest& ) = delete;
+    ExtractionManifest( const ExtractionManifest& ) = delete;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <QObject>
+#include <QString>
+
+#include "extractionstats.hpp"
+#include "gamedatainfo.hpp"
+#include "nodeextractionmgr.hpp"
+
+namespace fs = std::filesystem;
+
+class BackgroundJob;
+class LoadedPkgFiles;
+
+struct ExtractionRequest
+{
+    // shown to the user
+    QString szName;
+
+    fs::path outPath;
+    fs::path pkgParentPath;
+
+    bool bDecrypt = true;
+    bool bDecompress = true;
+    // skips the files the output directory's manifest has up to date
+    bool bSkipUpToDate = false;
+
+    // extracts every loaded package instead of the snapshot's files
+    bool bAllPackages = false;
+    NodeExtractionMgr::Snapshot snapshot;
+
+    // when set, only the snapshot's files that were added or changed since
+    // this index are extracted, and the removed ones are listed
+    fs::path baseIndexPath;
+    GameProvider baseProvider = GameProvider::Unknown;
+
+    std::size_t iFilesNum = 0;
+};
+
+//
+// Runs extractions one after the other in the background, so the tree can
+// keep being browsed while they're going
+//
+// Each request carries a snapshot of the files to extract, so the tree is
+// never read by the extraction. The loaded packages must not be changed
+// while the queue is busy though
+//
+class ExtractionQueue : public QObject
+{
+    Q_OBJECT
+public:
+    ExtractionQueue( const LoadedPkgFiles& pkgFiles,
+                     QObject* pParent = nullptr );
+    ~ExtractionQueue();
+
+public:
+    // returns the new job's id
+    int Enqueue( ExtractionRequest request );
+
+    void Cancel( int iJobId );
+    void CancelAllAndWait();
+
+    inline bool IsBusy() const noexcept;
+
+signals:
+    void jobQueued( int iJobId, const QString& szName, int iFilesNum );
+    void jobStarted( int iJobId );
+    void jobProgress( int iJobId, int iProgress );
+    void jobMaxProgress( int iJobId, int iMaxProgress );
+    void jobThroughput( int iJobId, const ThroughputSample& sample );
+    // szError says why a job that wasn't cancelled failed
+    void jobFinished( int iJobId, bool bSucceeded, bool bCancelled,
+                      const QString& szError );
+
+private slots:
+    void OnJobCompleted( bool bSucceeded );
+
+private:
+    void StartNextJob();
+
+private:
+    const LoadedPkgFiles& m_PkgFiles;
+
+    std::deque<std::pair<int, ExtractionRequest>> m_PendingJobs;
+
+    std::unique_ptr<BackgroundJob> m_pCurrentJob;
+    ExtractionRequest m_CurrentRequest;
+    int m_iCurrentJobId;
+    // written by the job, read once it's completed
+    std::string m_szCurrentError;
+
+    int m_iNextJobId;
+};
+
+inline bool ExtractionQueue::IsBusy() const noexcept
+{
+    return this->m_pCurrentJob != nullptr ||
+           this->m_PendingJobs.empty() == false;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+//
+// Counters of an extraction's work, updated by NodeExtractionMgr from its
+// workers and read by anyone from any thread
+//
+// Progress is weighted by the entries' decrypted size, so a few big files
+// don't look as fast as the many small ones
+//
+class ExtractionStats
+{
+public:
+    ExtractionStats();
+    ~ExtractionStats() = default;
+
+public:
+    // the decrypted size of the entries to extract
+    inline void AddTotalBytes( uint64_t iBytes ) noexcept;
+    // package data read from the disk
+    inline void AddReadBytes( uint64_t iBytes ) noexcept;
+    // data written to the output files
+    inline void AddWrittenBytes( uint64_t iBytes ) noexcept;
+    // an entry is fully extracted
+    inline void AddExtractedFile( uint64_t iEntryBytes ) noexcept;
+    // entries that were already up to date, their bytes leave the total
+    inline void AddSkippedFiles( uint64_t iFilesNum,
+                                 uint64_t iEntryBytes ) noexcept;
+
+    inline uint64_t GetTotalBytes() const noexcept;
+    inline uint64_t GetReadBytes() const noexcept;
+    inline uint64_t GetWrittenBytes() const noexcept;
+    inline uint64_t GetExtractedBytes() const noexcept;
+    inline uint64_t GetExtractedFiles() const noexcept;
+    inline uint64_t GetSkippedFiles() const noexcept;
+
+private:
+    std::atomic<uint64_t> m_iTotalBytes;
+    std::atomic<uint64_t> m_iReadBytes;
+    std::atomic<uint64_t> m_iWrittenBytes;
+    std::atomic<uint64_t> m_iExtractedBytes;
+    std::atomic<uint64_t> m_iExtractedFiles;
+    std::atomic<uint64_t> m_iSkippedFiles;
+
+private:
+    ExtractionStats& operator=( const ExtractionStats& ) = delete;
+    ExtractionStats( const ExtractionStats& ) = delete;
+};
+
+struct ThroughputSample
+{
+    uint64_t iTotalBytes = 0;
+    uint64_t iExtractedBytes = 0;
+    uint64_t iExtractedFiles = 0;
+
+    double fReadBytesPerSec = 0.0;
+    double fWrittenBytesPerSec = 0.0;
+    double fFilesPerSec = 0.0;
+
+    // negative until there's enough to estimate it
+    double fSecondsLeft = -1.0;
+};
+
+//
+// Turns an ExtractionStats' counters into rates over the last few seconds,
+// so the rates follow the current speed instead of the whole run's
+//
+// Sample must always be called from the same thread
+//
+class ThroughputMeter
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+
+    ThroughputMeter( const ExtractionStats& stats,
+                     clock_t::duration window = std::chrono::seconds( 5 ) );
+    ~ThroughputMeter() = default;
+
+public:
+    ThroughputSample Sample( clock_t::time_point now = clock_t::now() );
+
+private:
+    struct CountersPoint
+    {
+        clock_t::time_point time;
+        uint64_t iReadBytes;
+        uint64_t iWrittenBytes;
+        uint64_t iExtractedBytes;
+        uint64_t iExtractedFiles;
+    };
+
+    const ExtractionStats& m_Stats;
+    const clock_t::duration m_Window;
+
+    std::deque<CountersPoint> m_Points;
+};
+
+inline void ExtractionStats::AddTotalBytes( uint64_t iBytes ) noexcept
+{
+    this->m_iTotalBytes.fetch_add( iBytes, std::memory_order_relaxed );
+}
+
+inline void ExtractionStats::AddReadBytes( uint64_t iBytes ) noexcept
+{
+    this->m_iReadBytes.fetch_add( iBytes, std::memory_order_relaxed );
+}
+
+inline void ExtractionStats::AddWrittenBytes( uint64_t iBytes ) noexcept
+{
+    this->m_iWrittenBytes.fetch_add( iBytes, std::memory_order_relaxed );
+}
+
+inline void ExtractionStats::AddExtractedFile( uint64_t iEntryBytes ) noexcept
+{
+    this->m_iExtractedBytes.fetch_add( iEntryBytes,
+                                       std::memory_order_relaxed );
+    this->m_iExtractedFiles.fetch_add( 1, std::memory_order_relaxed );
+}
+
+inline void ExtractionStats::AddSkippedFiles( uint64_t iFilesNum,
+                                              uint64_t iEntryBytes ) noexcept
+{
+    this->m_iTotalBytes.fetch_sub( iEntryBytes, std::memory_order_relaxed );
+    this->m_iSkippedFiles.fetch_add( iFilesNum, std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetTotalBytes() const noexcept
+{
+    return this->m_iTotalBytes.load( std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetReadBytes() const noexcept
+{
+    return this->m_iReadBytes.load( std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetWrittenBytes() const noexcept
+{
+    return this->m_iWrittenBytes.load( std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetExtractedBytes() const noexcept
+{
+    return this->m_iExtractedBytes.load( std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetExtractedFiles() const noexcept
+{
+    return this->m_iExtractedFiles.load( std::memory_order_relaxed );
+}
+
+inline uint64_t ExtractionStats::GetSkippedFiles() const noexcept
+{
+    return this->m_iSkippedFiles.load( std::memory_order_relaxed );
+}
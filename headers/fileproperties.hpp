@@ -5,7 +5,7 @@
 #include <cassert>
 #include <filesystem>
 #include <gsl/gsl>
-#include <unordered_map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -13,6 +13,8 @@ namespace fs = std::filesystem;
 
 #include "gamedatainfo.hpp"
 
+class LoadedPkgFiles;
+
 class FileProperties
 {
 public:
@@ -29,9 +31,8 @@ public:
 
     void SetPkgFileProperties( GameProvider provider,
                                gsl::not_null<uc2::PkgFile*> pPkgFile );
-    void SetIndexFileProperties(
-        GameProvider provider,
-        const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>& pkgFiles );
+    void SetIndexFileProperties( GameProvider provider,
+                                 const LoadedPkgFiles& pkgFiles );
 
     void Reset();
 
@@ -11,5 +11,9 @@ std::pair<bool, std::vector<std::uint8_t>> ReadFileToBuffer(
     const fs::path& filePath, uint64_t readLength = 0 );
 bool WriteBufferToFile( const fs::path& filePath,
                         gsl::span<std::uint8_t> buff );
+// writes to a temporary file first, so the old file is only replaced by a
+// complete one
+bool ReplaceFileWithBuffer( const fs::path& filePath,
+                            gsl::span<std::uint8_t> buff );
 
 bool CreateDirIfUnexisting( const fs::path& newDirPath ) noexcept;
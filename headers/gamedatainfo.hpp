@@ -6,6 +6,10 @@
 namespace fs = std::filesystem;
 using namespace std::string_view_literals;
 
+// the index file name should be the same in cso2 and tfo
+constexpr const std::string_view INDEX_FILENAME =
+    "1b87c6b551e518d11114ee21b7645a47.pkg"sv;
+
 enum class GameProvider
 {
     Unknown = -1,
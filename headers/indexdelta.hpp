@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "cancellationtoken.hpp"
+#include "loadedpkgfiles.hpp"
+#include "md5.hpp"
+#include "nodeextractionmgr.hpp"
+
+namespace fs = std::filesystem;
+
+enum class GameProvider;
+
+//
+// What changed between an older index, usually another install's, and the
+// loaded one, so a patch's extraction only writes what the patch changed
+//
+// Entries are matched by their path. Entries with the same path and size on
+// both sides are compared by the MD5 of their decrypted data, which is only
+// computed for them, and only their packages are read to do it
+//
+class IndexDelta
+{
+public:
+    IndexDelta( const LoadedPkgFiles& pkgFiles,
+                const CancellationToken& cancelToken );
+    ~IndexDelta() = default;
+
+public:
+    // the snapshot must hold every file of the loaded index, only its added
+    // and changed files are left in it
+    bool Compute( const fs::path& baseIndexPath, GameProvider baseProvider,
+                  NodeExtractionMgr::Snapshot& snapshot,
+                  const fs::path& pkgParentPath );
+
+    // one path per line, relative to the output directory
+    bool WriteRemovedList( const fs::path& outPath ) const;
+
+    inline const std::vector<std::string>& GetRemovedPaths() const noexcept;
+    inline std::size_t GetAddedNum() const noexcept;
+    inline std::size_t GetChangedNum() const noexcept;
+    inline std::size_t GetUnchangedNum() const noexcept;
+
+private:
+    using EntryDigest = Md5Digest;
+
+    // an entry of the base index
+    struct BaseEntry
+    {
+        std::size_t iPkgIndex;
+        std::size_t iEntryIndex;
+        uint64_t iDecryptedSize;
+    };
+
+    // a file with the same path and size on both sides
+    struct SameSizedFile
+    {
+        PkgFileId iNewPkgId = 0;
+        // in the new package's work list
+        std::size_t iWorkIndex = 0;
+        std::size_t iBasePkgIndex = 0;
+        std::size_t iBaseEntryIndex = 0;
+        EntryDigest baseDigest = {};
+        EntryDigest newDigest = {};
+        bool bBaseDigested = false;
+        bool bNewDigested = false;
+    };
+
+    bool LoadBaseIndex( const fs::path& baseIndexPath,
+                        GameProvider baseProvider );
+    void DigestBaseFiles( std::vector<SameSizedFile>& vFiles );
+    bool DigestNewFiles( std::vector<SameSizedFile>& vFiles,
+                         const NodeExtractionMgr::Snapshot& snapshot,
+                         const fs::path& pkgParentPath );
+
+    // the entries are sorted by their index
+    static bool DigestPkgFileEntries(
+        uc2::PkgFile* pPkgFile, const fs::path& pkgPath,
+        const std::vector<std::pair<std::size_t, SameSizedFile*>>& vEntries,
+        bool bNewSide );
+
+private:
+    const LoadedPkgFiles& m_PkgFiles;
+    const CancellationToken& m_CancelToken;
+
+    fs::path m_BaseParentPath;
+    std::vector<uc2::PkgFile::ptr_t> m_vBasePkgFiles;
+    std::vector<std::pair<std::string, BaseEntry>> m_vBaseEntries;
+
+    std::vector<std::string> m_vRemovedPaths;
+    std::size_t m_iAddedNum;
+    std::size_t m_iChangedNum;
+    std::size_t m_iUnchangedNum;
+
+private:
+    IndexDelta& operator=( const IndexDelta& ) = delete;
+    IndexDelta( const IndexDelta& ) = delete;
+};
+
+inline const std::vector<std::string>& IndexDelta::GetRemovedPaths() const
+    noexcept
+{
+    return this->m_vRemovedPaths;
+}
+
+inline std::size_t IndexDelta::GetAddedNum() const noexcept
+{
+    return this->m_iAddedNum;
+}
+
+inline std::size_t IndexDelta::GetChangedNum() const noexcept
+{
+    return this->m_iChangedNum;
+}
+
+inline std::size_t IndexDelta::GetUnchangedNum() const noexcept
+{
+    return this->m_iUnchangedNum;
+}
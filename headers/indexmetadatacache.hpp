@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+enum class GameProvider;
+
+// what the tree needs to know about a file entry
+struct PkgEntryMetadata
+{
+    std::string szFilePath;
+    uint64_t iDecryptedSize;
+    bool bEncrypted;
+    // a mask of EntryFlagsEnum
+    std::uint8_t iEntryFlags;
+};
+
+// tells whether a package changed since its metadata was taken
+struct PkgFileStamp
+{
+    uint64_t iFileSize = 0;
+    int64_t iModifiedTime = 0;
+    std::array<uint8_t, 16> baseHeaderMd5 = {};
+
+    bool operator==( const PkgFileStamp& other ) const noexcept;
+};
+
+struct PkgFileMetadata
+{
+    PkgFileStamp stamp;
+    // in the package's entry order
+    std::vector<PkgEntryMetadata> vEntries;
+
+    bool AreEntryFlagsDetected() const noexcept;
+};
+
+//
+// The metadata of an index's packages, kept on the disk so an unchanged
+// package doesn't have its header decrypted and parsed again
+//
+// A package's metadata is only used when its stamp (its size, modification
+// time and base header's MD5) still matches. Packages that weren't looked
+// up or stored since the cache was loaded are dropped when it's saved
+//
+class IndexMetadataCache
+{
+public:
+    IndexMetadataCache( const fs::path& cacheDir, const fs::path& indexPath,
+                        GameProvider provider );
+    ~IndexMetadataCache() = default;
+
+public:
+    bool Load();
+    bool Save();
+
+    // nullptr if the package changed or wasn't cached
+    const PkgFileMetadata* Find( const std::string& szPkgFilename,
+                                 const PkgFileStamp& stamp );
+    void Store( const std::string& szPkgFilename, PkgFileMetadata metadata );
+
+    static bool ReadPkgFileStamp( const fs::path& pkgPath,
+                                  PkgFileStamp& outStamp );
+
+private:
+    struct CachedPkgFile
+    {
+        PkgFileMetadata metadata;
+        bool bUsed;
+    };
+
+    fs::path m_CacheFilePath;
+    const GameProvider m_Provider;
+
+    // by the packages' filename
+    std::unordered_map<std::string, CachedPkgFile> m_PkgFiles;
+    bool m_bChanged;
+
+private:
+    IndexMetadataCache& operator=( const IndexMetadataCache& ) = delete;
+    IndexMetadataCache( const IndexMetadataCache& ) = delete;
+};
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <array>
+#include <functional>
+#include <memory>
 
 #include <QMainWindow>
 #include <QTemporaryDir>
 
 #include "ui_mainwindow.h"
 
+#include "backgroundjob.hpp"
+#include "busywinwrapper.hpp"
+#include "extractionqueue.hpp"
 #include "gamedatainfo.hpp"
 #include "pkgfilemodel.hpp"
+#include "previewcache.hpp"
 #include "widgets/errorbox.hpp"
 #include "widgets/statuswidget.hpp"
 
@@ -17,6 +23,7 @@ class QFile;
 constexpr const int MAINWIN_RECENT_ITEMS_NUM = 8;
 
 class ArchiveFileNode;
+class ExtractionQueueWidget;
 
 class PkgFileModel;
 
@@ -68,17 +75,21 @@ private:
     void LoadPackage( const fs::path& pkgPath,
                       GameProvider provider = GameProvider::Unknown );
 
-    bool DoLoadPackageJob( const fs::path& pkgPath, GameProvider provider );
-    bool DoLoadIndexJob( const fs::path& indexPath, GameProvider provider );
+    // served from the preview cache when possible
+    void PreviewFileNode( ArchiveFileNode* pFileNode );
+    void OpenPreview( const fs::path& previewPath );
 
-    bool DoExtractionJob( const fs::path& outPath );
-    bool DoPreviewExtractionJob( ArchiveFileNode* pFileNode,
-                                 const fs::path& outDirPath,
-                                 fs::path& outResultPath );
-    bool DoExtractionAllJob( const fs::path& outPath );
+    // called in the GUI thread with the job's result
+    using jobDone_t = std::function<void( bool bSucceeded )>;
+
+    // the window is busy until the job is done, so only one runs at a time
+    void StartJob( BackgroundJob::job_t job, jobDone_t onDone,
+                   const QString& label, bool bCancelable = true );
 
     void HandleExit();
 
+    bool CanReplaceModel();
+
     void ValidateLastDirs();
 
     void LoadSettings();
@@ -92,12 +103,15 @@ private slots:
     void OnIndexFileOpen();
     void OnRecentFileOpen();
     void OnExtractAll();
+    void OnExtractChanges();
     void OnQuitButton();
 
     void OnRecentFileClear();
 
     void OnDecryptToggle( bool bChecked );
     void OnDecompressToggle( bool bChecked );
+    void OnSkipUpToDateToggle( bool bChecked );
+    void OnDetectTypesToggle( bool bChecked );
 
     void OnPreviewClick();
     void OnExtractClick();
@@ -107,23 +121,45 @@ private slots:
 
     void OnItemDoubleClicked( const QModelIndex& index );
 
+    void OnExtractionFinished( int iJobId, bool bSucceeded, bool bCancelled,
+                               const QString& szError );
+
+    void OnJobCompleted( bool bSucceeded );
+
 private:
     PkgFileModel m_Model;
 
     ErrorBoxWidget m_ErrorBoxWidget;
     StatusWidget m_StatusWidget;
 
+    ExtractionQueue m_ExtractionQueue;
+    ExtractionQueueWidget* m_pExtractionQueueWidget;
+
     std::array<std::shared_ptr<QAction>, MAINWIN_RECENT_ITEMS_NUM>
         m_RecentFileActions;
     QStringList m_RecentFileNames;
 
     QTemporaryDir m_TempDir;
+    // lives in the temporary directory
+    PreviewCache m_PreviewCache;
 
     QString m_LastOpenDir;
     QString m_LastExtractDir;
 
     bool m_bShouldDecrypt;
     bool m_bShouldDecompress;
+    bool m_bShouldSkipUpToDate;
+
+    std::unique_ptr<BackgroundJob> m_pCurrentJob;
+    std::unique_ptr<CBusyWinWrapper> m_pJobBusyWin;
+    jobDone_t m_OnJobDone;
+
+    bool m_bLastJobCancelled;
+    // the window was closed while a job was running
+    bool m_bCloseAfterJob;
+
+    // zero uses a worker thread per hardware thread
+    int m_iWorkerThreads;
 
     friend class CBusyWinWrapper;
 };
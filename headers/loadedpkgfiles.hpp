@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <uc2/pkgfile.hpp>
+
+#include "pkgfilesystemshared.hpp"
+#include "residentpkgdata.hpp"
+
+// a package's totals, known even when it isn't parsed
+struct PkgFileSummary
+{
+    uint64_t iEntriesNum = 0;
+    uint64_t iEncryptedNum = 0;
+    uint64_t iDecryptedBytes = 0;
+};
+
+//
+// The packages loaded by an ArchiveTree, indexed by PkgFileId
+//
+// Packages loaded from cached metadata aren't parsed until they're
+// extracted from, so their entries are only counted by their summary
+//
+// Extracting from a package sets the package's data buffer, which can't be
+// shared by two extractions, so whoever sets it must hold the package's
+// data lock until it's released
+//
+// The data of the recently extracted from packages is kept resident, for
+// the extractions and previews that come after
+//
+class LoadedPkgFiles
+{
+public:
+    LoadedPkgFiles() = default;
+    ~LoadedPkgFiles() = default;
+
+public:
+    inline PkgFileId Add( uc2::PkgFile::ptr_t pPkgFile,
+                          const PkgFileSummary& summary );
+    inline void Clear() noexcept;
+
+    inline uc2::PkgFile* Get( PkgFileId pkgId ) const;
+    inline const PkgFileSummary& GetSummary( PkgFileId pkgId ) const;
+    inline std::size_t GetCount() const noexcept;
+
+    inline std::unique_lock<std::mutex> LockData( PkgFileId pkgId ) const;
+    inline ResidentPkgData& GetResidentData() const noexcept;
+
+private:
+    std::vector<uc2::PkgFile::ptr_t> m_vPkgFiles;
+    std::vector<PkgFileSummary> m_vSummaries;
+    // a deque, since mutexes can't be moved when growing
+    mutable std::deque<std::mutex> m_DataLocks;
+    mutable ResidentPkgData m_ResidentData;
+
+private:
+    LoadedPkgFiles& operator=( const LoadedPkgFiles& ) = delete;
+    LoadedPkgFiles( const LoadedPkgFiles& ) = delete;
+};
+
+inline PkgFileId LoadedPkgFiles::Add( uc2::PkgFile::ptr_t pPkgFile,
+                                     const PkgFileSummary& summary )
+{
+    const PkgFileId newPkgId = this->m_vPkgFiles.size();
+
+    this->m_vPkgFiles.push_back( std::move( pPkgFile ) );
+    this->m_vSummaries.push_back( summary );
+    this->m_DataLocks.emplace_back();
+
+    return newPkgId;
+}
+
+inline void LoadedPkgFiles::Clear() noexcept
+{
+    this->m_vPkgFiles.clear();
+    this->m_vSummaries.clear();
+    this->m_DataLocks.clear();
+    this->m_ResidentData.Clear();
+}
+
+inline uc2::PkgFile* LoadedPkgFiles::Get( PkgFileId pkgId ) const
+{
+    return this->m_vPkgFiles.at( pkgId ).get();
+}
+
+inline const PkgFileSummary& LoadedPkgFiles::GetSummary(
+    PkgFileId pkgId ) const
+{
+    return this->m_vSummaries.at( pkgId );
+}
+
+inline std::size_t LoadedPkgFiles::GetCount() const noexcept
+{
+    return this->m_vPkgFiles.size();
+}
+
+inline std::unique_lock<std::mutex> LoadedPkgFiles::LockData(
+    PkgFileId pkgId ) const
+{
+    return std::unique_lock<std::mutex>( this->m_DataLocks.at( pkgId ) );
+}
+
+inline ResidentPkgData& LoadedPkgFiles::GetResidentData() const noexcept
+{
+    return this->m_ResidentData;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <gsl/gsl>
+
+//
+// Encodes data as an LZMA stream any LZMA decoder reads, to make textures
+// compressed like the game's
+//
+// Every byte is coded as a literal, so only the range coder's modeling
+// shrinks the data. It's decoded through the same path as real textures'
+// literals, which is the slowest one per byte
+//
+class LzmaEncoder
+{
+public:
+    // the properties byte and the dictionary size
+    static constexpr const std::size_t PROPS_SIZE = 5;
+
+    static std::array<uint8_t, PROPS_SIZE> GetProps() noexcept;
+    // appends the stream to vOut, without any header or end marker, so its
+    // decoder must be told the data's size
+    static void Encode( gsl::span<const uint8_t> data,
+                        std::vector<uint8_t>& vOut );
+};
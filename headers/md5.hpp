@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <gsl/gsl>
+
+using Md5Digest = std::array<uint8_t, 16>;
+
+//
+// RFC 1321's MD5, to tell data apart, not to secure anything
+//
+class Md5
+{
+public:
+    Md5() noexcept;
+    ~Md5() = default;
+
+public:
+    static Md5Digest Hash( gsl::span<const uint8_t> data ) noexcept;
+    static std::string ToHex( const Md5Digest& digest );
+
+    void Update( gsl::span<const uint8_t> data ) noexcept;
+    // the hash can't be updated afterwards
+    Md5Digest Finish() noexcept;
+
+private:
+    void Transform( const uint8_t* pBlock ) noexcept;
+
+private:
+    std::array<uint32_t, 4> m_State;
+    std::array<uint8_t, 64> m_Block;
+    uint64_t m_iTotalBytes;
+};
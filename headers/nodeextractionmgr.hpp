@@ -1,16 +1,30 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
-#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <gsl/gsl>
 
 #include <uc2/pkgfile.hpp>
 
-namespace fs = std::filesystem;
+#include "bufferpool.hpp"
+#include "cancellationtoken.hpp"
+#include "extractionjournal.hpp"
+#include "extractionmanifest.hpp"
+#include "extractionstats.hpp"
+#include "loadedpkgfiles.hpp"
+#include "pkgfilesystemshared.hpp"
+#include "pkgownerset.hpp"
+#include "specialfilehandler.hpp"
+#include "workerpool.hpp"
 
-class QModelIndex;
+namespace fs = std::filesystem;
 
 namespace uc2
 {
@@ -26,80 +40,246 @@ enum class GameProvider;
 class NodeExtractionMgr
 {
 public:
-    NodeExtractionMgr(
-        const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>& pkgFiles,
-        fs::path outPath, int& outProgressNum, bool canDecrypt,
-        bool canDecompress );
-    ~NodeExtractionMgr() = default;
+    // output path relative to the output directory and the node to write to
+    using NodeWorkList = std::vector<std::pair<fs::path, ArchiveFileNode*>>;
+
+    //
+    // The files to extract bucketed by their owner, gathered from the tree
+    // up front so the extraction itself never reads the tree, which may be
+    // sorted or browsed in the meantime
+    //
+    struct Snapshot
+    {
+        // in ascending order
+        std::vector<PkgFileId> vRequiredPkgIds;
+        // indexed by PkgFileId
+        std::vector<NodeWorkList> vPkgWorkLists;
+        std::size_t iFilesNum = 0;
+    };
 
 public:
-    bool LoadPkgFileData( const fs::path& pkgParentPath,
-                          uc2::PkgFile* pkgFile );
+    NodeExtractionMgr( const LoadedPkgFiles& pkgFiles, fs::path outPath,
+                       std::atomic<int>& outProgressNum,
+                       const CancellationToken& cancelToken, bool canDecrypt,
+                       bool canDecompress );
+    ~NodeExtractionMgr() = default;
 
+public:
     inline int GetExtractionProgress() const;
 
+    // extractions are background work by default
+    inline void SetPriority( WorkPriority priority ) noexcept;
+
+    // optional, filled in while extracting
+    inline void SetStats( ExtractionStats* pStats ) noexcept;
+
+    // optional, the files it knows are up to date are skipped, and the
+    // extracted ones are recorded in it
+    inline void SetManifest( ExtractionManifest* pManifest ) noexcept;
+
+    // optional, lets an interrupted extraction be resumed
+    inline void SetJournal( ExtractionJournal* pJournal ) noexcept;
+
+    static Snapshot TakeSnapshot( const gsl::span<ArchiveBaseNode*> nodes,
+                                  std::size_t iPkgFilesNum );
+    // splits a package's entries into the batches its workers decrypt
+    static std::vector<std::size_t> SplitIntoBatches(
+        std::size_t iEntriesNum,
+        const std::function<uint64_t( std::size_t )>& getEntrySize );
+
     // from PkgFileModel
     bool ExtractNodes( const gsl::span<ArchiveBaseNode*> targetNodes,
                        const fs::path& pkgParentPath );
-    bool ExtractPackages( gsl::span<uc2::PkgFile*> pkgs,
-                          const fs::path& pkgParentPath );
+    bool ExtractSnapshot( Snapshot& snapshot, const fs::path& pkgParentPath );
+    // extracts every loaded package
+    bool ExtractPackages( const fs::path& pkgParentPath );
 
     bool ExtractSingleFileNode( ArchiveFileNode* pFileNode,
                                 const fs::path& pkgParentPath,
                                 fs::path& outResultPath );
 
+    // the packages skipped by the extraction because they couldn't be loaded
+    inline const std::vector<std::string>& GetFailedPkgFiles() const noexcept;
+    // why the extraction last failed
+    std::string GetError();
+
 private:
-    void AddNodes( const gsl::span<ArchiveBaseNode*> nodes,
-                   uc2::PkgFile* ownerPkgFile );
-    void AddFileNode( ArchiveFileNode* pFileNode, uc2::PkgFile* ownerPkgFile,
-                      fs::path nodeParentDir = {} );
-    void AddDirectoryNode( ArchiveDirectoryNode* pDirNode,
-                           uc2::PkgFile* ownerPkgFile,
-                           fs::path parentNodePath = {} );
+    //
+    // A package being extracted, and what its files are extracted from
+    //
+    // Several packages are extracted at once, but only one worker at a time
+    // decrypts a package's entries, like IndexDelta does, since libuncso2
+    // doesn't document them as safe to decrypt concurrently
+    //
+    struct PkgFileWork
+    {
+        PkgFileId iPkgId = 0;
+        uc2::PkgFile* pPkgFile = nullptr;
+        std::vector<uint8_t> vData;
+        // why the package couldn't be loaded
+        std::string szLoadError;
+        // whether its data is kept in the resident data once read, whole
+        // archive extractions would only push out the packages being browsed
+        bool bKeepResident = false;
 
-    void HandleFileNode( ArchiveFileNode* pFileNode, std::size_t iPkgPathHash,
-                         fs::path parentDir );
+        // the source of the package's files, only recorded when stamped
+        ExtractedFileSource source = {};
+        bool bStamped = false;
 
-    bool WriteNodesToDisk();
-    bool WriteSingleNodeToDisk( fs::path& outPath );
+        // held while decrypting the package's entries
+        std::mutex decryptLock;
+    };
 
-    bool WritePackageToDisk( uc2::PkgFile* pPkgFile );
-    static bool WritePkgEntryInternal( uc2::PkgEntry* pEntry,
-                                       fs::path& outFilePath, bool canDecrypt,
-                                       bool canDecompress );
+    struct QueuedTexture
+    {
+        SpecialFileHandler handler;
+        const PkgFileWork* pWork;
+        uc2::PkgEntry* pEntry;
+        // before the handler renamed it, for the manifest
+        fs::path targetFilePath;
+    };
 
-    inline bool HasAnyNodes() const;
+    // an entry to extract and where it's written to
+    struct EntryTarget
+    {
+        // null if the entry is skipped
+        uc2::PkgEntry* pEntry = nullptr;
+        fs::path targetFilePath;
+        // in the package's data once decrypted
+        gsl::span<uint8_t> decryptedBuffer;
+    };
 
-    // from PkgFileModel
-    std::vector<uc2::PkgFile*> GetRequiredPkgFiles(
+    using GetEntryTargetFn = std::function<bool( std::size_t, EntryTarget& )>;
+
+    // the texture decompression stage of a package's extraction
+    struct TextureQueue
+    {
+        std::deque<QueuedTexture> textures;
+        std::mutex lock;
+        std::condition_variable cond;
+    };
+
+    // served from the resident data when the package's file didn't change
+    bool LoadPkgFileData( const fs::path& pkgParentPath, PkgFileWork& work );
+
+    static void AddNodes( Snapshot& snapshot,
+                          const gsl::span<ArchiveBaseNode*> nodes );
+    static void AddFileNode( Snapshot& snapshot, ArchiveFileNode* pFileNode,
+                             const fs::path& nodeParentDir = {} );
+    static void AddDirectoryNode( Snapshot& snapshot,
+                                  ArchiveDirectoryNode* pDirNode,
+                                  const fs::path& parentNodePath = {} );
+
+    // extractPkgFile is run for each package, on several of them at once
+    bool ExtractPkgFilesParallel(
+        const std::vector<PkgFileId>& vPkgIds,
+        const std::function<bool( PkgFileWork& )>& extractPkgFile );
+
+    bool WriteNodesToDisk( PkgFileWork& work, const NodeWorkList& workList );
+    bool WriteEntriesParallel(
+        PkgFileWork& work, std::size_t iEntriesNum,
+        const std::function<uint64_t( std::size_t )>& getEntrySize,
+        const GetEntryTargetFn& getEntryTarget );
+    bool WriteBatch( PkgFileWork& work, std::size_t iBatchBegin,
+                     std::size_t iBatchEnd,
+                     const GetEntryTargetFn& getEntryTarget,
+                     TextureQueue& texQueue );
+
+    bool WritePackageToDisk( PkgFileWork& work );
+    // the caller holds the package's decryption lock if it's shared
+    bool DecryptPkgEntry( EntryTarget& target );
+    // the textures are decompressed right away without a queue
+    bool WriteDecryptedEntry( const PkgFileWork& work,
+                              const EntryTarget& target,
+                              fs::path& outResultPath,
+                              TextureQueue* pTexQueue = nullptr );
+    bool WriteTextureToDisk( QueuedTexture& texture );
+
+    void OnFileExtracted( const PkgFileWork& work, uc2::PkgEntry* pEntry,
+                          const fs::path& targetFilePath,
+                          const fs::path& resultFilePath,
+                          uint64_t iWrittenBytes );
+    void OnFilesSkipped( uint64_t iFilesNum, uint64_t iEntryBytes );
+    void OnPkgFileFailed( const PkgFileWork& work );
+    // may be called by the workers
+    void SetError( std::string szError );
+
+    // returns false if the package's files can't be checked against the
+    // manifest and journal, or if there's neither of them
+    bool BeginPkgFileSource( const fs::path& pkgParentPath,
+                             PkgFileWork& work );
+    bool IsTargetUpToDate( const PkgFileWork& work,
+                           const fs::path& targetFilePath,
+                           std::string_view entryPath,
+                           uint64_t iEntryBytes );
+    // for extractions of every package
+    bool IsPkgFileUpToDate( const PkgFileWork& work );
+
+    uint64_t GetNodeCost( ArchiveFileNode* pFileNode ) const noexcept;
+
+    static PkgOwnerSet GetRequiredPkgFiles(
         const gsl::span<ArchiveBaseNode*> nodes );
 
 private:
-    std::vector<uint8_t> m_vLoadedPkgFile;
-    // from PkgFileModel
-    const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>& m_PkgFiles;
+    // from the ArchiveTree
+    const LoadedPkgFiles& m_PkgFiles;
 
     fs::path m_OutPath;
 
-    std::vector<std::pair<fs::path, ArchiveFileNode*>> m_vOutNodesData;
+    std::atomic<int>& m_iExtractionProgress;
+    const CancellationToken& m_CancelToken;
+
+    BufferPool m_TexBufferPool;
 
-    int& m_iExtractionProgress;
+    WorkPriority m_Priority;
+    ExtractionStats* m_pStats;
+
+    ExtractionManifest* m_pManifest;
+    ExtractionJournal* m_pJournal;
 
     const bool m_bAllowDecryption;
     const bool m_bAllowDecompression;
 
+    // both guarded by m_ErrorLock
+    std::vector<std::string> m_vFailedPkgFiles;
+    std::string m_szLastError;
+    std::mutex m_ErrorLock;
+
 private:
     NodeExtractionMgr() = delete;
     NodeExtractionMgr& operator=( const NodeExtractionMgr& ) = delete;
     NodeExtractionMgr( const NodeExtractionMgr& ) = delete;
 };
 
-inline bool NodeExtractionMgr::HasAnyNodes() const
+inline int NodeExtractionMgr::GetExtractionProgress() const
 {
-    return this->m_vOutNodesData.empty() == false;
+    return this->m_iExtractionProgress;
 }
 
-inline int NodeExtractionMgr::GetExtractionProgress() const
+inline const std::vector<std::string>& NodeExtractionMgr::GetFailedPkgFiles()
+    const noexcept
 {
-    return this->m_iExtractionProgress;
+    return this->m_vFailedPkgFiles;
+}
+
+inline void NodeExtractionMgr::SetPriority( WorkPriority priority ) noexcept
+{
+    this->m_Priority = priority;
+}
+
+inline void NodeExtractionMgr::SetStats( ExtractionStats* pStats ) noexcept
+{
+    this->m_pStats = pStats;
+}
+
+inline void NodeExtractionMgr::SetManifest(
+    ExtractionManifest* pManifest ) noexcept
+{
+    this->m_pManifest = pManifest;
+}
+
+inline void NodeExtractionMgr::SetJournal(
+    ExtractionJournal* pJournal ) noexcept
+{
+    this->m_pJournal = pJournal;
 }
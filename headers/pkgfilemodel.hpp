@@ -6,6 +6,7 @@
 #include <QPersistentModelIndex>
 #include <QVariant>
 
+#include <atomic>
 #include <filesystem>
 #include <gsl/gsl>
 #include <unordered_map>
@@ -16,14 +17,39 @@ namespace fs = std::filesystem;
 #include <uc2/uc2.hpp>
 
 #include "archivedirectorynode.hpp"
+#include "archivefilenode.hpp"
+#include "archivetree.hpp"
+#include "cancellationtoken.hpp"
 #include "fileproperties.hpp"
 #include "gamedatainfo.hpp"
+#include "loadedpkgfiles.hpp"
+#include "pkgfilesystemshared.hpp"
 
 class ArchiveBaseNode;
 class ArchiveFileNode;
+class IndexMetadataCache;
 
 class StatusWidget;
 
+inline ArchiveBaseNode* IndexToGenericNode( const QModelIndex& index )
+{
+    return static_cast<ArchiveBaseNode*>( index.internalPointer() );
+}
+
+inline ArchiveFileNode* IndexToFileNode( const QModelIndex& index )
+{
+    return BaseToFileNode( IndexToGenericNode( index ) );
+}
+
+inline ArchiveDirectoryNode* IndexToDirectoryNode( const QModelIndex& index )
+{
+    return BaseToDirectoryNode( IndexToGenericNode( index ) );
+}
+
+//
+// Shows an ArchiveTree in the tree view, and keeps it sorted
+//
+
 class PkgFileModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -60,12 +86,17 @@ public:
     ArchiveBaseNode* GetNode( const QModelIndex& index ) const;
 
     bool LoadPackage( const fs::path& pkgPath, GameProvider provider,
-                      bool bIndependentLoad = true );
+                      bool bIndependentLoad = true,
+                      IndexMetadataCache* pMetadataCache = nullptr );
     bool LoadIndex( const fs::path& indexPath, GameProvider provider,
-                    int& outLoadProgress, std::size_t& outPkgNum );
+                    std::atomic<int>& outLoadProgress,
+                    std::atomic<int>& outPkgNum,
+                    const CancellationToken& cancelToken );
 
     bool IsIndexFileNode( const QModelIndex& index ) const noexcept;
 
+    inline void SetEntryFlagDetection( bool bEnabled ) noexcept;
+
     void ResetModel();
 
     //
@@ -81,8 +112,7 @@ public:
     inline std::size_t GetSelectedNodesCount() const;
     inline const FileProperties& GetCurrentFileProperties() const;
     inline const fs::path& GetCurrentParentPath() const;
-    inline const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>&
-    GetLoadedPkgFiles() const;
+    inline const LoadedPkgFiles& GetLoadedPkgFiles() const;
     inline std::vector<ArchiveBaseNode*> GetCopyOfSelectedNodes() const;
 
     inline const QString& GetError() const noexcept;
@@ -92,8 +122,7 @@ public:
     inline bool IsIndexLoaded() const noexcept;
 
 private:
-    void CreateChildren( const std::vector<uc2::PkgFile::entryptr_t>& pEntries,
-                         const fs::path& pkgPath );
+    QVariant GetNodeDisplayData( ArchiveBaseNode* pNode, int column ) const;
     void UpdateNodeChildren( const QModelIndex& index, const QVariant& value );
 
     inline int translateVisibleLocation( ArchiveDirectoryNode* parent,
@@ -110,16 +139,10 @@ private:
     void SetErrorQstr( const QString& err );
 
 private:
-    std::unordered_map<std::string, ArchiveDirectoryNode*> m_DirectoryNodes;
-    std::unordered_map<std::size_t, uc2::PkgFile::ptr_t> m_PkgFiles;
-
-    ArchiveDirectoryNode m_RootNode;
+    ArchiveTree m_Tree;
 
     std::unordered_set<ArchiveBaseNode*> m_SelectedNodes;
 
-    fs::path m_CurrentParentPath;
-    FileProperties m_CurFileProps;
-
     QString m_szLastError;
 
     int m_iSortColumn;
@@ -128,7 +151,6 @@ private:
 
     bool m_bGenerated;
     bool m_bIsBusy;
-    bool m_bIsIndexLoaded;
 };
 
 inline std::size_t PkgFileModel::GetSelectedNodesCount() const
@@ -138,18 +160,17 @@ inline std::size_t PkgFileModel::GetSelectedNodesCount() const
 
 inline const FileProperties& PkgFileModel::GetCurrentFileProperties() const
 {
-    return this->m_CurFileProps;
+    return this->m_Tree.GetFileProperties();
 }
 
 inline const fs::path& PkgFileModel::GetCurrentParentPath() const
 {
-    return this->m_CurrentParentPath;
+    return this->m_Tree.GetParentPath();
 }
 
-inline const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>&
-PkgFileModel::GetLoadedPkgFiles() const
+inline const LoadedPkgFiles& PkgFileModel::GetLoadedPkgFiles() const
 {
-    return this->m_PkgFiles;
+    return this->m_Tree.GetLoadedPkgFiles();
 }
 
 inline std::vector<ArchiveBaseNode*> PkgFileModel::GetCopyOfSelectedNodes()
@@ -163,6 +184,11 @@ inline const QString& PkgFileModel::GetError() const noexcept
     return this->m_szLastError;
 }
 
+inline void PkgFileModel::SetEntryFlagDetection( bool bEnabled ) noexcept
+{
+    this->m_Tree.SetEntryFlagDetection( bEnabled );
+}
+
 inline bool PkgFileModel::IsGenerated() const noexcept
 {
     return this->m_bGenerated;
@@ -175,7 +201,7 @@ inline bool PkgFileModel::IsBusy() const noexcept
 
 inline bool PkgFileModel::IsIndexLoaded() const noexcept
 {
-    return this->m_bIsIndexLoaded;
+    return this->m_Tree.IsIndexLoaded();
 }
 
 inline int PkgFileModel::translateVisibleLocation( ArchiveDirectoryNode* parent,
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+
+// dense index of a package in its ArchiveTree's LoadedPkgFiles
+using PkgFileId = std::size_t;
+
 enum PkgFsModelColumnEnum
 {
     PFS_FileNameColumn = 0,
@@ -8,3 +13,12 @@ enum PkgFsModelColumnEnum
     PFS_OwnerPkgColumn,
     PFS_NumColumns
 };
+
+// what EntryFlagDetection found out about a file entry
+enum EntryFlagsEnum
+{
+    EF_None = 0,
+    EF_Detected = 1 << 0,
+    EF_EncryptedFile = 1 << 1,
+    EF_LzmaTexture = 1 << 2
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <utility>
+
+#include "gamedatainfo.hpp"
+
+// the keys packages are encrypted with, per provider
+constexpr const std::array<std::string_view, 4> PACKAGE_ENTRY_KEYS = {
+    "lkgui781kl789sd!@#%89&^sd",  // Nexon
+    "\x9B\x65\xC7\x9B\xC7\xDF\x8E\x7E\xD4\xC6\x59\x52\x5C\xF7\x22\xFF\xF4\xE8\xFF\xE7\xB5\xC2\x77",  // Tiancity
+    "\x86\x39\x53\xBD\x16\x11\x6D\x06\x2A\x84\xF3\x4E\xE0\x4A\xA3",  // Beancity
+    "lkgui781kl789sd!@#%89&^sd",  // NexonJP
+};
+
+constexpr const std::array<std::string_view, 4> PACKAGE_DATA_KEYS = {
+    "^9gErg2Sx7bnk7@#sdfjnh@",  // Nexon
+    "\x8E\x5C\xB8\x92\x45\xD1\x90\xBA\x82\x0F\xD9\x7A\x99\x8E\xB3\x87\xF7",  // Tiancity
+    "\x1F\x9F\xF8\xF4\x18\xAC\x25\xA2\xBB\x37\x82\x6D\xA8\xAE\xA7\x28\xBA\xDD\xDD\xE4\x6B",  // Beancity
+    "^9gErg2Sx7bnk7@#sdfjnh@",  // NexonJP
+};
+
+constexpr const std::string_view TFO_PACKAGE_ENTRY_KEY =
+    "lkgui781kl789sd!@#%89&^sd";
+constexpr const std::string_view TFO_PACKAGE_DATA_KEY =
+    "^9gErg2Sx7bnk7@#sdfjnh@";
+
+inline constexpr std::pair<std::string_view, std::string_view>
+GetPackageKeysByProvider( GameProvider provider ) noexcept
+{
+    switch ( provider )
+    {
+        case GameProvider::Nexon:
+            return { PACKAGE_ENTRY_KEYS[0], PACKAGE_DATA_KEYS[0] };
+        case GameProvider::Tiancity:
+            return { PACKAGE_ENTRY_KEYS[1], PACKAGE_DATA_KEYS[1] };
+        case GameProvider::Beancity:
+            return { PACKAGE_ENTRY_KEYS[2], PACKAGE_DATA_KEYS[2] };
+        case GameProvider::NexonJP:
+            return { PACKAGE_ENTRY_KEYS[3], PACKAGE_DATA_KEYS[3] };
+        case GameProvider::Tfo:
+            return { TFO_PACKAGE_ENTRY_KEY, TFO_PACKAGE_DATA_KEY };
+        default:
+            return {};
+    }
+}
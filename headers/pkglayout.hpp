@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gamedatainfo.hpp"
+
+namespace fs = std::filesystem;
+
+// the longest path a package's header has room for, with its terminator
+constexpr const std::size_t PKG_ENTRY_PATH_MAX_LEN = 260;
+
+// a file of the directory tree and where it goes in its package
+struct PkgLayoutEntry
+{
+    fs::path sourcePath;
+    // starts with a slash, like the paths in a package's header
+    std::string szEntryPath;
+    uint64_t iSize;
+};
+
+struct PkgLayoutFile
+{
+    // 32 hex digits and ".pkg", like the game's packages
+    std::string szFilename;
+    std::vector<PkgLayoutEntry> vEntries;
+    uint64_t iTotalBytes = 0;
+};
+
+//
+// Splits a directory tree into the packages and index an archive made from
+// it would have, so fixtures and benchmarks can be laid out like the game's
+// data
+//
+// Only the layout is planned here, PkgWriter writes it
+//
+class PkgLayout
+{
+public:
+    static constexpr const uint64_t DEFAULT_MAX_PKG_FILE_BYTES =
+        64 * 1024 * 1024;
+
+    PkgLayout( GameProvider provider,
+               uint64_t iMaxPkgFileBytes = DEFAULT_MAX_PKG_FILE_BYTES );
+    ~PkgLayout() = default;
+
+public:
+    // a file bigger than the maximum gets a package of its own
+    bool AddDirectory( const fs::path& rootDir );
+
+    // in the order the index lists them
+    std::vector<std::string_view> GetIndexPkgFilenames() const;
+
+    inline const std::vector<PkgLayoutFile>& GetPkgFiles() const noexcept;
+    inline GameProvider GetProvider() const noexcept;
+    // TFO packages and indexes use their own keys
+    inline bool IsTfoLayout() const noexcept;
+
+    inline const std::string& GetError() const noexcept;
+
+private:
+    PkgLayoutFile& GetPkgFileWithRoom( uint64_t iEntrySize );
+    static std::string GetPkgFilename( std::size_t iPkgFileNum );
+
+private:
+    std::vector<PkgLayoutFile> m_vPkgFiles;
+
+    const GameProvider m_Provider;
+    const uint64_t m_iMaxPkgFileBytes;
+
+    std::string m_szLastError;
+
+private:
+    PkgLayout() = delete;
+};
+
+inline const std::vector<PkgLayoutFile>& PkgLayout::GetPkgFiles() const
+    noexcept
+{
+    return this->m_vPkgFiles;
+}
+
+inline GameProvider PkgLayout::GetProvider() const noexcept
+{
+    return this->m_Provider;
+}
+
+inline bool PkgLayout::IsTfoLayout() const noexcept
+{
+    return this->m_Provider == GameProvider::Tfo;
+}
+
+inline const std::string& PkgLayout::GetError() const noexcept
+{
+    return this->m_szLastError;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "pkgfilesystemshared.hpp"
+
+//
+// A compact set of package ids, stored as a bitset
+//
+// Directory nodes keep one of these with the owners of every file below
+// them, so the packages needed by a selection are a bitwise OR away
+//
+class PkgOwnerSet
+{
+public:
+    PkgOwnerSet() = default;
+    ~PkgOwnerSet() = default;
+
+public:
+    inline bool Insert( PkgFileId pkgId );
+    inline bool Contains( PkgFileId pkgId ) const noexcept;
+
+    inline void Merge( const PkgOwnerSet& other );
+
+    inline bool IsEmpty() const noexcept;
+    inline std::vector<PkgFileId> GetIds() const;
+
+    inline void Clear() noexcept;
+
+private:
+    static constexpr const std::size_t BITS_PER_WORD = 64;
+
+    std::vector<std::uint64_t> m_vWords;
+};
+
+// returns false if the id was already in the set
+inline bool PkgOwnerSet::Insert( PkgFileId pkgId )
+{
+    const std::size_t iWord = pkgId / BITS_PER_WORD;
+    const std::uint64_t iMask = std::uint64_t( 1 ) << ( pkgId % BITS_PER_WORD );
+
+    if ( iWord >= this->m_vWords.size() )
+    {
+        this->m_vWords.resize( iWord + 1, 0 );
+    }
+
+    if ( ( this->m_vWords[iWord] & iMask ) != 0 )
+    {
+        return false;
+    }
+
+    this->m_vWords[iWord] |= iMask;
+    return true;
+}
+
+inline bool PkgOwnerSet::Contains( PkgFileId pkgId ) const noexcept
+{
+    const std::size_t iWord = pkgId / BITS_PER_WORD;
+
+    if ( iWord >= this->m_vWords.size() )
+    {
+        return false;
+    }
+
+    const std::uint64_t iMask = std::uint64_t( 1 ) << ( pkgId % BITS_PER_WORD );
+    return ( this->m_vWords[iWord] & iMask ) != 0;
+}
+
+inline void PkgOwnerSet::Merge( const PkgOwnerSet& other )
+{
+    if ( other.m_vWords.size() > this->m_vWords.size() )
+    {
+        this->m_vWords.resize( other.m_vWords.size(), 0 );
+    }
+
+    for ( std::size_t i = 0; i < other.m_vWords.size(); i++ )
+    {
+        this->m_vWords[i] |= other.m_vWords[i];
+    }
+}
+
+inline bool PkgOwnerSet::IsEmpty() const noexcept
+{
+    for ( auto&& word : this->m_vWords )
+    {
+        if ( word != 0 )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the ids in ascending order
+inline std::vector<PkgFileId> PkgOwnerSet::GetIds() const
+{
+    std::vector<PkgFileId> vIds;
+
+    for ( std::size_t i = 0; i < this->m_vWords.size(); i++ )
+    {
+        std::uint64_t iWord = this->m_vWords[i];
+
+        for ( std::size_t iBit = 0; iWord != 0; iBit++, iWord >>= 1 )
+        {
+            if ( ( iWord & 1 ) != 0 )
+            {
+                vIds.push_back( i * BITS_PER_WORD + iBit );
+            }
+        }
+    }
+
+    return vIds;
+}
+
+inline void PkgOwnerSet::Clear() noexcept
+{
+    this->m_vWords.clear();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "md5.hpp"
+#include "pkglayout.hpp"
+
+namespace fs = std::filesystem;
+
+//
+// Writes the packages and index a PkgLayout planned, encrypted with its
+// provider's keys
+//
+// libuncso2 can only read these formats, so they're encoded here and every
+// package and the index are read back through libuncso2 once written,
+// unless verifying is turned off
+//
+class PkgWriter
+{
+public:
+    PkgWriter( const PkgLayout& layout, fs::path outDir );
+    ~PkgWriter() = default;
+
+public:
+    // .e* files are encrypted and .vtf textures compressed, unless they
+    // already are
+    inline void SetEncodeSpecialFiles( bool bEncode ) noexcept;
+    inline void SetVerification( bool bVerify ) noexcept;
+
+    bool Write();
+
+    inline uint64_t GetWrittenBytes() const noexcept;
+    inline const std::string& GetError() const noexcept;
+
+private:
+    bool WritePkgFile( const PkgLayoutFile& pkgFile );
+    bool WriteIndexFile();
+
+    bool LoadEntryData( const PkgLayoutEntry& entry,
+                        std::vector<uint8_t>& vOutData );
+
+    bool VerifyPkgFile( const PkgLayoutFile& pkgFile,
+                        const std::vector<Md5Digest>& vEntryDigests );
+    bool VerifyIndexFile();
+
+private:
+    const PkgLayout& m_Layout;
+    const fs::path m_OutDir;
+
+    bool m_bEncodeSpecialFiles;
+    bool m_bVerify;
+
+    uint64_t m_iWrittenBytes;
+    std::string m_szLastError;
+
+private:
+    PkgWriter() = delete;
+};
+
+inline void PkgWriter::SetEncodeSpecialFiles( bool bEncode ) noexcept
+{
+    this->m_bEncodeSpecialFiles = bEncode;
+}
+
+inline void PkgWriter::SetVerification( bool bVerify ) noexcept
+{
+    this->m_bVerify = bVerify;
+}
+
+inline uint64_t PkgWriter::GetWrittenBytes() const noexcept
+{
+    return this->m_iWrittenBytes;
+}
+
+inline const std::string& PkgWriter::GetError() const noexcept
+{
+    return this->m_szLastError;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+//
+// Keeps the files extracted for previews, so opening a recently previewed
+// file again doesn't extract it a second time
+//
+// Previews are addressed by a hash of their owner package's identity, their
+// path inside it and the extraction options, and each one lives in its own
+// directory under the cache's root. The least recently used previews are
+// removed once the cache holds more than its size limit
+//
+class PreviewCache
+{
+public:
+    PreviewCache( fs::path rootDir,
+                  std::uint64_t iMaxBytes = DEFAULT_MAX_BYTES );
+    ~PreviewCache() = default;
+
+public:
+    // the cached file's path, empty if the preview isn't cached
+    fs::path Find( const std::string& szKey );
+    // where a preview should be extracted to before it's inserted
+    fs::path GetPreviewDir( const std::string& szKey ) const;
+    void Insert( const std::string& szKey, const fs::path& filePath );
+
+    // fails if the owner package's identity can't be read
+    static bool MakeKey( const fs::path& pkgPath, std::string_view entryPath,
+                         bool bDecrypt, bool bDecompress,
+                         std::string& outKey );
+
+private:
+    void Remove( const std::string& szKey );
+    void Evict();
+
+private:
+    static constexpr const std::uint64_t DEFAULT_MAX_BYTES =
+        512 * 1024 * 1024;
+
+    struct CachedPreview
+    {
+        std::string szKey;
+        fs::path filePath;
+        std::uint64_t iSize;
+    };
+
+    fs::path m_RootDir;
+
+    // the most recently used first
+    std::list<CachedPreview> m_Previews;
+    std::unordered_map<std::string, std::list<CachedPreview>::iterator>
+        m_PreviewsByKey;
+
+    std::uint64_t m_iCachedBytes;
+    const std::uint64_t m_iMaxBytes;
+
+private:
+    PreviewCache& operator=( const PreviewCache& ) = delete;
+    PreviewCache( const PreviewCache& ) = delete;
+};
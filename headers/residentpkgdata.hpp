@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "indexmetadatacache.hpp"
+#include "pkgfilesystemshared.hpp"
+
+//
+// Keeps the data of recently extracted from packages in memory, so
+// previewing files from the same package doesn't read it from the disk
+// every time
+//
+// The data is kept as it's stored in the file, along with the stamp the
+// file had when it was read, so a package patched since isn't served from
+// its old data. A package's buffer gets decrypted in place when it's
+// extracted from, so extractions work on their own copy of it
+//
+// The least recently used packages are dropped once the cache holds more
+// than its size limit. Thread safe
+//
+class ResidentPkgData
+{
+public:
+    using data_t = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+public:
+    ResidentPkgData( std::uint64_t iMaxBytes = DEFAULT_MAX_BYTES );
+    ~ResidentPkgData() = default;
+
+public:
+    // nullptr if the package isn't resident, or if its file changed since
+    data_t Find( PkgFileId pkgId, const PkgFileStamp& stamp );
+    // stamp is the one the package's file had when pData was read
+    void Insert( PkgFileId pkgId, const PkgFileStamp& stamp, data_t pData );
+    void Clear() noexcept;
+
+private:
+    struct ResidentPkgFile
+    {
+        PkgFileId pkgId;
+        PkgFileStamp stamp;
+        data_t pData;
+    };
+
+    void Evict();
+    void Erase( std::list<ResidentPkgFile>::iterator it );
+
+private:
+    static constexpr const std::uint64_t DEFAULT_MAX_BYTES =
+        256 * 1024 * 1024;
+
+    std::mutex m_Lock;
+
+    // the most recently used first
+    std::list<ResidentPkgFile> m_PkgFiles;
+    std::unordered_map<PkgFileId, std::list<ResidentPkgFile>::iterator>
+        m_PkgFilesById;
+
+    std::uint64_t m_iResidentBytes;
+    const std::uint64_t m_iMaxBytes;
+
+private:
+    ResidentPkgData& operator=( const ResidentPkgData& ) = delete;
+    ResidentPkgData( const ResidentPkgData& ) = delete;
+};
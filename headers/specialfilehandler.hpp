@@ -6,17 +6,27 @@
 
 #include <gsl/gsl>
 
+#include "bufferpool.hpp"
+
 namespace fs = std::filesystem;
 
 class SpecialFileHandler
 {
 public:
     SpecialFileHandler( gsl::span<std::uint8_t> fileData, fs::path filePath,
-                        bool canDecrypt, bool canDecompress );
+                        bool canDecrypt, bool canDecompress,
+                        BufferPool& texBufferPool );
+    SpecialFileHandler( SpecialFileHandler&& other ) = default;
     ~SpecialFileHandler();
 
 public:
     gsl::span<std::uint8_t> ProcessData();
+
+    // the two steps of ProcessData, so decompression can be done elsewhere
+    gsl::span<std::uint8_t> ProcessDecryption();
+    bool ShouldDecompress() const;
+    gsl::span<std::uint8_t> ProcessDecompression();
+
     inline fs::path GetNewFilePath() const;
 
 private:
@@ -24,7 +34,7 @@ private:
     bool IsTextureCompressed() const;
 
     gsl::span<std::uint8_t> DecryptFile();
-    gsl::span<std::uint8_t> DecompressTexture() const;
+    gsl::span<std::uint8_t> DecompressTexture();
 
     static void FixDecryptedExtension( fs::path& filePath );
 
@@ -32,6 +42,10 @@ private:
     gsl::span<std::uint8_t> m_FileData;
     fs::path m_FilePath;
 
+    // holds the decompressed texture until the handler is done with
+    BufferPool& m_TexBufferPool;
+    BufferPool::Buffer m_TexBuffer;
+
     const bool m_bAllowDecryption;
     const bool m_bAllowDecompression;
 
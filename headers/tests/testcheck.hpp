@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+//
+// What the archive core's tests are made of
+//
+// A failed check is reported and the test goes on, so a run shows every
+// failure, and the test's exit code tells ctest whether one failed
+//
+inline int g_iFailedChecks = 0;
+
+#define UC2_CHECK( condition )                                              \
+    do                                                                      \
+    {                                                                       \
+        if ( ( condition ) == false )                                       \
+        {                                                                   \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " << #condition \
+                      << " failed\n";                                       \
+            g_iFailedChecks++;                                              \
+        }                                                                   \
+    } while ( false )
+
+inline int GetTestResult() noexcept
+{
+    return g_iFailedChecks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// an empty directory of the test's own, removed with it
+class TestDirectory
+{
+public:
+    TestDirectory( std::string_view name )
+    {
+        std::error_code errorCode;
+        this->m_Path = fs::temp_directory_path( errorCode ) /
+                       ( "uc2-test-" + std::string( name ) );
+
+        fs::remove_all( this->m_Path, errorCode );
+        fs::create_directories( this->m_Path, errorCode );
+    }
+
+    ~TestDirectory()
+    {
+        std::error_code errorCode;
+        fs::remove_all( this->m_Path, errorCode );
+    }
+
+    inline const fs::path& GetPath() const noexcept;
+
+private:
+    fs::path m_Path;
+
+    TestDirectory& operator=( const TestDirectory& ) = delete;
+    TestDirectory( const TestDirectory& ) = delete;
+};
+
+inline const fs::path& TestDirectory::GetPath() const noexcept
+{
+    return this->m_Path;
+}
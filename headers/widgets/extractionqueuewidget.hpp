@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QDockWidget>
+
+class QProgressBar;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+class ExtractionQueue;
+struct ThroughputSample;
+
+//
+// Lists the extractions in ExtractionQueue with their progress, and lets
+// them be cancelled
+//
+class ExtractionQueueWidget : public QDockWidget
+{
+    Q_OBJECT
+public:
+    ExtractionQueueWidget( ExtractionQueue& queue, QWidget* pParent = nullptr );
+
+private slots:
+    void OnJobQueued( int iJobId, const QString& szName, int iFilesNum );
+    void OnJobStarted( int iJobId );
+    void OnJobProgress( int iJobId, int iProgress );
+    void OnJobMaxProgress( int iJobId, int iMaxProgress );
+    void OnJobThroughput( int iJobId, const ThroughputSample& sample );
+    void OnJobFinished( int iJobId, bool bSucceeded, bool bCancelled,
+                        const QString& szError );
+
+    void OnCancelClick();
+    void OnClearFinishedClick();
+
+private:
+    QTreeWidgetItem* FindJobItem( int iJobId ) const;
+    QProgressBar* GetJobProgressBar( QTreeWidgetItem* pItem ) const;
+
+private:
+    ExtractionQueue& m_Queue;
+
+    QTreeWidget* m_pJobList;
+    QPushButton* m_pCancelButton;
+    QPushButton* m_pClearButton;
+};
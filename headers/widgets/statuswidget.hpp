@@ -2,24 +2,39 @@
 
 #include <gsl/gsl>
 
+#include <QCoreApplication>
+
 class QLabel;
 class QProgressBar;
-class QString;
+class QPushButton;
+
+struct ThroughputSample;
 
 class StatusWidget
 {
+    Q_DECLARE_TR_FUNCTIONS( StatusWidget )
+
 public:
     StatusWidget( gsl::not_null<QLabel*> pLabel,
-                  gsl::not_null<QProgressBar*> pProgressBar );
+                  gsl::not_null<QLabel*> pThroughputLabel,
+                  gsl::not_null<QProgressBar*> pProgressBar,
+                  gsl::not_null<QPushButton*> pCancelButton );
 
 public:
     void SetLabel( const QString& szNewLabel );
     void SetMargins( int iMinProgress, int iMaxProgress );
     void SetProgressNum( int iNewProgress );
+    void SetThroughput( const ThroughputSample& sample );
+
+    void SetCancelable( bool bCancelable );
 
     void SetVisible( bool bVisible );
 
+    static QString FormatThroughput( const ThroughputSample& sample );
+
 private:
     gsl::not_null<QLabel*> m_pLabel;
+    gsl::not_null<QLabel*> m_pThroughputLabel;
     gsl::not_null<QProgressBar*> m_pProgressBar;
+    gsl::not_null<QPushButton*> m_pCancelButton;
 };
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class WorkPriority
+{
+    // something the user is waiting to see, like a preview
+    Interactive = 0,
+    // long running work, like extractions
+    Background,
+
+    Count
+};
+
+//
+// A set of threads kept alive for the whole process, shared by every
+// parallel job instead of each of them creating its own threads
+//
+// Background work may only take all but one of the threads, so there's
+// always one left for interactive work
+//
+class WorkerPool
+{
+public:
+    WorkerPool( std::size_t iThreadsNum );
+    ~WorkerPool();
+
+public:
+    static WorkerPool& GetShared();
+
+    // only has an effect before the shared pool is first used,
+    // zero uses a thread per hardware thread
+    static void SetSharedThreadsNum( std::size_t iThreadsNum ) noexcept;
+
+    //
+    // Runs iCopiesNum copies of job at the same time (as long as there are
+    // enough free threads) and returns once every copy has returned
+    //
+    // The calling thread runs a copy too, and runs the copies that weren't
+    // picked up by the pool while it waits, so it never waits on a copy that
+    // nobody is running
+    //
+    void RunConcurrently( std::size_t iCopiesNum, WorkPriority priority,
+                          const std::function<void()>& job );
+
+    inline std::size_t GetThreadsNum() const noexcept;
+
+private:
+    struct JobGroup
+    {
+        const std::function<void()>& job;
+        WorkPriority priority;
+
+        // both guarded by m_Lock
+        std::size_t iUnstartedCopies;
+        std::size_t iUnfinishedCopies;
+
+        std::exception_ptr pFirstError;
+    };
+
+    void WorkerLoop();
+
+    // these expect m_Lock to be held
+    JobGroup* TakeNextCopy();
+    void RemoveGroup( JobGroup* pGroup );
+
+    void RunCopy( JobGroup& group ) noexcept;
+
+    std::size_t GetMaxBackgroundWorkers() const noexcept;
+
+private:
+    const std::size_t m_iThreadsNum;
+    std::vector<std::thread> m_vThreads;
+
+    std::mutex m_Lock;
+    // woken up when there are new copies to run or when a group finishes
+    std::condition_variable m_WorkCond;
+
+    std::array<std::deque<JobGroup*>,
+               static_cast<std::size_t>( WorkPriority::Count )>
+        m_Lanes;
+    std::size_t m_iBackgroundWorkers;
+
+    bool m_bStopping;
+
+private:
+    WorkerPool& operator=( const WorkerPool& ) = delete;
+    WorkerPool( const WorkerPool& ) = delete;
+};
+
+inline std::size_t WorkerPool::GetThreadsNum() const noexcept
+{
+    return this->m_iThreadsNum;
+}
@@ -55,6 +55,7 @@ void ArchiveDirectoryNode::FreeChildren()
     }
 
     this->m_vChildNodes.clear();
+    this->m_OwnerPkgs.Clear();
 }
 
 ArchiveBaseNode* ArchiveDirectoryNode::GetChildContaining(
@@ -88,24 +89,6 @@ int ArchiveDirectoryNode::GetLocationOf( const ArchiveBaseNode* pChild ) const
     return std::numeric_limits<int>::max();
 }
 
-QVariant ArchiveDirectoryNode::GetData( int column )
-{
-    switch ( column )
-    {
-        case PFS_FileNameColumn:
-            return QString::fromStdString(
-                this->GetPath().filename().generic_string() );
-        case PFS_TypeColumn:
-            return tr( "Directory" );
-        case PFS_SizeColumn:
-            return {};
-        case PFS_OwnerPkgColumn:
-            return {};
-    }
-
-    return QVariant();
-}
-
 int ArchiveDirectoryNode::GetRow() const
 {
     if ( this->m_pParentNode )
@@ -127,21 +110,15 @@ bool ArchiveDirectoryNode::IsDirectory() const
     return true;
 }
 
-std::set<std::string_view> ArchiveDirectoryNode::GetChildrenPkgOwners() const
+void ArchiveDirectoryNode::AddOwnerPkg( PkgFileId pkgId )
 {
-    std::set<std::string_view> vChildrenPkgOwners;
-
-    if ( this->HasChildren() == true )
+    // if a directory already has the owner, so do all of its parents
+    for ( ArchiveDirectoryNode* pCurNode = this; pCurNode != nullptr;
+          pCurNode = pCurNode->GetParentNode() )
     {
-        for ( auto&& child : this->m_vChildNodes )
+        if ( pCurNode->m_OwnerPkgs.Insert( pkgId ) == false )
         {
-            if ( child->IsDirectory() == false )
-            {
-                auto pFileChild = static_cast<ArchiveFileNode*>( child );
-                vChildrenPkgOwners.insert( pFileChild->GetOwnerPkgFilename() );
-            }
+            break;
         }
     }
-
-    return vChildrenPkgOwners;
 }
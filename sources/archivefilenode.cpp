@@ -1,46 +1,25 @@
 #include "archivefilenode.hpp"
 
-#include <QLocale>
-
-#include <gsl/gsl>
-
 #include <string>
 
-#include <uc2/pkgentry.hpp>
-
+#include "entryflagdetection.hpp"
+#include "indexmetadatacache.hpp"
 #include "pkgfilesystemshared.hpp"
 
 ArchiveFileNode::ArchiveFileNode(
-    const fs::path& ownerPkgPath, uc2::PkgEntry* pPkgEntry,
+    const fs::path& ownerPkgPath, PkgFileId ownerPkgId,
+    std::size_t iEntryIndex, const PkgEntryMetadata& entry,
     ArchiveDirectoryNode* pParentNode /*= nullptr*/ )
-    : ArchiveBaseNode( pPkgEntry->GetFilePath(), pParentNode ),
+    : ArchiveBaseNode( entry.szFilePath, pParentNode ),
       m_szOwnerPkgFilename( ownerPkgPath.filename().generic_string() ),
-      m_pPkgEntry( pPkgEntry ),
-      m_iDecryptedSize( pPkgEntry->GetDecryptedSize() )
+      m_iOwnerPkgId( ownerPkgId ), m_iEntryIndex( iEntryIndex ),
+      m_iDecryptedSize( entry.iDecryptedSize ),
+      m_iEntryFlags( entry.iEntryFlags )
 {
 }
 
 ArchiveFileNode::~ArchiveFileNode() {}
 
-QVariant ArchiveFileNode::GetData( int column )
-{
-    switch ( column )
-    {
-        case PFS_FileNameColumn:
-            return QString::fromStdString(
-                this->GetPath().filename().generic_string() );
-        case PFS_TypeColumn:
-            return this->GetFileTypeColumnString();
-        case PFS_SizeColumn:
-            return QLocale::system().formattedDataSize(
-                gsl::narrow_cast<qint64>( this->GetDecryptedSize() ) );
-        case PFS_OwnerPkgColumn:
-            return QString( this->GetOwnerPkgFilename().data() );
-    }
-
-    return QVariant();
-}
-
 uint64_t ArchiveFileNode::GetDecryptedSize() const
 {
     return this->m_iDecryptedSize;
@@ -51,13 +30,24 @@ std::string_view ArchiveFileNode::GetOwnerPkgFilename() const
     return this->m_szOwnerPkgFilename;
 }
 
-bool ArchiveFileNode::IsDirectory() const
+void ArchiveFileNode::SetEntryFlags( const EntryFlagDetection& detection )
 {
-    return false;
+    std::uint8_t iNewFlags = EF_Detected;
+
+    if ( detection.IsEncryptedFile() == true )
+    {
+        iNewFlags |= EF_EncryptedFile;
+    }
+
+    if ( detection.IsLzmaTexture() == true )
+    {
+        iNewFlags |= EF_LzmaTexture;
+    }
+
+    this->m_iEntryFlags = iNewFlags;
 }
 
-QString ArchiveFileNode::GetFileTypeColumnString() const
+bool ArchiveFileNode::IsDirectory() const
 {
-    QString typeFmt( tr( "%1 file" ) );
-    return typeFmt.arg( this->GetPath().extension().c_str() );
+    return false;
 }
@@ -0,0 +1,517 @@
+#include "archivetree.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <gsl/gsl>
+
+#include <uc2/pkgentry.hpp>
+#include <uc2/pkgfile.hpp>
+#include <uc2/pkgindex.hpp>
+
+#include "archivefilenode.hpp"
+#include "entryflagdetection.hpp"
+
+#include "corelog.hpp"
+#include "dynindexfilefactory.hpp"
+#include "dynpkgfilefactory.hpp"
+#include "fsutils.hpp"
+#include "indexmetadatacache.hpp"
+#include "miscutils.hpp"
+#include "workerpool.hpp"
+
+ArchiveTree::ArchiveTree()
+    : m_DirectoryNodes(), m_RootNode( "" ), m_bIsIndexLoaded( false ),
+      m_bDetectEntryFlags( false )
+{
+}
+
+ArchiveTree::~ArchiveTree()
+{
+    this->Clear();
+}
+
+struct ArchiveTree::PendingDetection
+{
+    PkgFileId iPkgId;
+    fs::path pkgPath;
+    std::vector<ArchiveFileNode*> vFileNodes;
+
+    // stored in the metadata cache with the entry types, when stamped
+    PkgFileMetadata metadata;
+    bool bStamped;
+};
+
+//
+// Decrypts the start of every entry in a package to find out which ones
+// are special files, so extractions know them before decrypting anything
+//
+// The package's whole data must be loaded, since its header only tells us
+// where the entries are
+//
+static void DetectEntryFlags( uc2::PkgFile* pPkgFile,
+                              const std::vector<ArchiveFileNode*>& vFileNodes )
+{
+    for ( ArchiveFileNode* pFileNode : vFileNodes )
+    {
+        EntryFlagDetection detection(
+            pPkgFile->GetEntries()[pFileNode->GetEntryIndex()].get() );
+        pFileNode->SetEntryFlags( detection );
+    }
+}
+
+// for packages that were only loaded up to their full header
+static bool ReadAndDetectEntryFlags(
+    uc2::PkgFile* pPkgFile, const fs::path& pkgPath,
+    const std::vector<ArchiveFileNode*>& vFileNodes )
+{
+    auto [bPkgRead, vPkgData] = ReadFileToBuffer( pkgPath );
+
+    if ( bPkgRead == false )
+    {
+        return false;
+    }
+
+    auto releaseData =
+        gsl::finally( [pPkgFile]() { pPkgFile->ReleaseDataBuffer(); } );
+
+    try
+    {
+        pPkgFile->SetDataBuffer( vPkgData );
+
+        if ( pPkgFile->DecryptHeader() == false || pPkgFile->Parse() == false )
+        {
+            return false;
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( e.what() );
+        return false;
+    }
+
+    DetectEntryFlags( pPkgFile, vFileNodes );
+    return true;
+}
+
+static PkgFileMetadata GetParsedPkgFileMetadata( uc2::PkgFile* pPkgFile )
+{
+    auto& vEntries = pPkgFile->GetEntries();
+
+    PkgFileMetadata metadata;
+    metadata.vEntries.reserve( vEntries.size() );
+
+    for ( auto&& pEntry : vEntries )
+    {
+        metadata.vEntries.push_back(
+            { std::string( pEntry->GetFilePath() ), pEntry->GetDecryptedSize(),
+              pEntry->IsEncrypted(), EF_None } );
+    }
+
+    return metadata;
+}
+
+static PkgFileSummary SummarizePkgFile( const PkgFileMetadata& metadata )
+{
+    PkgFileSummary summary;
+    summary.iEntriesNum = metadata.vEntries.size();
+
+    for ( auto&& entry : metadata.vEntries )
+    {
+        if ( entry.bEncrypted == true )
+        {
+            summary.iEncryptedNum++;
+        }
+
+        summary.iDecryptedBytes += entry.iDecryptedSize;
+    }
+
+    return summary;
+}
+
+bool ArchiveTree::LoadPackage(
+    const fs::path& pkgPath, GameProvider provider,
+    bool bIndependentLoad /*= true*/,
+    IndexMetadataCache* pMetadataCache /*= nullptr*/ )
+{
+    return this->LoadPackageInternal( pkgPath, provider, bIndependentLoad,
+                                      pMetadataCache, nullptr );
+}
+
+bool ArchiveTree::LoadPackageInternal(
+    const fs::path& pkgPath, GameProvider provider, bool bIndependentLoad,
+    IndexMetadataCache* pMetadataCache,
+    std::vector<PendingDetection>* pvPendingDetections )
+{
+    uc2::PkgFile::ptr_t pPkgFile;
+    PkgFileSummary pkgSummary;
+    const PkgFileId iNewPkgId = this->m_PkgFiles.GetCount();
+
+    try
+    {
+        const std::string szPkgFilename = pkgPath.filename().generic_string();
+
+        PkgFileStamp pkgStamp;
+        const bool bStamped =
+            pMetadataCache != nullptr &&
+            IndexMetadataCache::ReadPkgFileStamp( pkgPath, pkgStamp ) == true;
+
+        const PkgFileMetadata* pCachedMetadata =
+            bStamped == true ? pMetadataCache->Find( szPkgFilename, pkgStamp )
+                             : nullptr;
+
+        // the cached entry types can't be used if they weren't detected
+        if ( pCachedMetadata != nullptr && this->m_bDetectEntryFlags == true &&
+             pCachedMetadata->AreEntryFlagsDetected() == false )
+        {
+            pCachedMetadata = nullptr;
+        }
+
+        if ( pCachedMetadata != nullptr )
+        {
+            // only the base header is decrypted, the package gets parsed
+            // when it's extracted from
+            DynamicPkgFileFactory f(
+                pkgPath, provider,
+                DynamicPkgFileFactory::LoadMode::BaseHeader );
+            pPkgFile = f.GetPkgFileOwnership();
+
+            assert( pPkgFile != nullptr );
+
+            pPkgFile->ReleaseDataBuffer();
+
+            this->CreateChildren( pCachedMetadata->vEntries, pkgPath,
+                                  iNewPkgId );
+            pkgSummary = SummarizePkgFile( *pCachedMetadata );
+        }
+        else
+        {
+            // the whole package is only read when its entry types are
+            // detected right away, from the factory's data
+            const bool bDetectNow = this->m_bDetectEntryFlags == true &&
+                                    pvPendingDetections == nullptr;
+
+            DynamicPkgFileFactory f(
+                pkgPath, provider,
+                bDetectNow == true
+                    ? DynamicPkgFileFactory::LoadMode::WholeFile
+                    : DynamicPkgFileFactory::LoadMode::FullHeader );
+            pPkgFile = f.GetPkgFileOwnership();
+
+            assert( pPkgFile != nullptr );
+
+            pPkgFile->Parse();
+
+            PkgFileMetadata pkgMetadata =
+                GetParsedPkgFileMetadata( pPkgFile.get() );
+            auto vNewNodes = this->CreateChildren( pkgMetadata.vEntries,
+                                                   pkgPath, iNewPkgId );
+
+            if ( bDetectNow == true )
+            {
+                DetectEntryFlags( pPkgFile.get(), vNewNodes );
+            }
+
+            if ( bIndependentLoad == true )
+            {
+                this->m_FileProps.SetPkgFileProperties( f.GetProvider(),
+                                                        pPkgFile.get() );
+            }
+
+            pPkgFile->ReleaseDataBuffer();
+
+            pkgSummary = SummarizePkgFile( pkgMetadata );
+
+            if ( bStamped == true )
+            {
+                pkgMetadata.stamp = pkgStamp;
+            }
+
+            if ( this->m_bDetectEntryFlags == true && bDetectNow == false )
+            {
+                pvPendingDetections->push_back(
+                    { iNewPkgId, pkgPath, std::move( vNewNodes ),
+                      std::move( pkgMetadata ), bStamped } );
+            }
+            else if ( bStamped == true )
+            {
+                for ( std::size_t i = 0; i < vNewNodes.size(); i++ )
+                {
+                    pkgMetadata.vEntries[i].iEntryFlags =
+                        vNewNodes[i]->GetEntryFlags();
+                }
+
+                pMetadataCache->Store( szPkgFilename,
+                                       std::move( pkgMetadata ) );
+            }
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( e.what() );
+        this->m_szLastError = e.what();
+        return false;
+    }
+
+    this->m_PkgFiles.Add( std::move( pPkgFile ), pkgSummary );
+
+    if ( bIndependentLoad == true )
+    {
+        this->m_ParentPath = pkgPath.parent_path();
+    }
+
+    return true;
+}
+
+bool ArchiveTree::LoadIndex( const fs::path& indexPath, GameProvider provider,
+                             const fs::path& metadataCacheDir,
+                             std::atomic<int>& outLoadProgress,
+                             std::atomic<int>& outPkgNum,
+                             const CancellationToken& cancelToken )
+{
+    auto [bIndexRead, vIndexData] = ReadFileToBuffer( indexPath );
+
+    if ( bIndexRead == false )
+    {
+        this->m_szLastError = "Could not read index file";
+        return false;
+    }
+
+    uc2::PkgIndex::ptr_t pIndex;
+
+    try
+    {
+        DynamicIndexFileFactory f( indexPath, vIndexData );
+        pIndex = f.GetPkgIndexOwnership();
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( e.what() );
+    }
+
+    if ( !pIndex )
+    {
+        this->m_szLastError = "Could not detect index's game provider";
+        return false;
+    }
+
+    auto fileEntries = DynamicIndexFileFactory::GetPkgFilenames( pIndex.get() );
+    fs::path indexParentPath = indexPath.parent_path();
+
+    IndexMetadataCache metadataCache( metadataCacheDir, indexPath, provider );
+    IndexMetadataCache* pMetadataCache = nullptr;
+
+    if ( metadataCacheDir.empty() == false )
+    {
+        metadataCache.Load();
+        pMetadataCache = &metadataCache;
+    }
+
+    outPkgNum = gsl::narrow_cast<int>( fileEntries.size() );
+
+    std::vector<PendingDetection> vPendingDetections;
+
+    for ( auto&& entryFilename : fileEntries )
+    {
+        if ( cancelToken.IsCancelled() == true )
+        {
+            this->m_szLastError = "The index's loading was cancelled";
+            return false;
+        }
+
+        fs::path fullEntryPath = indexParentPath;
+        fullEntryPath /= entryFilename;
+
+        if ( this->LoadPackageInternal( fullEntryPath, provider, false,
+                                        pMetadataCache,
+                                        &vPendingDetections ) == false )
+        {
+            return false;
+        }
+
+        outLoadProgress++;
+    }
+
+    if ( vPendingDetections.empty() == false )
+    {
+        this->DetectPendingEntryFlags( vPendingDetections, cancelToken );
+
+        if ( cancelToken.IsCancelled() == true )
+        {
+            this->m_szLastError = "The index's loading was cancelled";
+            return false;
+        }
+
+        for ( auto&& pending : vPendingDetections )
+        {
+            if ( pending.bStamped == false )
+            {
+                continue;
+            }
+
+            for ( std::size_t i = 0; i < pending.vFileNodes.size(); i++ )
+            {
+                pending.metadata.vEntries[i].iEntryFlags =
+                    pending.vFileNodes[i]->GetEntryFlags();
+            }
+
+            pMetadataCache->Store(
+                pending.pkgPath.filename().generic_string(),
+                std::move( pending.metadata ) );
+        }
+    }
+
+    this->m_FileProps.SetIndexFileProperties( provider, this->m_PkgFiles );
+
+    if ( pMetadataCache != nullptr )
+    {
+        pMetadataCache->Save();
+    }
+
+    this->m_ParentPath = indexParentPath;
+    this->m_bIsIndexLoaded = true;
+
+    return true;
+}
+
+//
+// Detects the entry types of an index's packages once all of them are
+// loaded, several packages at once on the background lane, so the index's
+// loading doesn't read each package whole one after the other
+//
+void ArchiveTree::DetectPendingEntryFlags(
+    std::vector<PendingDetection>& vPendingDetections,
+    const CancellationToken& cancelToken )
+{
+    std::atomic<std::size_t> iNextPkg = 0;
+
+    auto worker = [this, &vPendingDetections, &cancelToken, &iNextPkg]() {
+        for ( std::size_t i = iNextPkg++; i < vPendingDetections.size();
+              i = iNextPkg++ )
+        {
+            if ( cancelToken.IsCancelled() == true )
+            {
+                return;
+            }
+
+            const PendingDetection& pending = vPendingDetections[i];
+            uc2::PkgFile* pPkgFile = this->m_PkgFiles.Get( pending.iPkgId );
+            auto dataLock = this->m_PkgFiles.LockData( pending.iPkgId );
+
+            // the entries are left without their types
+            if ( ReadAndDetectEntryFlags( pPkgFile, pending.pkgPath,
+                                          pending.vFileNodes ) == false )
+            {
+                LogWarning( "Could not detect the entry types of",
+                            pending.pkgPath.generic_string() );
+            }
+        }
+    };
+
+    WorkerPool& workerPool = WorkerPool::GetShared();
+    workerPool.RunConcurrently(
+        std::min( workerPool.GetThreadsNum(), vPendingDetections.size() ),
+        WorkPriority::Background, worker );
+}
+
+void ArchiveTree::Clear()
+{
+    this->m_DirectoryNodes.clear();
+    this->m_PkgFiles.Clear();
+
+    this->m_RootNode.FreeChildren();
+
+    this->m_ParentPath.clear();
+    this->m_bIsIndexLoaded = false;
+}
+
+ArchiveBaseNode* ArchiveTree::FindNode( std::string_view nodePath )
+{
+    ArchiveBaseNode* pNode = &this->m_RootNode;
+    std::string szCurPath;
+
+    // the nodes' paths are made of every directory above them
+    for ( auto&& part : fs::path( nodePath ).relative_path() )
+    {
+        if ( part.empty() == true )
+        {
+            continue;
+        }
+
+        auto pDirNode = BaseToDirectoryNode( pNode );
+
+        if ( pDirNode == nullptr )
+        {
+            return nullptr;
+        }
+
+        szCurPath += '/';
+        szCurPath += part.generic_string();
+
+        pNode = pDirNode->GetChildContaining( szCurPath );
+
+        if ( pNode == nullptr )
+        {
+            return nullptr;
+        }
+    }
+
+    return pNode;
+}
+
+std::vector<ArchiveFileNode*> ArchiveTree::CreateChildren(
+    const std::vector<PkgEntryMetadata>& vEntries, const fs::path& pkgPath,
+    PkgFileId pkgId )
+{
+    auto pParent = &this->m_RootNode;
+
+    // A PKG file has files from only one directory
+    // But a directory might come from multiple PKG files
+    const fs::path filePath = vEntries[0].szFilePath;
+
+    auto pathBegin = filePath.begin();
+    auto pathEnd = filePath.end();
+    auto pathLast = --pathEnd;
+
+    // skip root directory
+    size_t iCurIndex = 1;
+    pathBegin++;
+
+    for ( auto it = pathBegin; it != pathLast; it++ )
+    {
+        const fs::path subPath = *it;
+        std::string szPathName = PathStrFromIterators( pathBegin, it );
+
+        auto search = this->m_DirectoryNodes[szPathName];
+
+        if ( search != nullptr )
+        {
+            pParent = search;
+        }
+        else
+        {
+            auto pNewParent = new ArchiveDirectoryNode( szPathName, pParent );
+            this->m_DirectoryNodes[szPathName] = pNewParent;
+            pParent->AddChild( pNewParent );
+            pParent = pNewParent;
+        }
+
+        iCurIndex++;
+    }
+
+    std::vector<ArchiveFileNode*> vNewNodes;
+    vNewNodes.reserve( vEntries.size() );
+
+    for ( std::size_t i = 0; i < vEntries.size(); i++ )
+    {
+        auto pNewNode =
+            new ArchiveFileNode( pkgPath, pkgId, i, vEntries[i], pParent );
+        pParent->AddChild( pNewNode );
+        vNewNodes.push_back( pNewNode );
+    }
+
+    pParent->AddOwnerPkg( pkgId );
+
+    return vNewNodes;
+}
+
@@ -0,0 +1,158 @@
+#include "backgroundjob.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <QDebug>
+#include <QRunnable>
+#include <QThreadPool>
+
+// how often the progress may be sent, about the display's rate
+constexpr const std::chrono::milliseconds PROGRESS_REPORT_INTERVAL( 33 );
+// in progress reports, the throughput is sent less often so it can be read
+constexpr const int THROUGHPUT_REPORT_INTERVAL = 15;
+// the maximum of a progress weighted by bytes
+constexpr const int BYTES_PROGRESS_MAX = 1000;
+
+class BackgroundJobRunnable : public QRunnable
+{
+public:
+    BackgroundJobRunnable( BackgroundJob& job ) : m_Job( job ) {}
+
+    virtual void run() override
+    {
+        this->m_Job.RunInWorker();
+    }
+
+private:
+    BackgroundJob& m_Job;
+};
+
+BackgroundJob::BackgroundJob( job_t job )
+    : m_Job( std::move( job ) ), m_iProgress( 0 ), m_iMaxProgress( 0 ),
+      m_ThroughputMeter( m_Stats ), m_iReportsNum( 0 ),
+      m_iReportedProgress( 0 ), m_iReportedMaxProgress( 0 ),
+      m_bJobReturned( false ), m_bResult( false ), m_bRunning( false )
+{
+    qRegisterMetaType<ThroughputSample>();
+
+    // queued, so it's handled by the thread that started the job
+    this->connect( this, &BackgroundJob::finished, this,
+                   &BackgroundJob::OnFinished, Qt::QueuedConnection );
+}
+
+BackgroundJob::~BackgroundJob()
+{
+    // the worker still references us
+    Q_ASSERT( this->m_bRunning == false );
+}
+
+void BackgroundJob::Start()
+{
+    Q_ASSERT( this->m_bRunning == false );
+
+    this->m_bRunning = true;
+    this->m_bJobReturned = false;
+    QThreadPool::globalInstance()->start( new BackgroundJobRunnable( *this ) );
+}
+
+void BackgroundJob::Cancel()
+{
+    this->m_CancelToken.Cancel();
+}
+
+void BackgroundJob::OnFinished()
+{
+    this->m_bRunning = false;
+    emit this->completed( this->m_bResult );
+}
+
+void BackgroundJob::RunReporter()
+{
+    std::unique_lock<std::mutex> lock( this->m_ReporterLock );
+
+    while ( this->m_ReporterCond.wait_for(
+                lock, PROGRESS_REPORT_INTERVAL,
+                [this]() { return this->m_bJobReturned; } ) == false )
+    {
+        lock.unlock();
+        this->ReportProgress( false );
+        lock.lock();
+    }
+}
+
+//
+// Called from the job's side, the signals are queued to the thread that
+// started the job
+//
+void BackgroundJob::ReportProgress( bool bLastReport )
+{
+    int iMaxProgress = this->m_iMaxProgress;
+    int iProgress = this->m_iProgress;
+
+    const uint64_t iTotalBytes = this->m_Stats.GetTotalBytes();
+
+    if ( iTotalBytes != 0 )
+    {
+        const uint64_t iExtractedBytes =
+            std::min( this->m_Stats.GetExtractedBytes(), iTotalBytes );
+
+        iMaxProgress = BYTES_PROGRESS_MAX;
+        iProgress = static_cast<int>( iExtractedBytes * BYTES_PROGRESS_MAX /
+                                      iTotalBytes );
+
+        // always sent when done, so the last rates are shown
+        if ( this->m_iReportsNum++ % THROUGHPUT_REPORT_INTERVAL == 0 ||
+             bLastReport == true )
+        {
+            emit this->throughputChanged( this->m_ThroughputMeter.Sample() );
+        }
+    }
+
+    if ( iMaxProgress != this->m_iReportedMaxProgress )
+    {
+        this->m_iReportedMaxProgress = iMaxProgress;
+        emit this->maxProgressChanged( iMaxProgress );
+    }
+
+    if ( iProgress != this->m_iReportedProgress )
+    {
+        this->m_iReportedProgress = iProgress;
+        emit this->progressChanged( iProgress );
+    }
+}
+
+void BackgroundJob::RunInWorker() noexcept
+{
+    std::thread reporterThread( &BackgroundJob::RunReporter, this );
+
+    try
+    {
+        this->m_bResult = this->m_Job( *this );
+    }
+    catch ( const std::exception& e )
+    {
+        qDebug() << "Background job failed with error:" << e.what();
+        this->m_bResult = false;
+    }
+    catch ( ... )
+    {
+        // anything escaping a noexcept function terminates the program
+        qDebug() << "Background job failed with an unknown error";
+        this->m_bResult = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( this->m_ReporterLock );
+        this->m_bJobReturned = true;
+    }
+
+    this->m_ReporterCond.notify_one();
+    reporterThread.join();
+
+    // sent before finished, so they're received before completed
+    this->ReportProgress( true );
+
+    emit this->finished();
+}
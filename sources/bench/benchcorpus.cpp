@@ -0,0 +1,493 @@
+#include "bench/benchcorpus.hpp"
+
+#include <algorithm>
+#include <random>
+#include <system_error>
+
+#include <uc2/pkgentry.hpp>
+#include <uc2/pkgfile.hpp>
+#include <uc2/pkgindex.hpp>
+
+#include "archivedirectorynode.hpp"
+#include "archivefilenode.hpp"
+#include "corelog.hpp"
+#include "dynindexfilefactory.hpp"
+#include "dynpkgfilefactory.hpp"
+#include "fsutils.hpp"
+#include "miscutils.hpp"
+#include "pkglayout.hpp"
+#include "pkgwriter.hpp"
+
+constexpr const uint64_t BENCH_SMALL_ENTRY_MAX_SIZE = 64 * 1024;
+constexpr const uint64_t BENCH_MEDIUM_ENTRY_MAX_SIZE = 1024 * 1024;
+constexpr const uint64_t BENCH_LARGE_ENTRY_MAX_SIZE = 4 * 1024 * 1024;
+
+// one generated entry in this many is a .e* file, and one a texture
+constexpr const std::size_t BENCH_SPECIAL_FILE_INTERVAL = 8;
+// the generated entries are spread over this many directories
+constexpr const std::size_t BENCH_DIRECTORIES_NUM = 16;
+
+static bool IsInSizeClass( uint64_t iEntrySize,
+                           BenchSizeClassEnum sizeClass ) noexcept
+{
+    switch ( sizeClass )
+    {
+        case BSC_Small:
+            return iEntrySize <= BENCH_SMALL_ENTRY_MAX_SIZE;
+        case BSC_Medium:
+            return iEntrySize > BENCH_SMALL_ENTRY_MAX_SIZE &&
+                   iEntrySize <= BENCH_MEDIUM_ENTRY_MAX_SIZE;
+        case BSC_Large:
+            return iEntrySize > BENCH_MEDIUM_ENTRY_MAX_SIZE;
+        default:
+            return true;
+    }
+}
+
+static BenchSizeClassEnum PickSizeClass( BenchSizeClassEnum sizeDist,
+                                         std::mt19937_64& random )
+{
+    if ( sizeDist != BSC_All )
+    {
+        return sizeDist;
+    }
+
+    // 80% small, 15% medium and 5% large entries
+    const uint64_t iRoll = random() % 100;
+
+    if ( iRoll < 80 )
+    {
+        return BSC_Small;
+    }
+
+    return iRoll < 95 ? BSC_Medium : BSC_Large;
+}
+
+static uint64_t PickEntrySize( BenchSizeClassEnum sizeClass,
+                               std::mt19937_64& random )
+{
+    uint64_t iMinSize = 1;
+    uint64_t iMaxSize = BENCH_SMALL_ENTRY_MAX_SIZE;
+
+    if ( sizeClass == BSC_Medium )
+    {
+        iMinSize = BENCH_SMALL_ENTRY_MAX_SIZE + 1;
+        iMaxSize = BENCH_MEDIUM_ENTRY_MAX_SIZE;
+    }
+    else if ( sizeClass == BSC_Large )
+    {
+        iMinSize = BENCH_MEDIUM_ENTRY_MAX_SIZE + 1;
+        iMaxSize = BENCH_LARGE_ENTRY_MAX_SIZE;
+    }
+
+    return iMinSize + random() % ( iMaxSize - iMinSize + 1 );
+}
+
+static const char* GetEntryExtension( std::size_t iEntryNum )
+{
+    switch ( iEntryNum % BENCH_SPECIAL_FILE_INTERVAL )
+    {
+        case 0:
+            return ".etxt";
+        case BENCH_SPECIAL_FILE_INTERVAL / 2:
+            return ".vtf";
+        default:
+            return ".bin";
+    }
+}
+
+// six random bits per byte, so compressed textures shrink a little
+static void FillEntryData( std::vector<uint8_t>& vData,
+                           std::mt19937_64& random )
+{
+    for ( std::size_t i = 0; i < vData.size(); i += sizeof( uint64_t ) )
+    {
+        uint64_t iBits = random();
+
+        for ( std::size_t j = i; j < vData.size() && j < i + sizeof( uint64_t );
+              j++, iBits >>= 8 )
+        {
+            vData[j] = static_cast<uint8_t>( 0x40 | ( iBits & 0x3F ) );
+        }
+    }
+}
+
+BenchCorpus::BenchCorpus() : m_Provider( GameProvider::Unknown ) {}
+
+bool BenchCorpus::Load( const fs::path& archivePath, GameProvider provider,
+                        std::size_t iMaxPkgFilesNum )
+{
+    this->m_Provider = provider;
+    // the special files are only known once their types are detected
+    this->m_Tree.SetEntryFlagDetection( true );
+
+    if ( archivePath.filename() == INDEX_FILENAME )
+    {
+        auto [bIndexRead, vIndexData] = ReadFileToBuffer( archivePath );
+
+        if ( bIndexRead == false )
+        {
+            this->m_szLastError = "Could not read the index";
+            return false;
+        }
+
+        uc2::PkgIndex::ptr_t pIndex;
+
+        try
+        {
+            DynamicIndexFileFactory f( archivePath, vIndexData );
+            pIndex = f.GetPkgIndexOwnership();
+        }
+        catch ( const std::exception& e )
+        {
+            LogDebug( e.what() );
+        }
+
+        if ( !pIndex )
+        {
+            this->m_szLastError = "Could not detect the index's game provider";
+            return false;
+        }
+
+        for ( auto&& pkgFilename :
+              DynamicIndexFileFactory::GetPkgFilenames( pIndex.get() ) )
+        {
+            if ( this->m_vPkgFilePaths.size() == iMaxPkgFilesNum )
+            {
+                break;
+            }
+
+            this->m_vPkgFilePaths.push_back( archivePath.parent_path() /
+                                             pkgFilename );
+        }
+    }
+    else
+    {
+        this->m_vPkgFilePaths.push_back( archivePath );
+    }
+
+    if ( this->m_vPkgFilePaths.empty() == true )
+    {
+        this->m_szLastError = "The index doesn't list any package";
+        return false;
+    }
+
+    if ( this->m_Provider == GameProvider::Unknown )
+    {
+        // detected once, so the benchmarks don't measure the detection
+        try
+        {
+            DynamicPkgFileFactory f( this->m_vPkgFilePaths.front() );
+            this->m_Provider = f.GetProvider();
+        }
+        catch ( const std::exception& e )
+        {
+            this->m_szLastError = e.what();
+            return false;
+        }
+    }
+
+    for ( std::size_t i = 0; i < this->m_vPkgFilePaths.size(); i++ )
+    {
+        const fs::path& pkgPath = this->m_vPkgFilePaths[i];
+
+        if ( this->m_Tree.LoadPackage( pkgPath, this->m_Provider, i == 0 ) ==
+             false )
+        {
+            this->m_szLastError = pkgPath.generic_string() + ": " +
+                                  this->m_Tree.GetError();
+            return false;
+        }
+
+        auto [bPkgRead, vPkgData] = ReadFileToBuffer( pkgPath );
+
+        if ( bPkgRead == false )
+        {
+            this->m_szLastError =
+                "Could not read " + pkgPath.generic_string();
+            return false;
+        }
+
+        this->m_vWorkPkgData.push_back( vPkgData );
+        this->m_vPristinePkgData.push_back( std::move( vPkgData ) );
+        this->m_vHeaderSizes.push_back( 0 );
+
+        if ( this->PreparePkgFile( i ) == false )
+        {
+            this->m_szLastError =
+                "Could not parse " + pkgPath.generic_string();
+            return false;
+        }
+
+        this->m_vHeaderSizes[i] =
+            this->m_Tree.GetLoadedPkgFiles().Get( i )->GetFullHeaderSize();
+        this->ReleasePkgFileData( i );
+    }
+
+    this->CollectFileNodes( this->m_Tree.GetRootNode() );
+
+    std::sort( this->m_vFileNodes.begin(), this->m_vFileNodes.end(),
+               []( ArchiveFileNode* pLeft, ArchiveFileNode* pRight ) {
+                   if ( pLeft->GetOwnerPkgId() != pRight->GetOwnerPkgId() )
+                   {
+                       return pLeft->GetOwnerPkgId() <
+                              pRight->GetOwnerPkgId();
+                   }
+
+                   return pLeft->GetEntryIndex() < pRight->GetEntryIndex();
+               } );
+
+    if ( this->ReadSpecialFiles() == false )
+    {
+        this->m_szLastError = "Could not read the special files";
+        return false;
+    }
+
+    return true;
+}
+
+//
+// The same arguments always generate the same files, so runs on different
+// builds can be compared
+//
+bool BenchCorpus::Generate( const fs::path& workDir, GameProvider provider,
+                            std::size_t iEntriesNum,
+                            BenchSizeClassEnum sizeDist )
+{
+    const fs::path treeDir = workDir / "tree";
+    const fs::path archiveDir = workDir / "archive";
+
+    std::error_code errorCode;
+    fs::remove_all( workDir, errorCode );
+
+    std::mt19937_64 random( iEntriesNum * BSC_Count + sizeDist );
+    std::vector<uint8_t> vEntryData;
+
+    for ( std::size_t i = 0; i < iEntriesNum; i++ )
+    {
+        const BenchSizeClassEnum sizeClass = PickSizeClass( sizeDist, random );
+        vEntryData.resize( PickEntrySize( sizeClass, random ) );
+        FillEntryData( vEntryData, random );
+
+        const fs::path entryDir =
+            treeDir / ( "dir" + std::to_string( i % BENCH_DIRECTORIES_NUM ) );
+        const fs::path entryPath = entryDir / ( "file" + std::to_string( i ) +
+                                                GetEntryExtension( i ) );
+
+        if ( CreateDirIfUnexisting( entryDir ) == false ||
+             WriteBufferToFile( entryPath, vEntryData ) == false )
+        {
+            this->m_szLastError =
+                "Could not write " + entryPath.generic_string();
+            return false;
+        }
+    }
+
+    PkgLayout layout( provider );
+
+    if ( layout.AddDirectory( treeDir ) == false )
+    {
+        this->m_szLastError = layout.GetError();
+        return false;
+    }
+
+    PkgWriter writer( layout, archiveDir );
+
+    if ( writer.Write() == false )
+    {
+        this->m_szLastError = writer.GetError();
+        return false;
+    }
+
+    // the packages have their own copy now
+    fs::remove_all( treeDir, errorCode );
+
+    return this->Load( archiveDir / INDEX_FILENAME, provider, SIZE_MAX );
+}
+
+bool BenchCorpus::PreparePkgFile( PkgFileId iPkgId )
+{
+    std::vector<uint8_t>& vWorkData = this->m_vWorkPkgData.at( iPkgId );
+    const std::vector<uint8_t>& vPristineData =
+        this->m_vPristinePkgData.at( iPkgId );
+    std::copy( vPristineData.begin(), vPristineData.end(),
+               vWorkData.begin() );
+
+    uc2::PkgFile* pPkgFile = this->m_Tree.GetLoadedPkgFiles().Get( iPkgId );
+
+    try
+    {
+        pPkgFile->SetDataBuffer( vWorkData );
+
+        if ( pPkgFile->DecryptHeader() == false )
+        {
+            return false;
+        }
+
+        pPkgFile->Parse();
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( e.what() );
+        return false;
+    }
+
+    return true;
+}
+
+void BenchCorpus::ResetPkgFileHeader( PkgFileId iPkgId )
+{
+    std::vector<uint8_t>& vWorkData = this->m_vWorkPkgData.at( iPkgId );
+    const std::vector<uint8_t>& vPristineData =
+        this->m_vPristinePkgData.at( iPkgId );
+
+    const auto iHeaderSize = static_cast<std::ptrdiff_t>( std::min<uint64_t>(
+        this->m_vHeaderSizes.at( iPkgId ), vPristineData.size() ) );
+    std::copy( vPristineData.begin(), vPristineData.begin() + iHeaderSize,
+               vWorkData.begin() );
+
+    this->m_Tree.GetLoadedPkgFiles().Get( iPkgId )->SetDataBuffer(
+        vWorkData );
+}
+
+void BenchCorpus::ReleasePkgFileData( PkgFileId iPkgId )
+{
+    this->m_Tree.GetLoadedPkgFiles().Get( iPkgId )->ReleaseDataBuffer();
+}
+
+const char* BenchCorpus::GetSizeClassName( BenchSizeClassEnum sizeClass )
+{
+    switch ( sizeClass )
+    {
+        case BSC_Small:
+            return "small";
+        case BSC_Medium:
+            return "medium";
+        case BSC_Large:
+            return "large";
+        default:
+            return "all";
+    }
+}
+
+std::vector<BenchCorpus::CorpusEntry> BenchCorpus::GetEntries(
+    BenchSizeClassEnum sizeClass, std::size_t iMaxEntriesNum ) const
+{
+    std::vector<CorpusEntry> vEntries;
+
+    for ( ArchiveFileNode* pFileNode : this->m_vFileNodes )
+    {
+        if ( vEntries.size() == iMaxEntriesNum )
+        {
+            break;
+        }
+
+        const uint64_t iEntrySize = pFileNode->GetDecryptedSize();
+
+        if ( IsInSizeClass( iEntrySize, sizeClass ) == true )
+        {
+            vEntries.push_back( { pFileNode->GetOwnerPkgId(),
+                                  pFileNode->GetEntryIndex(), iEntrySize } );
+        }
+    }
+
+    return vEntries;
+}
+
+std::vector<ArchiveBaseNode*> BenchCorpus::GetFileNodes() const
+{
+    std::vector<ArchiveBaseNode*> vNodes;
+    vNodes.reserve( this->m_vFileNodes.size() );
+
+    for ( ArchiveFileNode* pFileNode : this->m_vFileNodes )
+    {
+        vNodes.push_back( pFileNode );
+    }
+
+    return vNodes;
+}
+
+//
+// Keeps the special files as they are once the package is decrypted, so
+// their own decryption and decompression are measured apart from it
+//
+bool BenchCorpus::ReadSpecialFiles()
+{
+    PkgFileId iPreparedPkgId = this->m_vPkgFilePaths.size();
+
+    for ( ArchiveFileNode* pFileNode : this->m_vFileNodes )
+    {
+        if ( pFileNode->IsEncryptedFile() == false &&
+             pFileNode->IsLzmaTexture() == false )
+        {
+            continue;
+        }
+
+        const PkgFileId iPkgId = pFileNode->GetOwnerPkgId();
+
+        if ( iPkgId != iPreparedPkgId )
+        {
+            if ( iPreparedPkgId != this->m_vPkgFilePaths.size() )
+            {
+                this->ReleasePkgFileData( iPreparedPkgId );
+            }
+
+            if ( this->PreparePkgFile( iPkgId ) == false )
+            {
+                return false;
+            }
+
+            iPreparedPkgId = iPkgId;
+        }
+
+        uc2::PkgFile* pPkgFile = this->m_Tree.GetLoadedPkgFiles().Get( iPkgId );
+        auto& pEntry = pPkgFile->GetEntries().at( pFileNode->GetEntryIndex() );
+
+        gsl::span<uint8_t> entryData;
+
+        try
+        {
+            entryData = PairToSpan( pEntry->DecryptFile() );
+        }
+        catch ( const std::exception& e )
+        {
+            LogWarning( "Could not decrypt", pEntry->GetFilePath(), e.what() );
+            continue;
+        }
+
+        SpecialFile file{ pFileNode->GetPath().filename().generic_string(),
+                          { entryData.begin(), entryData.end() } };
+
+        if ( pFileNode->IsEncryptedFile() == true )
+        {
+            this->m_vEncryptedFiles.push_back( std::move( file ) );
+        }
+        else
+        {
+            this->m_vLzmaTextures.push_back( std::move( file ) );
+        }
+    }
+
+    if ( iPreparedPkgId != this->m_vPkgFilePaths.size() )
+    {
+        this->ReleasePkgFileData( iPreparedPkgId );
+    }
+
+    return true;
+}
+
+void BenchCorpus::CollectFileNodes( ArchiveBaseNode* pNode )
+{
+    if ( pNode->IsDirectory() == false )
+    {
+        this->m_vFileNodes.push_back( BaseToFileNode( pNode ) );
+        return;
+    }
+
+    ArchiveDirectoryNode* pDirNode = BaseToDirectoryNode( pNode );
+
+    for ( std::size_t i = 0; i < pDirNode->GetNumOfChildren(); i++ )
+    {
+        this->CollectFileNodes( pDirNode->GetChild( i ) );
+    }
+}
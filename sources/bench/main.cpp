@@ -0,0 +1,731 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gsl/gsl>
+
+#include <uc2/pkgentry.hpp>
+#include <uc2/pkgfile.hpp>
+
+#include "bench/benchcorpus.hpp"
+#include "bufferpool.hpp"
+#include "cancellationtoken.hpp"
+#include "extractionstats.hpp"
+#include "nodeextractionmgr.hpp"
+#include "specialfilehandler.hpp"
+#include "workerpool.hpp"
+
+using namespace std::string_view_literals;
+
+//
+// uc2-bench, the throughput of every stage of an extraction, so changes to
+// the core can be compared
+//
+// The benchmarks run on archives PkgWriter generates, one for each entry
+// count and size distribution they're given as arguments, unless they're
+// given a package or index of the game
+//
+// Everything but the end to end extraction runs on the calling thread and
+// from memory
+//
+
+// the names accepted by --uc2_provider, in GetGameProviderByIndex's order
+constexpr const std::string_view BENCH_PROVIDER_NAMES[] = {
+    "nexon"sv, "tiancity"sv, "beancity"sv, "nexonjp"sv, "tfo"sv
+};
+
+struct BenchOptions
+{
+    fs::path archivePath;
+    fs::path outPath;
+
+    GameProvider provider = GameProvider::Unknown;
+    // zero uses a thread per hardware thread
+    std::size_t iThreadsNum = 0;
+    // the entry counts archives are generated with
+    std::vector<std::size_t> vGeneratedEntriesNums = { 64, 512 };
+
+    // only for the package or index given
+    std::size_t iMaxPkgFilesNum = 4;
+    // zero benchmarks every entry
+    std::size_t iMaxEntriesNum = 0;
+};
+
+static void PrintUsage( std::ostream& out )
+{
+    out << "usage: uc2-bench [benchmark options] [options] [pkg|index]\n"
+           "\n"
+           "Without a package or index, archives are generated for every "
+           "entry count and\n"
+           "size distribution, the \"entries\" and \"sizes\" arguments. "
+           "The sizes are mixed\n"
+           "(0), up to 64 KiB (1), up to 1 MiB (2) and up to 4 MiB (3).\n"
+           "\n"
+           "options:\n"
+           "  --uc2_provider=<name>       nexon, tiancity, beancity, nexonjp "
+           "or tfo,\n"
+           "                              detected in a given archive, "
+           "nexon otherwise\n"
+           "  --uc2_threads=<num>         the extraction's worker threads\n"
+           "  --uc2_gen_entries=<num,...> the entry counts of the generated "
+           "archives,\n"
+           "                              defaults to 64,512\n"
+           "  --uc2_max_pkgs=<num>        the packages of a given index to "
+           "load, defaults\n"
+           "                              to 4\n"
+           "  --uc2_entries=<num>         the entries of a given archive "
+           "decrypted per size\n"
+           "                              class, defaults to all\n"
+           "  --uc2_out=<dir>             where files are extracted, defaults "
+           "to /dev/shm\n";
+}
+
+static bool ParseCount( std::string_view value, std::size_t& outCount )
+{
+    char* pValueEnd = nullptr;
+    const std::string szValue( value );
+    const unsigned long long iCount =
+        std::strtoull( szValue.c_str(), &pValueEnd, 10 );
+
+    if ( szValue.empty() == true || *pValueEnd != '\0' )
+    {
+        return false;
+    }
+
+    outCount = gsl::narrow_cast<std::size_t>( iCount );
+    return true;
+}
+
+// a comma separated list
+static bool ParseCounts( std::string_view value,
+                         std::vector<std::size_t>& vOutCounts )
+{
+    vOutCounts.clear();
+
+    while ( true )
+    {
+        const std::size_t iCommaPos = value.find( ',' );
+        std::size_t iCount;
+
+        if ( ParseCount( value.substr( 0, iCommaPos ), iCount ) == false ||
+             iCount == 0 )
+        {
+            return false;
+        }
+
+        vOutCounts.push_back( iCount );
+
+        if ( iCommaPos == std::string_view::npos )
+        {
+            return true;
+        }
+
+        value.remove_prefix( iCommaPos + 1 );
+    }
+}
+
+static bool ParseArguments( int argc, char* argv[], BenchOptions& outOptions )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string_view arg = argv[i];
+        const std::size_t iValuePos = arg.find( '=' );
+        const std::string_view name = arg.substr( 0, iValuePos );
+        const std::string_view value = iValuePos != std::string_view::npos
+                                           ? arg.substr( iValuePos + 1 )
+                                           : std::string_view{};
+
+        bool bValidValue = true;
+
+        if ( name == "--uc2_provider"sv )
+        {
+            bValidValue = false;
+
+            for ( int p = 0;
+                  p < static_cast<int>( std::size( BENCH_PROVIDER_NAMES ) );
+                  p++ )
+            {
+                if ( BENCH_PROVIDER_NAMES[p] == value )
+                {
+                    outOptions.provider = GetGameProviderByIndex( p );
+                    bValidValue = true;
+                }
+            }
+        }
+        else if ( name == "--uc2_threads"sv )
+        {
+            bValidValue = ParseCount( value, outOptions.iThreadsNum );
+        }
+        else if ( name == "--uc2_gen_entries"sv )
+        {
+            bValidValue =
+                ParseCounts( value, outOptions.vGeneratedEntriesNums );
+        }
+        else if ( name == "--uc2_max_pkgs"sv )
+        {
+            bValidValue = ParseCount( value, outOptions.iMaxPkgFilesNum ) &&
+                          outOptions.iMaxPkgFilesNum != 0;
+        }
+        else if ( name == "--uc2_entries"sv )
+        {
+            bValidValue = ParseCount( value, outOptions.iMaxEntriesNum );
+        }
+        else if ( name == "--uc2_out"sv )
+        {
+            outOptions.outPath = value;
+            bValidValue = value.empty() == false;
+        }
+        else if ( arg.size() > 2 && arg.substr( 0, 2 ) == "--"sv )
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return false;
+        }
+        else if ( outOptions.archivePath.empty() == true )
+        {
+            outOptions.archivePath = arg;
+        }
+        else
+        {
+            std::cerr << "Only one package or index can be benchmarked\n";
+            return false;
+        }
+
+        if ( bValidValue == false )
+        {
+            std::cerr << "Invalid value for " << name << '\n';
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// The corpus each benchmark runs on, the archive given or the one generated
+// for the benchmark's arguments
+//
+// Only the last generated corpus is kept, the benchmarks being registered
+// argument after argument so each corpus is generated once
+//
+class BenchCorpusSource
+{
+public:
+    BenchCorpusSource( const BenchOptions& options )
+        : m_Options( options ), m_iEntriesNum( 0 ), m_SizeDist( BSC_Count )
+    {
+        std::error_code errorCode;
+        this->m_WorkDir =
+            fs::temp_directory_path( errorCode ) / "uc2-bench-corpus";
+    }
+
+    ~BenchCorpusSource()
+    {
+        this->m_pCorpus.reset();
+
+        std::error_code errorCode;
+        fs::remove_all( this->m_WorkDir, errorCode );
+    }
+
+    inline bool IsGenerated() const noexcept
+    {
+        return this->m_Options.archivePath.empty() == true;
+    }
+
+    bool LoadArchive()
+    {
+        this->m_pCorpus = std::make_unique<BenchCorpus>();
+        return this->m_pCorpus->Load( this->m_Options.archivePath,
+                                      this->m_Options.provider,
+                                      this->m_Options.iMaxPkgFilesNum );
+    }
+
+    // skips the benchmark when its corpus can't be generated
+    BenchCorpus* Get( benchmark::State& state )
+    {
+        if ( this->IsGenerated() == false )
+        {
+            return this->m_pCorpus.get();
+        }
+
+        const auto iEntriesNum = static_cast<std::size_t>( state.range( 0 ) );
+        const auto sizeDist =
+            static_cast<BenchSizeClassEnum>( state.range( 1 ) );
+
+        if ( this->m_pCorpus != nullptr &&
+             this->m_iEntriesNum == iEntriesNum &&
+             this->m_SizeDist == sizeDist )
+        {
+            return this->m_pCorpus.get();
+        }
+
+        // the previous corpus' memory is freed first
+        this->m_pCorpus.reset();
+
+        const GameProvider provider =
+            this->m_Options.provider != GameProvider::Unknown
+                ? this->m_Options.provider
+                : GameProvider::Nexon;
+        auto pCorpus = std::make_unique<BenchCorpus>();
+
+        if ( pCorpus->Generate( this->m_WorkDir, provider, iEntriesNum,
+                                sizeDist ) == false )
+        {
+            this->m_szLastError =
+                "Could not generate the corpus: " + pCorpus->GetError();
+            state.SkipWithError( this->m_szLastError.c_str() );
+            return nullptr;
+        }
+
+        this->m_pCorpus = std::move( pCorpus );
+        this->m_iEntriesNum = iEntriesNum;
+        this->m_SizeDist = sizeDist;
+        return this->m_pCorpus.get();
+    }
+
+    inline const std::string& GetError() const noexcept
+    {
+        if ( this->m_pCorpus != nullptr )
+        {
+            return this->m_pCorpus->GetError();
+        }
+
+        return this->m_szLastError;
+    }
+
+private:
+    const BenchOptions& m_Options;
+    fs::path m_WorkDir;
+
+    std::unique_ptr<BenchCorpus> m_pCorpus;
+    std::size_t m_iEntriesNum;
+    BenchSizeClassEnum m_SizeDist;
+
+    std::string m_szLastError;
+};
+
+static void SetThroughput( benchmark::State& state, uint64_t iTotalBytes,
+                           uint64_t iTotalEntries )
+{
+    state.SetBytesProcessed( static_cast<int64_t>( iTotalBytes ) );
+    state.counters["entries"] = benchmark::Counter(
+        static_cast<double>( iTotalEntries ), benchmark::Counter::kIsRate );
+}
+
+static void BenchHeaderDecryptParse( benchmark::State& state,
+                                     BenchCorpusSource& source )
+{
+    BenchCorpus* pCorpus = source.Get( state );
+
+    if ( pCorpus == nullptr )
+    {
+        return;
+    }
+
+    BenchCorpus& corpus = *pCorpus;
+    const std::size_t iPkgFilesNum = corpus.GetPkgFilePaths().size();
+    const LoadedPkgFiles& pkgFiles = corpus.GetTree().GetLoadedPkgFiles();
+
+    uint64_t iTotalBytes = 0;
+    uint64_t iTotalEntries = 0;
+
+    for ( auto _ : state )
+    {
+        for ( PkgFileId iPkgId = 0; iPkgId < iPkgFilesNum; iPkgId++ )
+        {
+            state.PauseTiming();
+            corpus.ResetPkgFileHeader( iPkgId );
+            state.ResumeTiming();
+
+            uc2::PkgFile* pPkgFile = pkgFiles.Get( iPkgId );
+
+            if ( pPkgFile->DecryptHeader() == false )
+            {
+                state.SkipWithError( "Could not decrypt a header" );
+                return;
+            }
+
+            pPkgFile->Parse();
+
+            iTotalBytes += corpus.GetPkgFileHeaderSize( iPkgId );
+            iTotalEntries += pPkgFile->GetEntries().size();
+        }
+    }
+
+    for ( PkgFileId iPkgId = 0; iPkgId < iPkgFilesNum; iPkgId++ )
+    {
+        corpus.ReleasePkgFileData( iPkgId );
+    }
+
+    SetThroughput( state, iTotalBytes, iTotalEntries );
+}
+
+static void BenchDecryptEntries( benchmark::State& state,
+                                 BenchCorpusSource& source,
+                                 BenchSizeClassEnum sizeClass,
+                                 std::size_t iMaxEntriesNum )
+{
+    BenchCorpus* pCorpus = source.Get( state );
+
+    if ( pCorpus == nullptr )
+    {
+        return;
+    }
+
+    BenchCorpus& corpus = *pCorpus;
+    const auto vEntries = corpus.GetEntries( sizeClass, iMaxEntriesNum );
+
+    if ( vEntries.empty() == true )
+    {
+        state.SkipWithError( "There are no entries of this size" );
+        return;
+    }
+
+    const LoadedPkgFiles& pkgFiles = corpus.GetTree().GetLoadedPkgFiles();
+
+    uint64_t iTotalBytes = 0;
+    uint64_t iTotalEntries = 0;
+
+    for ( auto _ : state )
+    {
+        PkgFileId iPreparedPkgId = corpus.GetPkgFilePaths().size();
+
+        for ( auto&& entry : vEntries )
+        {
+            // the entries are sorted by package, so each is prepared once
+            if ( entry.iPkgId != iPreparedPkgId )
+            {
+                state.PauseTiming();
+
+                if ( corpus.PreparePkgFile( entry.iPkgId ) == false )
+                {
+                    state.SkipWithError( "Could not prepare a package" );
+                    return;
+                }
+
+                iPreparedPkgId = entry.iPkgId;
+                state.ResumeTiming();
+            }
+
+            auto& pEntry =
+                pkgFiles.Get( entry.iPkgId )->GetEntries()[entry.iEntryIndex];
+            benchmark::DoNotOptimize( pEntry->DecryptFile() );
+        }
+
+        iTotalEntries += vEntries.size();
+
+        for ( auto&& entry : vEntries )
+        {
+            iTotalBytes += entry.iDecryptedSize;
+        }
+    }
+
+    for ( PkgFileId iPkgId = 0; iPkgId < corpus.GetPkgFilePaths().size();
+          iPkgId++ )
+    {
+        corpus.ReleasePkgFileData( iPkgId );
+    }
+
+    SetThroughput( state, iTotalBytes, iTotalEntries );
+}
+
+static void BenchDecryptEncryptedFiles( benchmark::State& state,
+                                        BenchCorpusSource& source )
+{
+    BenchCorpus* pCorpus = source.Get( state );
+
+    if ( pCorpus == nullptr )
+    {
+        return;
+    }
+
+    BenchCorpus& corpus = *pCorpus;
+    const auto& vFiles = corpus.GetEncryptedFiles();
+
+    if ( vFiles.empty() == true )
+    {
+        state.SkipWithError( "There are no encrypted files" );
+        return;
+    }
+
+    // the files are decrypted in place
+    std::vector<std::vector<uint8_t>> vWorkData;
+    vWorkData.reserve( vFiles.size() );
+
+    for ( auto&& file : vFiles )
+    {
+        vWorkData.push_back( file.vData );
+    }
+
+    BufferPool bufferPool;
+    uint64_t iTotalBytes = 0;
+    uint64_t iTotalEntries = 0;
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming();
+
+        for ( std::size_t i = 0; i < vFiles.size(); i++ )
+        {
+            std::copy( vFiles[i].vData.begin(), vFiles[i].vData.end(),
+                       vWorkData[i].begin() );
+        }
+
+        state.ResumeTiming();
+
+        for ( std::size_t i = 0; i < vFiles.size(); i++ )
+        {
+            SpecialFileHandler handler( vWorkData[i], vFiles[i].szFilename,
+                                        true, false, bufferPool );
+            benchmark::DoNotOptimize( handler.ProcessDecryption() );
+
+            iTotalBytes += vWorkData[i].size();
+        }
+
+        iTotalEntries += vFiles.size();
+    }
+
+    SetThroughput( state, iTotalBytes, iTotalEntries );
+}
+
+static void BenchDecompressTextures( benchmark::State& state,
+                                     BenchCorpusSource& source )
+{
+    BenchCorpus* pCorpus = source.Get( state );
+
+    if ( pCorpus == nullptr )
+    {
+        return;
+    }
+
+    BenchCorpus& corpus = *pCorpus;
+    const auto& vTextures = corpus.GetLzmaTextures();
+
+    if ( vTextures.empty() == true )
+    {
+        state.SkipWithError( "There are no compressed textures" );
+        return;
+    }
+
+    // decompression leaves its input as it is, so the textures are shared
+    // by every iteration
+    std::vector<std::vector<uint8_t>> vTexData;
+    vTexData.reserve( vTextures.size() );
+
+    for ( auto&& texture : vTextures )
+    {
+        vTexData.push_back( texture.vData );
+    }
+
+    BufferPool bufferPool;
+    uint64_t iTotalBytes = 0;
+    uint64_t iTotalEntries = 0;
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < vTextures.size(); i++ )
+        {
+            SpecialFileHandler handler( vTexData[i], vTextures[i].szFilename,
+                                        false, true, bufferPool );
+            gsl::span<uint8_t> texData = handler.ProcessDecompression();
+            benchmark::DoNotOptimize( texData.data() );
+
+            // the decompressed bytes, like the extraction's written bytes
+            iTotalBytes += texData.size_bytes();
+        }
+
+        iTotalEntries += vTextures.size();
+    }
+
+    SetThroughput( state, iTotalBytes, iTotalEntries );
+}
+
+static void BenchExtractFiles( benchmark::State& state,
+                               BenchCorpusSource& source,
+                               const fs::path& outPath )
+{
+    BenchCorpus* pCorpus = source.Get( state );
+
+    if ( pCorpus == nullptr )
+    {
+        return;
+    }
+
+    BenchCorpus& corpus = *pCorpus;
+    ArchiveTree& tree = corpus.GetTree();
+    auto vFileNodes = corpus.GetFileNodes();
+
+    std::atomic<int> iProgress = 0;
+    CancellationToken cancelToken;
+    ExtractionStats stats;
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming();
+
+        std::error_code errorCode;
+        fs::remove_all( outPath, errorCode );
+
+        auto snapshot = NodeExtractionMgr::TakeSnapshot(
+            vFileNodes, tree.GetLoadedPkgFiles().GetCount() );
+
+        NodeExtractionMgr extractMgr( tree.GetLoadedPkgFiles(), outPath,
+                                      iProgress, cancelToken, true, true );
+        extractMgr.SetStats( &stats );
+
+        state.ResumeTiming();
+
+        if ( extractMgr.ExtractSnapshot( snapshot, tree.GetParentPath() ) ==
+             false )
+        {
+            state.SkipWithError( "The extraction failed" );
+            break;
+        }
+    }
+
+    std::error_code errorCode;
+    fs::remove_all( outPath, errorCode );
+
+    SetThroughput( state, stats.GetWrittenBytes(), stats.GetExtractedFiles() );
+}
+
+static fs::path GetDefaultOutPath()
+{
+    std::error_code errorCode;
+    fs::path baseDir = "/dev/shm";
+
+    // tmpfs, so the disk doesn't bound the extraction
+    if ( fs::is_directory( baseDir, errorCode ) == false )
+    {
+        baseDir = fs::temp_directory_path( errorCode );
+    }
+
+    return baseDir / "uc2-bench";
+}
+
+//
+// Registers every benchmark with a generated corpus' arguments, or without
+// any for the archive given
+//
+static void RegisterCorpusBenchmarks( BenchCorpusSource& source,
+                                      const BenchOptions& options,
+                                      const std::vector<int64_t>& vArgs )
+{
+    auto applyArgs = [&vArgs]( auto* pBenchmark ) {
+        if ( vArgs.empty() == false )
+        {
+            pBenchmark->Args( vArgs )->ArgNames( { "entries", "sizes" } );
+        }
+
+        return pBenchmark;
+    };
+
+    applyArgs( benchmark::RegisterBenchmark( "HeaderDecryptParse",
+                                             BenchHeaderDecryptParse,
+                                             std::ref( source ) ) )
+        ->Unit( benchmark::kMicrosecond );
+
+    if ( source.IsGenerated() == true )
+    {
+        // the arguments pick the entries' sizes
+        applyArgs( benchmark::RegisterBenchmark(
+                       "DecryptEntries", BenchDecryptEntries,
+                       std::ref( source ), BSC_All, SIZE_MAX ) )
+            ->Unit( benchmark::kMillisecond );
+    }
+    else
+    {
+        for ( int i = 0; i < BSC_Count; i++ )
+        {
+            const auto sizeClass = static_cast<BenchSizeClassEnum>( i );
+            const std::string szName =
+                std::string( "DecryptEntries/" ) +
+                BenchCorpus::GetSizeClassName( sizeClass );
+
+            benchmark::RegisterBenchmark( szName.c_str(), BenchDecryptEntries,
+                                          std::ref( source ), sizeClass,
+                                          options.iMaxEntriesNum != 0
+                                              ? options.iMaxEntriesNum
+                                              : SIZE_MAX )
+                ->Unit( benchmark::kMillisecond );
+        }
+    }
+
+    applyArgs( benchmark::RegisterBenchmark( "DecryptEncryptedFiles",
+                                             BenchDecryptEncryptedFiles,
+                                             std::ref( source ) ) )
+        ->Unit( benchmark::kMillisecond );
+    applyArgs( benchmark::RegisterBenchmark( "DecompressTextures",
+                                             BenchDecompressTextures,
+                                             std::ref( source ) ) )
+        ->Unit( benchmark::kMillisecond );
+
+    // the extraction runs on the worker pool
+    applyArgs( benchmark::RegisterBenchmark(
+                   "ExtractFiles", BenchExtractFiles, std::ref( source ),
+                   options.outPath.empty() == false ? options.outPath
+                                                    : GetDefaultOutPath() ) )
+        ->Unit( benchmark::kMillisecond )
+        ->UseRealTime();
+}
+
+static void RegisterBenchmarks( BenchCorpusSource& source,
+                                const BenchOptions& options )
+{
+    if ( source.IsGenerated() == false )
+    {
+        RegisterCorpusBenchmarks( source, options, {} );
+        return;
+    }
+
+    for ( std::size_t iEntriesNum : options.vGeneratedEntriesNums )
+    {
+        for ( int i = 0; i < BSC_Count; i++ )
+        {
+            RegisterCorpusBenchmarks(
+                source, options, { static_cast<int64_t>( iEntriesNum ), i } );
+        }
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    // takes away the options it knows about
+    benchmark::Initialize( &argc, argv );
+
+    BenchOptions options;
+
+    if ( ParseArguments( argc, argv, options ) == false )
+    {
+        PrintUsage( std::cerr );
+        return EXIT_FAILURE;
+    }
+
+    // the pool is created when it's first used
+    WorkerPool::SetSharedThreadsNum( options.iThreadsNum );
+
+    BenchCorpusSource source( options );
+
+    if ( source.IsGenerated() == false && source.LoadArchive() == false )
+    {
+        std::cerr << "Could not load " << options.archivePath.generic_string()
+                  << ": " << source.GetError() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    RegisterBenchmarks( source, options );
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+#include "bufferpool.hpp"
+
+BufferPool::Buffer::Buffer() noexcept
+    : m_pOwner( nullptr ), m_pData(), m_iSizeClass( 0 ), m_iSize( 0 )
+{
+}
+
+BufferPool::Buffer::Buffer( BufferPool* pOwner,
+                            std::unique_ptr<std::uint8_t[]> pData,
+                            std::size_t iSizeClass,
+                            std::uint64_t iSize ) noexcept
+    : m_pOwner( pOwner ), m_pData( std::move( pData ) ),
+      m_iSizeClass( iSizeClass ), m_iSize( iSize )
+{
+}
+
+BufferPool::Buffer::Buffer( Buffer&& other ) noexcept
+    : m_pOwner( other.m_pOwner ), m_pData( std::move( other.m_pData ) ),
+      m_iSizeClass( other.m_iSizeClass ), m_iSize( other.m_iSize )
+{
+    other.m_pOwner = nullptr;
+    other.m_iSize = 0;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=( Buffer&& other ) noexcept
+{
+    if ( this != &other )
+    {
+        this->Reset();
+
+        this->m_pOwner = other.m_pOwner;
+        this->m_pData = std::move( other.m_pData );
+        this->m_iSizeClass = other.m_iSizeClass;
+        this->m_iSize = other.m_iSize;
+
+        other.m_pOwner = nullptr;
+        other.m_iSize = 0;
+    }
+
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    this->Reset();
+}
+
+void BufferPool::Buffer::Reset() noexcept
+{
+    if ( this->m_pOwner != nullptr && this->m_pData != nullptr )
+    {
+        this->m_pOwner->Release( std::move( this->m_pData ),
+                                 this->m_iSizeClass );
+    }
+
+    this->m_pOwner = nullptr;
+    this->m_pData.reset();
+    this->m_iSize = 0;
+}
+
+BufferPool::BufferPool(
+    std::uint64_t iMaxRetainedBytes /*= DEFAULT_MAX_RETAINED_BYTES*/ )
+    : m_iRetainedBytes( 0 ), m_iMaxRetainedBytes( iMaxRetainedBytes )
+{
+}
+
+BufferPool::~BufferPool() {}
+
+BufferPool::Buffer BufferPool::Acquire( std::uint64_t iSize )
+{
+    const std::size_t iSizeClass = BufferPool::GetSizeClass( iSize );
+
+    // too big to be pooled
+    if ( iSizeClass >= NUM_SIZE_CLASSES )
+    {
+        std::unique_ptr<std::uint8_t[]> pData(
+            new std::uint8_t[gsl::narrow_cast<std::size_t>( iSize )] );
+        return Buffer( nullptr, std::move( pData ), iSizeClass, iSize );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( this->m_Lock );
+        auto& vFreeBuffers = this->m_FreeBuffers[iSizeClass];
+
+        if ( vFreeBuffers.empty() == false )
+        {
+            std::unique_ptr<std::uint8_t[]> pData =
+                std::move( vFreeBuffers.back() );
+            vFreeBuffers.pop_back();
+
+            this->m_iRetainedBytes -=
+                BufferPool::GetClassCapacity( iSizeClass );
+
+            return Buffer( this, std::move( pData ), iSizeClass, iSize );
+        }
+    }
+
+    const std::uint64_t iCapacity = BufferPool::GetClassCapacity( iSizeClass );
+    std::unique_ptr<std::uint8_t[]> pData(
+        new std::uint8_t[gsl::narrow_cast<std::size_t>( iCapacity )] );
+
+    return Buffer( this, std::move( pData ), iSizeClass, iSize );
+}
+
+void BufferPool::Trim()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    for ( auto&& vFreeBuffers : this->m_FreeBuffers )
+    {
+        vFreeBuffers.clear();
+    }
+
+    this->m_iRetainedBytes = 0;
+}
+
+void BufferPool::Release( std::unique_ptr<std::uint8_t[]> pData,
+                          std::size_t iSizeClass ) noexcept
+{
+    const std::uint64_t iCapacity = BufferPool::GetClassCapacity( iSizeClass );
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    // let the buffer be freed if we're holding too much already
+    if ( this->m_iRetainedBytes + iCapacity > this->m_iMaxRetainedBytes )
+    {
+        return;
+    }
+
+    try
+    {
+        this->m_FreeBuffers[iSizeClass].push_back( std::move( pData ) );
+        this->m_iRetainedBytes += iCapacity;
+    }
+    catch ( const std::bad_alloc& )
+    {
+        // the buffer is freed instead
+    }
+}
+
+std::size_t BufferPool::GetSizeClass( std::uint64_t iSize ) noexcept
+{
+    std::size_t iSizeClass = 0;
+
+    while ( iSizeClass < NUM_SIZE_CLASSES &&
+            BufferPool::GetClassCapacity( iSizeClass ) < iSize )
+    {
+        iSizeClass++;
+    }
+
+    return iSizeClass;
+}
+
+std::uint64_t BufferPool::GetClassCapacity( std::size_t iSizeClass ) noexcept
+{
+    return std::uint64_t( 1 ) << ( MIN_CLASS_SHIFT + iSizeClass );
+}
@@ -6,6 +6,7 @@ CBusyWinWrapper::CBusyWinWrapper( CMainWindow* window,
                                   const QString& newLabel /*= {}*/ )
     : m_pWindow( window )
 {
+    this->m_pWindow->m_bLastJobCancelled = false;
     this->m_pWindow->SetWidgetsEnabled( false );
     this->m_pWindow->m_StatusWidget.SetVisible( true );
     this->m_pWindow->m_StatusWidget.SetLabel( newLabel );
@@ -0,0 +1,395 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "archivedirectorynode.hpp"
+#include "archivefilenode.hpp"
+#include "archivetree.hpp"
+#include "cancellationtoken.hpp"
+#include "extractionjournal.hpp"
+#include "extractionmanifest.hpp"
+#include "extractionstats.hpp"
+#include "gamedatainfo.hpp"
+#include "nodeextractionmgr.hpp"
+#include "workerpool.hpp"
+
+using namespace std::string_view_literals;
+
+//
+// uc2-cli, the archive core without a user interface, so packages can be
+// listed and extracted from scripts and machines without a display
+//
+
+// the names accepted by --provider, in GetGameProviderByIndex's order
+constexpr const std::string_view CLI_PROVIDER_NAMES[] = {
+    "nexon"sv, "tiancity"sv, "beancity"sv, "nexonjp"sv, "tfo"sv
+};
+
+struct CliOptions
+{
+    std::string szCommand;
+    std::vector<std::string> vArguments;
+
+    // zero uses a thread per hardware thread
+    std::size_t iThreadsNum = 0;
+    GameProvider provider = GameProvider::Unknown;
+
+    bool bDecrypt = true;
+    bool bDecompress = true;
+    bool bSkipUpToDate = false;
+    bool bShowHelp = false;
+};
+
+// set by Ctrl+C, the extraction stops between files and can be resumed
+static CancellationToken g_CancelToken;
+
+static void OnInterrupt( int )
+{
+    g_CancelToken.Cancel();
+}
+
+static void PrintUsage( std::ostream& out )
+{
+    out << "usage: uc2-cli [options] <command> <arguments>\n"
+           "\n"
+           "commands:\n"
+           "  list <pkg|index>                       lists every file\n"
+           "  extract <pkg|index> <outdir> <path>... extracts files and "
+           "directories\n"
+           "  extract-all <pkg|index> <outdir>       extracts every file\n"
+           "\n"
+           "options:\n"
+           "  --threads <num>    worker threads, defaults to one per "
+           "hardware thread\n"
+           "  --provider <name>  nexon, tiancity, beancity, nexonjp or tfo,\n"
+           "                     detected when it isn't given\n"
+           "  --no-decrypt       keeps the encrypted files as they are\n"
+           "  --no-decompress    keeps the textures compressed\n"
+           "  --skip-up-to-date  skips the files that were already extracted\n"
+           "  --help             shows this\n";
+}
+
+static bool ParseProvider( std::string_view providerName,
+                           GameProvider& outProvider )
+{
+    for ( int i = 0; i < static_cast<int>( std::size( CLI_PROVIDER_NAMES ) );
+          i++ )
+    {
+        if ( CLI_PROVIDER_NAMES[i] == providerName )
+        {
+            outProvider = GetGameProviderByIndex( i );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ParseArguments( int argc, char* argv[], CliOptions& outOptions )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string_view arg = argv[i];
+
+        if ( arg == "--threads"sv || arg == "--provider"sv )
+        {
+            if ( i + 1 >= argc )
+            {
+                std::cerr << arg << " needs a value\n";
+                return false;
+            }
+
+            const std::string_view value = argv[++i];
+
+            if ( arg == "--provider"sv )
+            {
+                if ( ParseProvider( value, outOptions.provider ) == false )
+                {
+                    std::cerr << "Unknown game provider " << value << '\n';
+                    return false;
+                }
+
+                continue;
+            }
+
+            char* pValueEnd = nullptr;
+            const unsigned long iThreadsNum =
+                std::strtoul( value.data(), &pValueEnd, 10 );
+
+            if ( value.empty() == true || *pValueEnd != '\0' )
+            {
+                std::cerr << "Invalid thread count " << value << '\n';
+                return false;
+            }
+
+            outOptions.iThreadsNum = iThreadsNum;
+        }
+        else if ( arg == "--no-decrypt"sv )
+        {
+            outOptions.bDecrypt = false;
+        }
+        else if ( arg == "--no-decompress"sv )
+        {
+            outOptions.bDecompress = false;
+        }
+        else if ( arg == "--skip-up-to-date"sv )
+        {
+            outOptions.bSkipUpToDate = true;
+        }
+        else if ( arg == "--help"sv )
+        {
+            outOptions.bShowHelp = true;
+        }
+        else if ( arg.size() > 2 && arg.substr( 0, 2 ) == "--"sv )
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return false;
+        }
+        else if ( outOptions.szCommand.empty() == true )
+        {
+            outOptions.szCommand = arg;
+        }
+        else
+        {
+            outOptions.vArguments.emplace_back( arg );
+        }
+    }
+
+    return true;
+}
+
+static bool LoadArchive( ArchiveTree& tree, const fs::path& archivePath,
+                         GameProvider provider )
+{
+    if ( archivePath.filename() != INDEX_FILENAME )
+    {
+        // the package's provider is detected when it's unknown
+        if ( tree.LoadPackage( archivePath, provider ) == false )
+        {
+            std::cerr << "Could not load " << archivePath.generic_string()
+                      << ": " << tree.GetError() << '\n';
+            return false;
+        }
+
+        return true;
+    }
+
+    if ( provider == GameProvider::Unknown )
+    {
+        GameDataInfo info( archivePath.parent_path() );
+        provider = info.GetGameProvider();
+
+        if ( info.WasGameDetected() == false )
+        {
+            std::cerr << "Could not detect the index's game provider, "
+                         "use --provider\n";
+            return false;
+        }
+    }
+
+    std::atomic<int> iLoadProgress = 0;
+    std::atomic<int> iPkgNum = 0;
+
+    // no metadata cache, every package gets parsed
+    if ( tree.LoadIndex( archivePath, provider, {}, iLoadProgress, iPkgNum,
+                         g_CancelToken ) == false )
+    {
+        std::cerr << "Could not load " << archivePath.generic_string() << ": "
+                  << tree.GetError() << '\n';
+        tree.Clear();
+        return false;
+    }
+
+    return true;
+}
+
+static void ListDirectoryNode( const ArchiveDirectoryNode* pDirNode )
+{
+    for ( std::size_t i = 0; i < pDirNode->GetNumOfChildren(); i++ )
+    {
+        ArchiveBaseNode* pChild = pDirNode->GetChild( i );
+
+        if ( pChild->IsDirectory() == true )
+        {
+            ListDirectoryNode( BaseToDirectoryNode( pChild ) );
+            continue;
+        }
+
+        std::cout << std::setw( 12 ) << pChild->GetDecryptedSize() << "  "
+                  << pChild->GetPath().generic_string() << '\n';
+    }
+}
+
+static int ExtractFromTree( ArchiveTree& tree, const CliOptions& options,
+                            const fs::path& outPath,
+                            const std::vector<ArchiveBaseNode*>& vNodes )
+{
+    std::atomic<int> iProgress = 0;
+
+    NodeExtractionMgr extractMgr(
+        tree.GetLoadedPkgFiles(), outPath, iProgress, g_CancelToken,
+        options.bDecrypt, options.bDecompress );
+
+    ExtractionStats stats;
+    extractMgr.SetStats( &stats );
+    // nothing else competes with it
+    extractMgr.SetPriority( WorkPriority::Interactive );
+
+    ExtractionManifest manifest( outPath );
+
+    if ( options.bSkipUpToDate == true )
+    {
+        manifest.Load();
+        extractMgr.SetManifest( &manifest );
+    }
+
+    // resumes an extraction to the same directory that didn't finish
+    ExtractionJournal journal( outPath );
+    journal.Open();
+    extractMgr.SetJournal( &journal );
+
+    std::atomic<bool> bFinished = false;
+    bool bExtracted = false;
+
+    std::thread extractThread( [&]() {
+        if ( vNodes.empty() == true )
+        {
+            bExtracted = extractMgr.ExtractPackages( tree.GetParentPath() );
+        }
+        else
+        {
+            auto vTargetNodes = vNodes;
+            auto snapshot = NodeExtractionMgr::TakeSnapshot(
+                vTargetNodes, tree.GetLoadedPkgFiles().GetCount() );
+            bExtracted =
+                extractMgr.ExtractSnapshot( snapshot, tree.GetParentPath() );
+        }
+
+        bFinished = true;
+    } );
+
+    ThroughputMeter meter( stats );
+
+    while ( bFinished == false )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+        const ThroughputSample sample = meter.Sample();
+        const uint64_t iPercent =
+            sample.iTotalBytes != 0
+                ? sample.iExtractedBytes * 100 / sample.iTotalBytes
+                : 0;
+
+        std::cerr << "\r" << iPercent << "% " << std::fixed
+                  << std::setprecision( 1 )
+                  << sample.fWrittenBytesPerSec / ( 1024.0 * 1024.0 )
+                  << " MB/s " << std::setprecision( 0 ) << sample.fFilesPerSec
+                  << " files/s    " << std::flush;
+    }
+
+    extractThread.join();
+    std::cerr << '\n';
+
+    // saved even if it failed or was cancelled, so the next extraction
+    // picks up where this one stopped
+    if ( options.bSkipUpToDate == true )
+    {
+        manifest.Save();
+    }
+
+    if ( bExtracted == true )
+    {
+        journal.Remove();
+    }
+
+    std::cerr << stats.GetExtractedFiles() << " files extracted, "
+              << stats.GetSkippedFiles() << " up to date\n";
+
+    if ( bExtracted == false )
+    {
+        std::cerr << ( g_CancelToken.IsCancelled() == true
+                           ? "The extraction was cancelled, run it again to "
+                             "resume it\n"
+                           : "The extraction failed\n" );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main( int argc, char* argv[] )
+{
+    CliOptions options;
+
+    if ( ParseArguments( argc, argv, options ) == false )
+    {
+        PrintUsage( std::cerr );
+        return EXIT_FAILURE;
+    }
+
+    if ( options.bShowHelp == true )
+    {
+        PrintUsage( std::cout );
+        return EXIT_SUCCESS;
+    }
+
+    const std::size_t iArgsNum = options.vArguments.size();
+    const bool bValidCommand =
+        ( options.szCommand == "list"sv && iArgsNum == 1 ) ||
+        ( options.szCommand == "extract"sv && iArgsNum >= 3 ) ||
+        ( options.szCommand == "extract-all"sv && iArgsNum == 2 );
+
+    if ( bValidCommand == false )
+    {
+        PrintUsage( std::cerr );
+        return EXIT_FAILURE;
+    }
+
+    // the pool is created when it's first used
+    WorkerPool::SetSharedThreadsNum( options.iThreadsNum );
+
+    std::signal( SIGINT, OnInterrupt );
+
+    ArchiveTree tree;
+
+    if ( LoadArchive( tree, options.vArguments[0], options.provider ) ==
+         false )
+    {
+        return EXIT_FAILURE;
+    }
+
+    if ( options.szCommand == "list"sv )
+    {
+        ListDirectoryNode( tree.GetRootNode() );
+        return EXIT_SUCCESS;
+    }
+
+    const fs::path outPath = options.vArguments[1];
+    std::vector<ArchiveBaseNode*> vNodes;
+
+    for ( std::size_t i = 2; i < iArgsNum; i++ )
+    {
+        ArchiveBaseNode* pNode = tree.FindNode( options.vArguments[i] );
+
+        if ( pNode == nullptr )
+        {
+            std::cerr << "There's no " << options.vArguments[i]
+                      << " in the archive\n";
+            return EXIT_FAILURE;
+        }
+
+        vNodes.push_back( pNode );
+    }
+
+    return ExtractFromTree( tree, options, outPath, vNodes );
+}
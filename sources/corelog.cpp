@@ -0,0 +1,38 @@
+#include "corelog.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+static void WriteToStandardError( LogLevel level, std::string_view message )
+{
+    // keeps the messages of different threads from interleaving
+    static std::mutex s_Lock;
+    std::lock_guard<std::mutex> lock( s_Lock );
+
+    switch ( level )
+    {
+        case LogLevel::Warning:
+            std::cerr << "warning: ";
+            break;
+        case LogLevel::Critical:
+            std::cerr << "error: ";
+            break;
+        default:
+            break;
+    }
+
+    std::cerr << message << '\n';
+}
+
+static std::atomic<LogSinkFn> s_LogSink = &WriteToStandardError;
+
+void SetLogSink( LogSinkFn sink ) noexcept
+{
+    s_LogSink.store( sink != nullptr ? sink : &WriteToStandardError );
+}
+
+void WriteLogMessage( LogLevel level, std::string_view message )
+{
+    s_LogSink.load()( level, message );
+}
@@ -1,9 +1,9 @@
 #include "dynindexfilefactory.hpp"
 
 #include <array>
+#include <cassert>
 
-#include <QDebug>
-
+#include "corelog.hpp"
 #include "indexkeycollections.hpp"
 
 using namespace std::string_view_literals;
@@ -25,9 +25,31 @@ uc2::PkgIndex::ptr_t&& DynamicIndexFileFactory::GetPkgIndexOwnership() noexcept
     return std::move( this->m_pPkgIndex );
 }
 
+std::vector<std::string_view> DynamicIndexFileFactory::GetPkgFilenames(
+    uc2::PkgIndex* pIndex )
+{
+    const auto& fileEntries = pIndex->GetFilenames();
+    std::vector<std::string_view> vFilenames;
+
+    if ( fileEntries.empty() == false )
+    {
+        auto cur = fileEntries.begin();
+        cur++;  // skip first entry since it's the index file's name
+        for ( ; cur != fileEntries.end(); cur++ )
+        {
+            if ( cur->find( ".pkg" ) != std::string::npos )
+            {
+                vFilenames.push_back( *cur );
+            }
+        }
+    }
+
+    return vFilenames;
+}
+
 bool DynamicIndexFileFactory::TryDetectProvider()
 {
-    Q_ASSERT( this->m_vIndexData.empty() == false );
+    assert( this->m_vIndexData.empty() == false );
 
     std::string szFilename = this->m_IndexFilePath.filename().generic_string();
 
@@ -67,7 +89,7 @@ bool DynamicIndexFileFactory::TestCsKeys( uc2::PkgIndex* pIndexFile )
     }
     catch ( const std::exception& e )
     {
-        qDebug() << e.what();
+        LogDebug( e.what() );
         return false;
     }
 
@@ -85,7 +107,7 @@ bool DynamicIndexFileFactory::TestTfoKeys( uc2::PkgIndex* pIndexFile )
     }
     catch ( const std::exception& e )
     {
-        qDebug() << e.what();
+        LogDebug( e.what() );
         return false;
     }
 
@@ -1,53 +1,22 @@
 #include "dynpkgfilefactory.hpp"
 
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <string>
 
-#include <QDebug>
-
+#include "corelog.hpp"
 #include "fsutils.hpp"
 #include "miscutils.hpp"
+#include "pkgkeys.hpp"
+#include "workerpool.hpp"
 
-using namespace std::string_view_literals;
-
-constexpr const std::array<std::string_view, 4> PACKAGE_ENTRY_KEYS = {
-    "lkgui781kl789sd!@#%89&^sd"sv,  // Nexon
-    "\x9B\x65\xC7\x9B\xC7\xDF\x8E\x7E\xD4\xC6\x59\x52\x5C\xF7\x22\xFF\xF4\xE8\xFF\xE7\xB5\xC2\x77"sv,  // Tiancity
-    "\x86\x39\x53\xBD\x16\x11\x6D\x06\x2A\x84\xF3\x4E\xE0\x4A\xA3"sv,  // Beancity
-    "lkgui781kl789sd!@#%89&^sd"sv,  // NexonJP
+// the providers tried when detecting one, by order of preference
+constexpr const std::array<GameProvider, 5> DETECTABLE_PROVIDERS = {
+    GameProvider::Nexon, GameProvider::Tiancity, GameProvider::Beancity,
+    GameProvider::NexonJP, GameProvider::Tfo
 };
 
-constexpr const std::array<std::string_view, 4> PACKAGE_DATA_KEYS = {
-    "^9gErg2Sx7bnk7@#sdfjnh@"sv,  // Nexon
-    "\x8E\x5C\xB8\x92\x45\xD1\x90\xBA\x82\x0F\xD9\x7A\x99\x8E\xB3\x87\xF7"sv,  // Tiancity
-    "\x1F\x9F\xF8\xF4\x18\xAC\x25\xA2\xBB\x37\x82\x6D\xA8\xAE\xA7\x28\xBA\xDD\xDD\xE4\x6B"sv,  // Beancity
-    "^9gErg2Sx7bnk7@#sdfjnh@"sv,  // NexonJP
-};
-
-constexpr const std::string_view TFO_PACKAGE_ENTRY_KEY =
-    "lkgui781kl789sd!@#%89&^sd"sv;
-constexpr const std::string_view TFO_PACKAGE_DATA_KEY =
-    "^9gErg2Sx7bnk7@#sdfjnh@"sv;
-
-inline constexpr std::pair<std::string_view, std::string_view>
-GetPackageKeysByProvider( GameProvider provider ) noexcept
-{
-    switch ( provider )
-    {
-        case GameProvider::Nexon:
-            return { PACKAGE_ENTRY_KEYS[0], PACKAGE_DATA_KEYS[0] };
-        case GameProvider::Tiancity:
-            return { PACKAGE_ENTRY_KEYS[1], PACKAGE_DATA_KEYS[1] };
-        case GameProvider::Beancity:
-            return { PACKAGE_ENTRY_KEYS[2], PACKAGE_DATA_KEYS[2] };
-        case GameProvider::NexonJP:
-            return { PACKAGE_ENTRY_KEYS[3], PACKAGE_DATA_KEYS[3] };
-        case GameProvider::Tfo:
-            return { TFO_PACKAGE_ENTRY_KEY, TFO_PACKAGE_DATA_KEY };
-        default:
-            return {};
-    }
-}
-
 DynamicPkgFileFactory::DynamicPkgFileFactory( const fs::path& pkgFilePath )
     : m_PkgFilePath( pkgFilePath ), m_DetectedProvider( GameProvider::Unknown )
 {
@@ -67,8 +36,9 @@ DynamicPkgFileFactory::DynamicPkgFileFactory( const fs::path& pkgFilePath )
     }
 }
 
-DynamicPkgFileFactory::DynamicPkgFileFactory( const fs::path& pkgFilePath,
-                                              GameProvider provider )
+DynamicPkgFileFactory::DynamicPkgFileFactory(
+    const fs::path& pkgFilePath, GameProvider provider,
+    LoadMode loadMode /*= LoadMode::FullHeader*/ )
     : m_PkgFilePath( pkgFilePath ), m_DetectedProvider( GameProvider::Unknown )
 {
     if ( this->LoadBaseFileHeader() == false )
@@ -88,7 +58,8 @@ DynamicPkgFileFactory::DynamicPkgFileFactory( const fs::path& pkgFilePath,
         throw std::invalid_argument( "Failed to use specific game's provider" );
     }
 
-    if ( this->LoadFullFileHeader() == false )
+    if ( loadMode != LoadMode::BaseHeader &&
+         this->LoadFullFileHeader( loadMode == LoadMode::WholeFile ) == false )
     {
         throw std::runtime_error( "Could not load the PKG file's full header" );
     }
@@ -117,12 +88,14 @@ bool DynamicPkgFileFactory::LoadBaseFileHeader()
     return true;
 }
 
-bool DynamicPkgFileFactory::LoadFullFileHeader()
+bool DynamicPkgFileFactory::LoadFullFileHeader( bool bWholeFile /*= false*/ )
 {
-    const uint64_t iFullHeaderSize = this->m_pPkgFile->GetFullHeaderSize();
+    // a length of zero reads the whole file
+    const uint64_t iReadLength =
+        bWholeFile == true ? 0 : this->m_pPkgFile->GetFullHeaderSize();
 
     auto [bPkgRead, vPkgData] =
-        ReadFileToBuffer( this->m_PkgFilePath, iFullHeaderSize );
+        ReadFileToBuffer( this->m_PkgFilePath, iReadLength );
 
     if ( bPkgRead == false )
     {
@@ -134,101 +107,105 @@ bool DynamicPkgFileFactory::LoadFullFileHeader()
     return this->m_pPkgFile->DecryptHeader();
 }
 
+//
+// Tries every known provider's keys at the same time, each one on its own
+// copy of the base header, and keeps the first provider that decrypts it
+//
+// The base header is only a small prefix of the package, so the copies are
+// cheap, and the full header is decrypted just once by LoadFullFileHeader
+//
 bool DynamicPkgFileFactory::TryDetectProvider()
 {
-    Q_ASSERT( this->m_vPkgFileData.empty() == false );
+    assert( this->m_vPkgFileData.empty() == false );
 
-    this->m_pPkgFile = uc2::PkgFile::Create(
-        this->m_PkgFilePath.filename().generic_string(), this->m_vPkgFileData );
+    const std::string pkgFilename =
+        this->m_PkgFilePath.filename().generic_string();
 
-    auto csRes = DynamicPkgFileFactory::TestCsKeys( this->m_pPkgFile.get(),
-                                                    this->m_vPkgFileData );
+    std::array<std::vector<uint8_t>, DETECTABLE_PROVIDERS.size()> vTrialData;
+    std::array<uc2::PkgFile::ptr_t, DETECTABLE_PROVIDERS.size()> trialPkgs;
+    std::atomic<size_t> iNextProvider = 0;
 
-    if ( csRes.first == true )
+    for ( size_t i = 0; i < DETECTABLE_PROVIDERS.size(); i++ )
     {
-        this->m_DetectedProvider = csRes.second;
-        return true;
+        vTrialData[i] = this->m_vPkgFileData;
     }
 
-    if ( DynamicPkgFileFactory::TestTfoKeys( this->m_pPkgFile.get() ) == true )
+    auto tryProviders = [&]() {
+        for ( size_t i = iNextProvider++; i < DETECTABLE_PROVIDERS.size();
+              i = iNextProvider++ )
+        {
+            trialPkgs[i] = DynamicPkgFileFactory::TryDecryptWithProvider(
+                pkgFilename, vTrialData[i], DETECTABLE_PROVIDERS[i] );
+        }
+    };
+
+    WorkerPool::GetShared().RunConcurrently( DETECTABLE_PROVIDERS.size(),
+                                             WorkPriority::Interactive,
+                                             tryProviders );
+
+    for ( size_t i = 0; i < DETECTABLE_PROVIDERS.size(); i++ )
     {
-        this->m_DetectedProvider = GameProvider::Tfo;
-        return true;
+        if ( trialPkgs[i] != nullptr )
+        {
+            // moving the vector keeps its storage, which the package uses
+            this->m_vPkgFileData = std::move( vTrialData[i] );
+            this->m_pPkgFile = std::move( trialPkgs[i] );
+            this->m_DetectedProvider = DETECTABLE_PROVIDERS[i];
+            return true;
+        }
     }
 
-    this->m_pPkgFile.release();
     return false;
 }
 
 bool DynamicPkgFileFactory::TrySpecificProvider( GameProvider provider )
 {
-    Q_ASSERT( provider != GameProvider::Unknown );
-    Q_ASSERT( this->m_vPkgFileData.empty() == false );
-
-    this->m_DetectedProvider = provider;
+    assert( provider != GameProvider::Unknown );
+    assert( this->m_vPkgFileData.empty() == false );
 
-    auto [entryKey, dataKey] =
-        GetPackageKeysByProvider( this->m_DetectedProvider );
-
-    const bool bIsTfoPkg = provider == GameProvider::Tfo;
-
-    uc2::PkgFileOptions::ptr_t pOptions;
-
-    if ( bIsTfoPkg == true )
-    {
-        pOptions = uc2::PkgFileOptions::Create();
-        pOptions->SetTfoPkg( true );
-    }
-
-    this->m_pPkgFile = uc2::PkgFile::Create(
+    this->m_pPkgFile = DynamicPkgFileFactory::TryDecryptWithProvider(
         this->m_PkgFilePath.filename().generic_string(), this->m_vPkgFileData,
-        CopyViewToNewStr( entryKey ), CopyViewToNewStr( dataKey ),
-        pOptions.get() );
+        provider );
 
-    if ( this->m_pPkgFile->DecryptHeader() == false )
+    if ( this->m_pPkgFile == nullptr )
     {
-        this->m_pPkgFile.release();
         return false;
     }
 
+    this->m_DetectedProvider = provider;
     return true;
 }
 
-std::pair<bool, GameProvider> DynamicPkgFileFactory::TestCsKeys(
-    uc2::PkgFile* pPkgFile, std::vector<uint8_t>& vPkgFileData )
+uc2::PkgFile::ptr_t DynamicPkgFileFactory::TryDecryptWithProvider(
+    const std::string& pkgFilename, std::vector<uint8_t>& vPkgFileData,
+    GameProvider provider ) noexcept
 {
-    std::vector<uint8_t> vBackupPkgData = vPkgFileData;
+    auto [entryKey, dataKey] = GetPackageKeysByProvider( provider );
 
-    for ( size_t i = 0; i < PACKAGE_ENTRY_KEYS.size(); i++ )
+    try
     {
-        try
-        {
-            pPkgFile->SetEntryKey( PACKAGE_ENTRY_KEYS[i].data() );
-            pPkgFile->SetDataKey( PACKAGE_DATA_KEYS[i].data() );
-
-            if ( pPkgFile->DecryptHeader() == true )
-            {
-                return { true,
-                         GetGameProviderByIndex( gsl::narrow_cast<int>( i ) ) };
-            }
+        uc2::PkgFileOptions::ptr_t pOptions;
 
-            vPkgFileData = vBackupPkgData;
-        }
-        catch ( const std::exception& e )
+        if ( provider == GameProvider::Tfo )
         {
-            qDebug() << e.what();
-            continue;
+            pOptions = uc2::PkgFileOptions::Create();
+            pOptions->SetTfoPkg( true );
         }
-    }
 
-    return { false, GameProvider::Unknown };
-}
+        auto pPkgFile = uc2::PkgFile::Create(
+            pkgFilename, vPkgFileData, CopyViewToNewStr( entryKey ),
+            CopyViewToNewStr( dataKey ), pOptions.get() );
 
-bool DynamicPkgFileFactory::TestTfoKeys( uc2::PkgFile* pPkgFile )
-{
-    pPkgFile->SetTfoPkg( true );
-    pPkgFile->SetEntryKey( TFO_PACKAGE_ENTRY_KEY.data() );
-    pPkgFile->SetDataKey( TFO_PACKAGE_DATA_KEY.data() );
+        if ( pPkgFile->DecryptHeader() == false )
+        {
+            return nullptr;
+        }
 
-    return pPkgFile->DecryptHeader();
+        return pPkgFile;
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( e.what() );
+        return nullptr;
+    }
 }
@@ -0,0 +1,45 @@
+#include "entryflagdetection.hpp"
+
+#include <algorithm>
+
+#include <uc2/encryptedfile.hpp>
+#include <uc2/lzmatexture.hpp>
+#include <uc2/pkgentry.hpp>
+
+#include "corelog.hpp"
+#include "miscutils.hpp"
+
+// the headers of both special file types fit in the first decrypted block
+constexpr const uint64_t ENTRY_DETECTION_BYTES = 512;
+
+EntryFlagDetection::EntryFlagDetection( gsl::not_null<uc2::PkgEntry*> pEntry )
+    : m_bEncryptedFile( false ), m_bLzmaTexture( false )
+{
+    const uint64_t iBytesToDecrypt =
+        std::min( ENTRY_DETECTION_BYTES, pEntry->GetDecryptedSize() );
+
+    if ( iBytesToDecrypt == 0 )
+    {
+        return;
+    }
+
+    try
+    {
+        auto entryData = PairToSpan( pEntry->DecryptFile( iBytesToDecrypt ) );
+        this->DetectSpecialTypes( entryData );
+    }
+    catch ( const std::exception& e )
+    {
+        LogDebug( "Failed to detect the type of entry",
+                  pEntry->GetFilePath(), "with error", e.what() );
+    }
+}
+
+void EntryFlagDetection::DetectSpecialTypes(
+    gsl::span<uint8_t> entryData ) noexcept
+{
+    this->m_bEncryptedFile = uc2::EncryptedFile::IsEncryptedFile(
+        entryData.data(), entryData.size_bytes() );
+    this->m_bLzmaTexture = uc2::LzmaTexture::IsLzmaTexture(
+        entryData.data(), entryData.size_bytes() );
+}
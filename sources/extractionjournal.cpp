@@ -0,0 +1,434 @@
+#include "extractionjournal.hpp"
+
+#include <array>
+#include <string_view>
+
+#include <gsl/gsl>
+
+#include "binarybuffer.hpp"
+#include "corelog.hpp"
+#include "fsutils.hpp"
+
+constexpr const std::array<char, 8> JOURNAL_FILE_MAGIC = {
+    'U', 'C', '2', 'X', 'J', 'R', 'N', 'L'
+};
+// bump it when the layout changes
+constexpr const uint32_t JOURNAL_FILE_VERSION = 1;
+
+constexpr const std::string_view JOURNAL_FILENAME = ".uncso2journal";
+
+// how much of the journaled files are kept in memory before being written
+constexpr const std::size_t JOURNAL_MAX_PENDING_BYTES = 64 * 1024;
+
+enum JournalRecordType : uint8_t
+{
+    JRT_File = 1,
+    JRT_PkgFile = 2,
+    JRT_FailedPkgFile = 3,
+};
+
+// FNV-1a, enough to find records torn by a crash
+static uint32_t GetRecordChecksum( gsl::span<const uint8_t> payload ) noexcept
+{
+    uint32_t iHash = 2166136261u;
+
+    for ( auto&& byte : payload )
+    {
+        iHash ^= byte;
+        iHash *= 16777619u;
+    }
+
+    return iHash;
+}
+
+static void WriteStamp( BinaryBufferWriter& writer,
+                        const PkgFileStamp& stamp )
+{
+    writer.Write( stamp.iFileSize );
+    writer.Write( stamp.iModifiedTime );
+    writer.Write( stamp.baseHeaderMd5 );
+}
+
+static bool ReadStamp( BinaryBufferReader& reader, PkgFileStamp& outStamp )
+{
+    return reader.Read( outStamp.iFileSize ) == true &&
+           reader.Read( outStamp.iModifiedTime ) == true &&
+           reader.Read( outStamp.baseHeaderMd5 ) == true;
+}
+
+static void WriteSource( BinaryBufferWriter& writer,
+                         const ExtractedFileSource& source )
+{
+    writer.WriteString( source.szPkgFilename );
+    WriteStamp( writer, source.pkgStamp );
+    writer.WriteString( source.szEntryPath );
+    writer.Write( source.iEntryBytes );
+    writer.Write( source.iOptions );
+}
+
+static bool ReadSource( BinaryBufferReader& reader,
+                        ExtractedFileSource& outSource )
+{
+    return reader.ReadString( outSource.szPkgFilename ) == true &&
+           ReadStamp( reader, outSource.pkgStamp ) == true &&
+           reader.ReadString( outSource.szEntryPath ) == true &&
+           reader.Read( outSource.iEntryBytes ) == true &&
+           reader.Read( outSource.iOptions ) == true;
+}
+
+ExtractionJournal::ExtractionJournal( const fs::path& outPath )
+    : m_JournalPath( outPath / JOURNAL_FILENAME )
+{
+}
+
+ExtractionJournal::~ExtractionJournal()
+{
+    this->Flush();
+}
+
+bool ExtractionJournal::Open()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    // reopened, what was added so far is read back with the rest, and
+    // nothing is kept from a journal that was removed in the meantime
+    this->FlushInternal();
+
+    if ( this->m_JournalStream.is_open() == true )
+    {
+        this->m_JournalStream.close();
+    }
+
+    this->m_Files.clear();
+    this->m_PkgFiles.clear();
+    this->m_FailedPkgFiles.clear();
+
+    std::error_code errorCode;
+
+    if ( fs::exists( this->m_JournalPath, errorCode ) == false )
+    {
+        // nothing to resume
+        return true;
+    }
+
+    auto [bJournalRead, vJournalData] =
+        ReadFileToBuffer( this->m_JournalPath );
+
+    if ( bJournalRead == false )
+    {
+        return false;
+    }
+
+    BinaryBufferReader reader( vJournalData );
+
+    std::array<char, JOURNAL_FILE_MAGIC.size()> magic;
+    uint32_t iVersion;
+
+    if ( reader.Read( magic ) == false || magic != JOURNAL_FILE_MAGIC ||
+         reader.Read( iVersion ) == false ||
+         iVersion != JOURNAL_FILE_VERSION )
+    {
+        fs::remove( this->m_JournalPath, errorCode );
+        return false;
+    }
+
+    std::size_t iValidBytes = vJournalData.size() - reader.GetBytesLeft();
+
+    while ( reader.GetBytesLeft() != 0 )
+    {
+        uint32_t iPayloadSize;
+        uint32_t iChecksum;
+
+        if ( reader.Read( iPayloadSize ) == false ||
+             reader.Read( iChecksum ) == false ||
+             reader.GetBytesLeft() < iPayloadSize )
+        {
+            break;
+        }
+
+        const std::size_t iPayloadOffset =
+            vJournalData.size() - reader.GetBytesLeft();
+        gsl::span<const uint8_t> payload( &vJournalData[iPayloadOffset],
+                                          iPayloadSize );
+
+        if ( GetRecordChecksum( payload ) != iChecksum )
+        {
+            break;
+        }
+
+        BinaryBufferReader payloadReader( payload );
+        uint8_t iType;
+        bool bRecordRead = payloadReader.Read( iType );
+
+        if ( bRecordRead == true && iType == JRT_File )
+        {
+            JournaledFile file;
+            bRecordRead =
+                payloadReader.ReadString( file.szTargetPath ) == true &&
+                ReadSource( payloadReader, file.source ) == true &&
+                payloadReader.ReadString( file.szResultPath ) == true;
+
+            if ( bRecordRead == true )
+            {
+                std::string szTargetPath = file.szTargetPath;
+                this->m_Files[szTargetPath] = std::move( file );
+            }
+        }
+        else if ( bRecordRead == true && iType == JRT_PkgFile )
+        {
+            std::string szPkgFilename;
+            DonePkgFile pkgFile;
+            bRecordRead = payloadReader.ReadString( szPkgFilename ) == true &&
+                          ReadStamp( payloadReader, pkgFile.stamp ) == true &&
+                          payloadReader.Read( pkgFile.iOptions ) == true;
+
+            if ( bRecordRead == true )
+            {
+                this->m_FailedPkgFiles.erase( szPkgFilename );
+                this->m_PkgFiles[szPkgFilename] = pkgFile;
+            }
+        }
+        else if ( bRecordRead == true && iType == JRT_FailedPkgFile )
+        {
+            std::string szPkgFilename;
+            std::string szError;
+            bRecordRead = payloadReader.ReadString( szPkgFilename ) == true &&
+                          payloadReader.ReadString( szError ) == true;
+
+            if ( bRecordRead == true )
+            {
+                this->m_FailedPkgFiles[szPkgFilename] = std::move( szError );
+            }
+        }
+
+        if ( bRecordRead == false )
+        {
+            break;
+        }
+
+        reader.Skip( iPayloadSize );
+        iValidBytes = iPayloadOffset + iPayloadSize;
+    }
+
+    // drop the torn tail, so the new records don't end up after it
+    if ( iValidBytes != vJournalData.size() )
+    {
+        LogWarning( "Dropping a torn record from",
+                    this->m_JournalPath.generic_string() );
+
+        vJournalData.resize( iValidBytes );
+
+        if ( ReplaceFileWithBuffer( this->m_JournalPath, vJournalData ) ==
+             false )
+        {
+            this->m_Files.clear();
+            this->m_PkgFiles.clear();
+            this->m_FailedPkgFiles.clear();
+            fs::remove( this->m_JournalPath, errorCode );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ExtractionJournal::Remove()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->m_Files.clear();
+    this->m_PkgFiles.clear();
+    this->m_FailedPkgFiles.clear();
+    this->m_vPendingRecords.clear();
+
+    if ( this->m_JournalStream.is_open() == true )
+    {
+        this->m_JournalStream.close();
+    }
+
+    std::error_code errorCode;
+    fs::remove( this->m_JournalPath, errorCode );
+}
+
+bool ExtractionJournal::IsFileDone( const std::string& szTargetPath,
+                                    const ExtractedFileSource& source,
+                                    std::string& outResultPath )
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    auto it = this->m_Files.find( szTargetPath );
+
+    if ( it == this->m_Files.end() || ( it->second.source == source ) == false )
+    {
+        return false;
+    }
+
+    outResultPath = it->second.szResultPath;
+    return true;
+}
+
+bool ExtractionJournal::IsPkgFileDone( const std::string& szPkgFilename,
+                                       const PkgFileStamp& pkgStamp,
+                                       uint8_t iOptions )
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    auto it = this->m_PkgFiles.find( szPkgFilename );
+
+    return it != this->m_PkgFiles.end() && it->second.stamp == pkgStamp &&
+           it->second.iOptions == iOptions;
+}
+
+std::vector<ExtractionJournal::JournaledFile>
+ExtractionJournal::GetPkgFileFiles( const std::string& szPkgFilename )
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    std::vector<JournaledFile> vPkgFiles;
+
+    for ( auto&& [szTargetPath, file] : this->m_Files )
+    {
+        if ( file.source.szPkgFilename == szPkgFilename )
+        {
+            vPkgFiles.push_back( file );
+        }
+    }
+
+    return vPkgFiles;
+}
+
+std::unordered_map<std::string, std::string>
+ExtractionJournal::GetFailedPkgFiles()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+    return this->m_FailedPkgFiles;
+}
+
+void ExtractionJournal::AddFile( JournaledFile file )
+{
+    std::vector<uint8_t> vPayload;
+    BinaryBufferWriter writer( vPayload );
+
+    writer.Write( JRT_File );
+    writer.WriteString( file.szTargetPath );
+    WriteSource( writer, file.source );
+    writer.WriteString( file.szResultPath );
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->AppendRecord( vPayload );
+
+    std::string szTargetPath = file.szTargetPath;
+    this->m_Files[szTargetPath] = std::move( file );
+
+    if ( this->m_vPendingRecords.size() >= JOURNAL_MAX_PENDING_BYTES )
+    {
+        this->FlushInternal();
+    }
+}
+
+void ExtractionJournal::AddPkgFile( const std::string& szPkgFilename,
+                                    const PkgFileStamp& pkgStamp,
+                                    uint8_t iOptions )
+{
+    std::vector<uint8_t> vPayload;
+    BinaryBufferWriter writer( vPayload );
+
+    writer.Write( JRT_PkgFile );
+    writer.WriteString( szPkgFilename );
+    WriteStamp( writer, pkgStamp );
+    writer.Write( iOptions );
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->AppendRecord( vPayload );
+    this->m_FailedPkgFiles.erase( szPkgFilename );
+    this->m_PkgFiles[szPkgFilename] = { pkgStamp, iOptions };
+
+    this->FlushInternal();
+}
+
+void ExtractionJournal::AddFailedPkgFile( const std::string& szPkgFilename,
+                                          const std::string& szError )
+{
+    std::vector<uint8_t> vPayload;
+    BinaryBufferWriter writer( vPayload );
+
+    writer.Write( JRT_FailedPkgFile );
+    writer.WriteString( szPkgFilename );
+    writer.WriteString( szError );
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->AppendRecord( vPayload );
+    this->m_FailedPkgFiles[szPkgFilename] = szError;
+
+    this->FlushInternal();
+}
+
+void ExtractionJournal::Flush()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+    this->FlushInternal();
+}
+
+void ExtractionJournal::AppendRecord( const std::vector<uint8_t>& vPayload )
+{
+    BinaryBufferWriter writer( this->m_vPendingRecords );
+
+    writer.Write( gsl::narrow<uint32_t>( vPayload.size() ) );
+    writer.Write( GetRecordChecksum( vPayload ) );
+
+    this->m_vPendingRecords.insert( this->m_vPendingRecords.end(),
+                                    vPayload.begin(), vPayload.end() );
+}
+
+void ExtractionJournal::FlushInternal()
+{
+    if ( this->m_vPendingRecords.empty() == true )
+    {
+        return;
+    }
+
+    if ( this->m_JournalStream.is_open() == false )
+    {
+        std::error_code errorCode;
+        const bool bNewJournal =
+            fs::exists( this->m_JournalPath, errorCode ) == false;
+
+        if ( CreateDirIfUnexisting( this->m_JournalPath.parent_path() ) ==
+             false )
+        {
+            this->m_vPendingRecords.clear();
+            return;
+        }
+
+        this->m_JournalStream.open( this->m_JournalPath,
+                                    std::ios::binary | std::ios::app );
+
+        if ( bNewJournal == true )
+        {
+            std::vector<uint8_t> vHeader;
+            BinaryBufferWriter writer( vHeader );
+            writer.Write( JOURNAL_FILE_MAGIC );
+            writer.Write( JOURNAL_FILE_VERSION );
+
+            this->m_JournalStream.write(
+                reinterpret_cast<const char*>( vHeader.data() ),
+                gsl::narrow_cast<std::streamsize>( vHeader.size() ) );
+        }
+    }
+
+    this->m_JournalStream.write(
+        reinterpret_cast<const char*>( this->m_vPendingRecords.data() ),
+        gsl::narrow_cast<std::streamsize>( this->m_vPendingRecords.size() ) );
+    this->m_JournalStream.flush();
+
+    if ( this->m_JournalStream.fail() == true )
+    {
+        LogWarning( "Could not write to the extraction journal",
+                    this->m_JournalPath.generic_string() );
+    }
+
+    this->m_vPendingRecords.clear();
+}
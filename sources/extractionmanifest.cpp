@@ -0,0 +1,271 @@
+#include "extractionmanifest.hpp"
+
+#include <array>
+#include <string_view>
+
+#include <gsl/gsl>
+
+#include "binarybuffer.hpp"
+#include "corelog.hpp"
+#include "fsutils.hpp"
+
+constexpr const std::array<char, 8> MANIFEST_FILE_MAGIC = {
+    'U', 'C', '2', 'X', 'M', 'N', 'F', 'T'
+};
+// bump it when the layout changes
+constexpr const uint32_t MANIFEST_FILE_VERSION = 1;
+
+constexpr const std::string_view MANIFEST_FILENAME = ".uncso2manifest";
+
+static bool ReadFileSizeAndTime( const fs::path& filePath,
+                                 uint64_t& outSize,
+                                 int64_t& outModifiedTime )
+{
+    std::error_code errorCode;
+
+    outSize = fs::file_size( filePath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    const auto modifiedTime = fs::last_write_time( filePath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    outModifiedTime = modifiedTime.time_since_epoch().count();
+    return true;
+}
+
+bool ExtractedFileSource::operator==(
+    const ExtractedFileSource& other ) const noexcept
+{
+    return this->szPkgFilename == other.szPkgFilename &&
+           this->pkgStamp == other.pkgStamp &&
+           this->szEntryPath == other.szEntryPath &&
+           this->iEntryBytes == other.iEntryBytes &&
+           this->iOptions == other.iOptions;
+}
+
+ExtractionManifest::ExtractionManifest( const fs::path& outPath )
+    : m_OutPath( outPath ), m_ManifestPath( outPath / MANIFEST_FILENAME ),
+      m_bChanged( false )
+{
+}
+
+bool ExtractionManifest::Load()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->m_Files.clear();
+    this->m_PkgFileTargets.clear();
+    this->m_bChanged = false;
+
+    auto [bManifestRead, vManifestData] =
+        ReadFileToBuffer( this->m_ManifestPath );
+
+    if ( bManifestRead == false )
+    {
+        return false;
+    }
+
+    BinaryBufferReader reader( vManifestData );
+
+    std::array<char, MANIFEST_FILE_MAGIC.size()> magic;
+    uint32_t iVersion;
+    uint32_t iFilesNum;
+
+    if ( reader.Read( magic ) == false || magic != MANIFEST_FILE_MAGIC ||
+         reader.Read( iVersion ) == false ||
+         iVersion != MANIFEST_FILE_VERSION ||
+         reader.Read( iFilesNum ) == false )
+    {
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < iFilesNum; i++ )
+    {
+        std::string szTargetPath;
+        ExtractedFile file;
+
+        if ( reader.ReadString( szTargetPath ) == false ||
+             reader.ReadString( file.source.szPkgFilename ) == false ||
+             reader.Read( file.source.pkgStamp.iFileSize ) == false ||
+             reader.Read( file.source.pkgStamp.iModifiedTime ) == false ||
+             reader.Read( file.source.pkgStamp.baseHeaderMd5 ) == false ||
+             reader.ReadString( file.source.szEntryPath ) == false ||
+             reader.Read( file.source.iEntryBytes ) == false ||
+             reader.Read( file.source.iOptions ) == false ||
+             reader.ReadString( file.szResultPath ) == false ||
+             reader.Read( file.iResultSize ) == false ||
+             reader.Read( file.iResultModifiedTime ) == false )
+        {
+            this->m_Files.clear();
+            this->m_PkgFileTargets.clear();
+            return false;
+        }
+
+        this->m_PkgFileTargets[file.source.szPkgFilename].push_back(
+            szTargetPath );
+        this->m_Files[szTargetPath] = std::move( file );
+    }
+
+    return true;
+}
+
+bool ExtractionManifest::Save()
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    if ( this->m_bChanged == false )
+    {
+        return true;
+    }
+
+    std::vector<uint8_t> vManifestData;
+    BinaryBufferWriter writer( vManifestData );
+
+    writer.Write( MANIFEST_FILE_MAGIC );
+    writer.Write( MANIFEST_FILE_VERSION );
+    writer.Write( gsl::narrow<uint32_t>( this->m_Files.size() ) );
+
+    for ( auto&& [szTargetPath, file] : this->m_Files )
+    {
+        writer.WriteString( szTargetPath );
+        writer.WriteString( file.source.szPkgFilename );
+        writer.Write( file.source.pkgStamp.iFileSize );
+        writer.Write( file.source.pkgStamp.iModifiedTime );
+        writer.Write( file.source.pkgStamp.baseHeaderMd5 );
+        writer.WriteString( file.source.szEntryPath );
+        writer.Write( file.source.iEntryBytes );
+        writer.Write( file.source.iOptions );
+        writer.WriteString( file.szResultPath );
+        writer.Write( file.iResultSize );
+        writer.Write( file.iResultModifiedTime );
+    }
+
+    if ( ReplaceFileWithBuffer( this->m_ManifestPath, vManifestData ) ==
+         false )
+    {
+        LogWarning( "Could not write the extraction manifest to",
+                    this->m_ManifestPath.generic_string() );
+        return false;
+    }
+
+    this->m_bChanged = false;
+    return true;
+}
+
+bool ExtractionManifest::IsUpToDate( const std::string& szTargetPath,
+                                     const ExtractedFileSource& source )
+{
+    ExtractedFile file;
+
+    {
+        std::lock_guard<std::mutex> lock( this->m_Lock );
+
+        auto it = this->m_Files.find( szTargetPath );
+
+        if ( it == this->m_Files.end() )
+        {
+            return false;
+        }
+
+        file = it->second;
+    }
+
+    return file.source == source && this->IsResultUnchanged( file );
+}
+
+std::size_t ExtractionManifest::CountUpToDate(
+    const std::string& szPkgFilename, const PkgFileStamp& pkgStamp,
+    uint8_t iOptions )
+{
+    std::vector<ExtractedFile> vPkgFiles;
+
+    {
+        std::lock_guard<std::mutex> lock( this->m_Lock );
+
+        auto it = this->m_PkgFileTargets.find( szPkgFilename );
+
+        if ( it == this->m_PkgFileTargets.end() )
+        {
+            return 0;
+        }
+
+        for ( auto&& szTargetPath : it->second )
+        {
+            auto fileIt = this->m_Files.find( szTargetPath );
+
+            // it may have been extracted from another package since
+            if ( fileIt == this->m_Files.end() ||
+                 fileIt->second.source.szPkgFilename != szPkgFilename )
+            {
+                continue;
+            }
+
+            // entry paths start at the root
+            const std::string& szEntryPath = fileIt->second.source.szEntryPath;
+
+            if ( szEntryPath.empty() == false &&
+                 szEntryPath.compare( 1, std::string::npos, szTargetPath ) ==
+                     0 )
+            {
+                vPkgFiles.push_back( fileIt->second );
+            }
+        }
+    }
+
+    std::size_t iUpToDateNum = 0;
+
+    for ( auto&& file : vPkgFiles )
+    {
+        if ( file.source.pkgStamp == pkgStamp &&
+             file.source.iOptions == iOptions &&
+             this->IsResultUnchanged( file ) == true )
+        {
+            iUpToDateNum++;
+        }
+    }
+
+    return iUpToDateNum;
+}
+
+void ExtractionManifest::Record( const std::string& szTargetPath,
+                                 ExtractedFileSource source,
+                                 const fs::path& resultPath )
+{
+    ExtractedFile file;
+    file.source = std::move( source );
+    file.szResultPath =
+        resultPath.lexically_relative( this->m_OutPath ).generic_string();
+
+    if ( ReadFileSizeAndTime( resultPath, file.iResultSize,
+                              file.iResultModifiedTime ) == false )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+    this->m_Files[szTargetPath] = std::move( file );
+    this->m_bChanged = true;
+}
+
+bool ExtractionManifest::IsResultUnchanged( const ExtractedFile& file ) const
+{
+    uint64_t iResultSize;
+    int64_t iResultModifiedTime;
+
+    if ( ReadFileSizeAndTime( this->m_OutPath / file.szResultPath,
+                              iResultSize, iResultModifiedTime ) == false )
+    {
+        return false;
+    }
+
+    return iResultSize == file.iResultSize &&
+           iResultModifiedTime == file.iResultModifiedTime;
+}
@@ -0,0 +1,204 @@
+#include "extractionqueue.hpp"
+
+#include <algorithm>
+
+#include <QEventLoop>
+
+#include "backgroundjob.hpp"
+#include "indexdelta.hpp"
+#include "loadedpkgfiles.hpp"
+
+ExtractionQueue::ExtractionQueue( const LoadedPkgFiles& pkgFiles,
+                                  QObject* pParent /*= nullptr*/ )
+    : QObject( pParent ), m_PkgFiles( pkgFiles ), m_iCurrentJobId( -1 ),
+      m_iNextJobId( 0 )
+{
+}
+
+ExtractionQueue::~ExtractionQueue()
+{
+    this->CancelAllAndWait();
+}
+
+int ExtractionQueue::Enqueue( ExtractionRequest request )
+{
+    const int iNewJobId = this->m_iNextJobId++;
+
+    emit this->jobQueued( iNewJobId, request.szName,
+                          gsl::narrow_cast<int>( request.iFilesNum ) );
+
+    this->m_PendingJobs.emplace_back( iNewJobId, std::move( request ) );
+
+    if ( this->m_pCurrentJob == nullptr )
+    {
+        this->StartNextJob();
+    }
+
+    return iNewJobId;
+}
+
+void ExtractionQueue::Cancel( int iJobId )
+{
+    if ( this->m_pCurrentJob != nullptr && iJobId == this->m_iCurrentJobId )
+    {
+        // finishes through OnJobCompleted
+        this->m_pCurrentJob->Cancel();
+        return;
+    }
+
+    auto it = std::find_if(
+        this->m_PendingJobs.begin(), this->m_PendingJobs.end(),
+        [iJobId]( const auto& pendingJob ) {
+            return pendingJob.first == iJobId;
+        } );
+
+    if ( it == this->m_PendingJobs.end() )
+    {
+        return;
+    }
+
+    this->m_PendingJobs.erase( it );
+    emit this->jobFinished( iJobId, false, true, {} );
+}
+
+void ExtractionQueue::CancelAllAndWait()
+{
+    while ( this->m_PendingJobs.empty() == false )
+    {
+        this->Cancel( this->m_PendingJobs.front().first );
+    }
+
+    if ( this->m_pCurrentJob == nullptr )
+    {
+        return;
+    }
+
+    QEventLoop waitLoop;
+    this->connect( this->m_pCurrentJob.get(), &BackgroundJob::completed,
+                   &waitLoop, &QEventLoop::quit );
+
+    this->m_pCurrentJob->Cancel();
+    waitLoop.exec();
+}
+
+void ExtractionQueue::OnJobCompleted( bool bSucceeded )
+{
+    Q_ASSERT( this->m_pCurrentJob != nullptr );
+
+    const int iJobId = this->m_iCurrentJobId;
+    const bool bCancelled = this->m_pCurrentJob->WasCancelled();
+    const QString szError = QString::fromStdString( this->m_szCurrentError );
+
+    // the job is the sender, so let Qt delete it once we're done here
+    this->m_pCurrentJob.release()->deleteLater();
+    this->m_CurrentRequest = {};
+    this->m_iCurrentJobId = -1;
+    this->m_szCurrentError.clear();
+
+    emit this->jobFinished( iJobId, bSucceeded, bCancelled, szError );
+
+    this->StartNextJob();
+}
+
+void ExtractionQueue::StartNextJob()
+{
+    if ( this->m_PendingJobs.empty() == true )
+    {
+        return;
+    }
+
+    this->m_iCurrentJobId = this->m_PendingJobs.front().first;
+    this->m_CurrentRequest = std::move( this->m_PendingJobs.front().second );
+    this->m_PendingJobs.pop_front();
+
+    this->m_pCurrentJob = std::make_unique<BackgroundJob>(
+        [this]( BackgroundJob& job ) {
+            ExtractionRequest& request = this->m_CurrentRequest;
+
+            NodeExtractionMgr extractMgr(
+                this->m_PkgFiles, request.outPath, job.GetProgress(),
+                job.GetCancelToken(), request.bDecrypt, request.bDecompress );
+            extractMgr.SetStats( &job.GetStats() );
+
+            ExtractionManifest manifest( request.outPath );
+
+            if ( request.bSkipUpToDate == true )
+            {
+                manifest.Load();
+                extractMgr.SetManifest( &manifest );
+            }
+
+            if ( request.baseIndexPath.empty() == false )
+            {
+                IndexDelta delta( this->m_PkgFiles, job.GetCancelToken() );
+
+                if ( delta.Compute( request.baseIndexPath,
+                                    request.baseProvider, request.snapshot,
+                                    request.pkgParentPath ) == false )
+                {
+                    this->m_szCurrentError =
+                        "Could not compare the files with the index in " +
+                        request.baseIndexPath.parent_path().generic_string();
+                    return false;
+                }
+
+                if ( delta.WriteRemovedList( request.outPath ) == false )
+                {
+                    this->m_szCurrentError =
+                        "Could not write the list of removed files";
+                    return false;
+                }
+            }
+
+            // resumes an extraction to the same directory that didn't finish
+            ExtractionJournal journal( request.outPath );
+            journal.Open();
+            extractMgr.SetJournal( &journal );
+
+            const bool bExtracted =
+                request.bAllPackages == true
+                    ? extractMgr.ExtractPackages( request.pkgParentPath )
+                    : extractMgr.ExtractSnapshot( request.snapshot,
+                                                  request.pkgParentPath );
+
+            // saved even if it failed or was cancelled, so the next
+            // extraction picks up where this one stopped
+            if ( request.bSkipUpToDate == true )
+            {
+                manifest.Save();
+            }
+
+            if ( bExtracted == true )
+            {
+                journal.Remove();
+            }
+            else
+            {
+                this->m_szCurrentError = extractMgr.GetError();
+            }
+
+            return bExtracted;
+        } );
+
+    const int iJobId = this->m_iCurrentJobId;
+
+    this->connect( this->m_pCurrentJob.get(), &BackgroundJob::progressChanged,
+                   this, [this, iJobId]( int iProgress ) {
+                       emit this->jobProgress( iJobId, iProgress );
+                   } );
+    this->connect( this->m_pCurrentJob.get(),
+                   &BackgroundJob::maxProgressChanged, this,
+                   [this, iJobId]( int iMaxProgress ) {
+                       emit this->jobMaxProgress( iJobId, iMaxProgress );
+                   } );
+    this->connect( this->m_pCurrentJob.get(),
+                   &BackgroundJob::throughputChanged, this,
+                   [this, iJobId]( const ThroughputSample& sample ) {
+                       emit this->jobThroughput( iJobId, sample );
+                   } );
+    this->connect( this->m_pCurrentJob.get(), &BackgroundJob::completed, this,
+                   &ExtractionQueue::OnJobCompleted );
+
+    emit this->jobStarted( iJobId );
+    this->m_pCurrentJob->Start();
+}
@@ -0,0 +1,73 @@
+#include "extractionstats.hpp"
+
+ExtractionStats::ExtractionStats()
+    : m_iTotalBytes( 0 ), m_iReadBytes( 0 ), m_iWrittenBytes( 0 ),
+      m_iExtractedBytes( 0 ), m_iExtractedFiles( 0 ),
+      m_iSkippedFiles( 0 )
+{
+}
+
+ThroughputMeter::ThroughputMeter(
+    const ExtractionStats& stats,
+    clock_t::duration window /*= std::chrono::seconds( 5 )*/ )
+    : m_Stats( stats ), m_Window( window )
+{
+}
+
+ThroughputSample ThroughputMeter::Sample(
+    clock_t::time_point now /*= clock_t::now()*/ )
+{
+    this->m_Points.push_back( { now, this->m_Stats.GetReadBytes(),
+                                this->m_Stats.GetWrittenBytes(),
+                                this->m_Stats.GetExtractedBytes(),
+                                this->m_Stats.GetExtractedFiles() } );
+
+    // keep the newest point that's out of the window, so the rates are
+    // measured over the whole window
+    while ( this->m_Points.size() > 2 &&
+            now - this->m_Points[1].time >= this->m_Window )
+    {
+        this->m_Points.pop_front();
+    }
+
+    const CountersPoint& first = this->m_Points.front();
+    const CountersPoint& last = this->m_Points.back();
+
+    ThroughputSample sample;
+    sample.iTotalBytes = this->m_Stats.GetTotalBytes();
+    sample.iExtractedBytes = last.iExtractedBytes;
+    sample.iExtractedFiles = last.iExtractedFiles;
+
+    const double fElapsedSecs =
+        std::chrono::duration<double>( last.time - first.time ).count();
+
+    if ( fElapsedSecs <= 0.0 )
+    {
+        return sample;
+    }
+
+    sample.fReadBytesPerSec =
+        static_cast<double>( last.iReadBytes - first.iReadBytes ) /
+        fElapsedSecs;
+    sample.fWrittenBytesPerSec =
+        static_cast<double>( last.iWrittenBytes - first.iWrittenBytes ) /
+        fElapsedSecs;
+    sample.fFilesPerSec =
+        static_cast<double>( last.iExtractedFiles - first.iExtractedFiles ) /
+        fElapsedSecs;
+
+    const double fExtractedBytesPerSec =
+        static_cast<double>( last.iExtractedBytes - first.iExtractedBytes ) /
+        fElapsedSecs;
+
+    if ( fExtractedBytesPerSec > 0.0 &&
+         sample.iTotalBytes >= sample.iExtractedBytes )
+    {
+        sample.fSecondsLeft =
+            static_cast<double>( sample.iTotalBytes -
+                                 sample.iExtractedBytes ) /
+            fExtractedBytesPerSec;
+    }
+
+    return sample;
+}
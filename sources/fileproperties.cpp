@@ -2,6 +2,8 @@
 
 #include <uc2/pkgentry.hpp>
 
+#include "loadedpkgfiles.hpp"
+
 FileProperties::FileProperties()
     : m_GameDataInfo(), m_iFileEntries( 0 ), m_iPkgFilesNum( 0 ),
       m_iEncryptedFiles( 0 ), m_iPlainFiles( 0 ), m_Md5Hash()
@@ -47,34 +49,25 @@ void FileProperties::SetPkgFileProperties(
     this->m_iPlainFiles = iPlainFiles;
 }
 
-void FileProperties::SetIndexFileProperties(
-    GameProvider provider,
-    const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>& pkgFiles )
+void FileProperties::SetIndexFileProperties( GameProvider provider,
+                                             const LoadedPkgFiles& pkgFiles )
 {
     this->SetProvider( provider );
 
     uint64_t iFileEntries = 0;
     uint64_t iEncryptedFiles = 0;
-    uint64_t iPlainFiles = 0;
 
-    for ( auto&& pkgPair : pkgFiles )
+    // the packages may not be parsed, so only their summaries are used
+    for ( PkgFileId iPkgId = 0; iPkgId < pkgFiles.GetCount(); iPkgId++ )
     {
-        iFileEntries += pkgPair.second->GetEntries().size();
-
-        for ( auto&& entry : pkgPair.second->GetEntries() )
-        {
-            if ( entry->IsEncrypted() == true )
-            {
-                iEncryptedFiles++;
-            }
-            else
-            {
-                iPlainFiles++;
-            }
-        }
+        const PkgFileSummary& summary = pkgFiles.GetSummary( iPkgId );
+        iFileEntries += summary.iEntriesNum;
+        iEncryptedFiles += summary.iEncryptedNum;
     }
 
-    this->m_iPkgFilesNum = pkgFiles.size();
+    const uint64_t iPlainFiles = iFileEntries - iEncryptedFiles;
+
+    this->m_iPkgFilesNum = pkgFiles.GetCount();
     this->m_iFileEntries = iFileEntries;
     this->m_iEncryptedFiles = iEncryptedFiles;
     this->m_iPlainFiles = iPlainFiles;
@@ -52,6 +52,38 @@ bool WriteBufferToFile( const fs::path& filePath, gsl::span<uint8_t> buff )
 
     os.write( reinterpret_cast<char*>( buff.data() ),
               gsl::narrow_cast<std::streamsize>( buff.size_bytes() ) );
+    os.close();
+
+    // don't leave a truncated file behind
+    if ( os.fail() == true )
+    {
+        std::error_code errorCode;
+        fs::remove( filePath, errorCode );
+        return false;
+    }
+
+    return true;
+}
+
+bool ReplaceFileWithBuffer( const fs::path& filePath,
+                            gsl::span<uint8_t> buff )
+{
+    fs::path tempFilePath = filePath;
+    tempFilePath += ".tmp";
+
+    if ( WriteBufferToFile( tempFilePath, buff ) == false )
+    {
+        return false;
+    }
+
+    std::error_code errorCode;
+    fs::rename( tempFilePath, filePath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        fs::remove( tempFilePath, errorCode );
+        return false;
+    }
 
     return true;
 }
@@ -76,5 +108,7 @@ bool CreateDirIfUnexisting( const fs::path& newDirPath ) noexcept
         }
     }
 
-    return false;
+    // another extraction thread may have created it in the meantime
+    return fs::is_directory( newDirPath, errorCode ) == true &&
+           errorCode.value() == 0;
 }
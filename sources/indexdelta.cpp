@@ -0,0 +1,465 @@
+#include "indexdelta.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <gsl/gsl>
+
+#include <uc2/pkgentry.hpp>
+#include <uc2/pkgfile.hpp>
+#include <uc2/pkgindex.hpp>
+
+#include "archivefilenode.hpp"
+#include "corelog.hpp"
+#include "dynindexfilefactory.hpp"
+#include "dynpkgfilefactory.hpp"
+#include "fsutils.hpp"
+#include "miscutils.hpp"
+#include "workerpool.hpp"
+
+constexpr const std::string_view REMOVED_LIST_FILENAME = "removed_files.txt";
+
+IndexDelta::IndexDelta( const LoadedPkgFiles& pkgFiles,
+                        const CancellationToken& cancelToken )
+    : m_PkgFiles( pkgFiles ), m_CancelToken( cancelToken ), m_iAddedNum( 0 ),
+      m_iChangedNum( 0 ), m_iUnchangedNum( 0 )
+{
+}
+
+bool IndexDelta::Compute( const fs::path& baseIndexPath,
+                          GameProvider baseProvider,
+                          NodeExtractionMgr::Snapshot& snapshot,
+                          const fs::path& pkgParentPath )
+{
+    this->m_vRemovedPaths.clear();
+    this->m_iAddedNum = 0;
+    this->m_iChangedNum = 0;
+    this->m_iUnchangedNum = 0;
+
+    if ( this->LoadBaseIndex( baseIndexPath, baseProvider ) == false )
+    {
+        return false;
+    }
+
+    // a path found more than once keeps its first entry
+    std::unordered_map<std::string_view, const BaseEntry*> baseEntries;
+    baseEntries.reserve( this->m_vBaseEntries.size() );
+
+    for ( auto&& [szEntryPath, entry] : this->m_vBaseEntries )
+    {
+        baseEntries.emplace( szEntryPath, &entry );
+    }
+
+    std::unordered_set<std::string> newEntryPaths;
+    newEntryPaths.reserve( snapshot.iFilesNum );
+
+    std::vector<SameSizedFile> vSameSizedFiles;
+
+    for ( PkgFileId iPkgId : snapshot.vRequiredPkgIds )
+    {
+        const auto& workList = snapshot.vPkgWorkLists[iPkgId];
+
+        for ( std::size_t i = 0; i < workList.size(); i++ )
+        {
+            ArchiveFileNode* pFileNode = workList[i].second;
+            std::string szEntryPath = pFileNode->GetPath().generic_string();
+
+            auto it = baseEntries.find( szEntryPath );
+
+            if ( it == baseEntries.end() )
+            {
+                this->m_iAddedNum++;
+            }
+            else if ( it->second->iDecryptedSize !=
+                      pFileNode->GetDecryptedSize() )
+            {
+                this->m_iChangedNum++;
+            }
+            else
+            {
+                SameSizedFile file;
+                file.iNewPkgId = iPkgId;
+                file.iWorkIndex = i;
+                file.iBasePkgIndex = it->second->iPkgIndex;
+                file.iBaseEntryIndex = it->second->iEntryIndex;
+                vSameSizedFiles.push_back( file );
+            }
+
+            newEntryPaths.insert( std::move( szEntryPath ) );
+        }
+    }
+
+    for ( auto&& [szEntryPath, entry] : this->m_vBaseEntries )
+    {
+        if ( newEntryPaths.find( szEntryPath ) == newEntryPaths.end() )
+        {
+            // entry paths start at the root
+            this->m_vRemovedPaths.push_back( szEntryPath.substr( 1 ) );
+        }
+    }
+
+    std::sort( this->m_vRemovedPaths.begin(), this->m_vRemovedPaths.end() );
+    this->m_vRemovedPaths.erase( std::unique( this->m_vRemovedPaths.begin(),
+                                              this->m_vRemovedPaths.end() ),
+                                 this->m_vRemovedPaths.end() );
+
+    this->DigestBaseFiles( vSameSizedFiles );
+
+    if ( this->DigestNewFiles( vSameSizedFiles, snapshot, pkgParentPath ) ==
+         false )
+    {
+        return false;
+    }
+
+    // the unchanged files leave the snapshot
+    std::vector<std::vector<bool>> vUnchangedWork(
+        snapshot.vPkgWorkLists.size() );
+
+    for ( auto&& file : vSameSizedFiles )
+    {
+        // a base package that couldn't be read counts as changed
+        if ( file.bBaseDigested == false || file.bNewDigested == false ||
+             file.baseDigest != file.newDigest )
+        {
+            this->m_iChangedNum++;
+            continue;
+        }
+
+        auto& vUnchanged = vUnchangedWork[file.iNewPkgId];
+
+        if ( vUnchanged.empty() == true )
+        {
+            vUnchanged.resize( snapshot.vPkgWorkLists[file.iNewPkgId].size() );
+        }
+
+        vUnchanged[file.iWorkIndex] = true;
+        this->m_iUnchangedNum++;
+    }
+
+    for ( PkgFileId iPkgId : snapshot.vRequiredPkgIds )
+    {
+        const auto& vUnchanged = vUnchangedWork[iPkgId];
+
+        if ( vUnchanged.empty() == true )
+        {
+            continue;
+        }
+
+        auto& workList = snapshot.vPkgWorkLists[iPkgId];
+        std::size_t iKeptNum = 0;
+
+        for ( std::size_t i = 0; i < workList.size(); i++ )
+        {
+            if ( vUnchanged[i] == false )
+            {
+                workList[iKeptNum++] = std::move( workList[i] );
+            }
+        }
+
+        workList.resize( iKeptNum );
+    }
+
+    // the packages left without files don't need to be read
+    auto& vRequiredPkgIds = snapshot.vRequiredPkgIds;
+    vRequiredPkgIds.erase(
+        std::remove_if( vRequiredPkgIds.begin(), vRequiredPkgIds.end(),
+                        [&snapshot]( PkgFileId iPkgId ) {
+                            return snapshot.vPkgWorkLists[iPkgId].empty();
+                        } ),
+        vRequiredPkgIds.end() );
+
+    snapshot.iFilesNum = this->m_iAddedNum + this->m_iChangedNum;
+
+    return this->m_CancelToken.IsCancelled() == false;
+}
+
+bool IndexDelta::WriteRemovedList( const fs::path& outPath ) const
+{
+    std::string szRemovedList;
+
+    for ( auto&& szRemovedPath : this->m_vRemovedPaths )
+    {
+        szRemovedList += szRemovedPath;
+        szRemovedList += '\n';
+    }
+
+    if ( CreateDirIfUnexisting( outPath ) == false )
+    {
+        return false;
+    }
+
+    gsl::span<uint8_t> listData(
+        reinterpret_cast<uint8_t*>( szRemovedList.data() ),
+        szRemovedList.size() );
+
+    return ReplaceFileWithBuffer( outPath / REMOVED_LIST_FILENAME, listData );
+}
+
+bool IndexDelta::LoadBaseIndex( const fs::path& baseIndexPath,
+                                GameProvider baseProvider )
+{
+    this->m_vBasePkgFiles.clear();
+    this->m_vBaseEntries.clear();
+    this->m_BaseParentPath = baseIndexPath.parent_path();
+
+    auto [bIndexRead, vIndexData] = ReadFileToBuffer( baseIndexPath );
+
+    if ( bIndexRead == false )
+    {
+        LogWarning( "Could not read the base index",
+                    baseIndexPath.generic_string() );
+        return false;
+    }
+
+    uc2::PkgIndex::ptr_t pIndex;
+
+    try
+    {
+        DynamicIndexFileFactory f( baseIndexPath, vIndexData );
+        pIndex = f.GetPkgIndexOwnership();
+    }
+    catch ( const std::exception& e )
+    {
+        LogWarning( e.what() );
+        return false;
+    }
+
+    if ( !pIndex )
+    {
+        return false;
+    }
+
+    for ( auto&& pkgFilename :
+          DynamicIndexFileFactory::GetPkgFilenames( pIndex.get() ) )
+    {
+        if ( this->m_CancelToken.IsCancelled() == true )
+        {
+            return false;
+        }
+
+        const fs::path pkgPath = this->m_BaseParentPath / pkgFilename;
+        uc2::PkgFile::ptr_t pPkgFile;
+
+        try
+        {
+            DynamicPkgFileFactory f( pkgPath, baseProvider );
+            pPkgFile = f.GetPkgFileOwnership();
+
+            assert( pPkgFile != nullptr );
+
+            pPkgFile->Parse();
+        }
+        catch ( const std::exception& e )
+        {
+            LogWarning( "Could not load the base package",
+                        pkgPath.generic_string(), e.what() );
+            return false;
+        }
+
+        const std::size_t iPkgIndex = this->m_vBasePkgFiles.size();
+        auto& vEntries = pPkgFile->GetEntries();
+
+        for ( std::size_t i = 0; i < vEntries.size(); i++ )
+        {
+            this->m_vBaseEntries.emplace_back(
+                std::string( vEntries[i]->GetFilePath() ),
+                BaseEntry{ iPkgIndex, i, vEntries[i]->GetDecryptedSize() } );
+        }
+
+        pPkgFile->ReleaseDataBuffer();
+        this->m_vBasePkgFiles.push_back( std::move( pPkgFile ) );
+    }
+
+    return true;
+}
+
+void IndexDelta::DigestBaseFiles( std::vector<SameSizedFile>& vFiles )
+{
+    std::vector<std::vector<std::pair<std::size_t, SameSizedFile*>>>
+        vPkgEntries( this->m_vBasePkgFiles.size() );
+    std::vector<std::size_t> vDigestedPkgs;
+
+    for ( auto&& file : vFiles )
+    {
+        auto& vEntries = vPkgEntries[file.iBasePkgIndex];
+
+        if ( vEntries.empty() == true )
+        {
+            vDigestedPkgs.push_back( file.iBasePkgIndex );
+        }
+
+        vEntries.emplace_back( file.iBaseEntryIndex, &file );
+    }
+
+    for ( auto&& vEntries : vPkgEntries )
+    {
+        std::sort( vEntries.begin(), vEntries.end(),
+                   []( const auto& l, const auto& r ) {
+                       return l.first < r.first;
+                   } );
+    }
+
+    std::atomic<std::size_t> iNextPkg = 0;
+
+    auto worker = [this, &vPkgEntries, &vDigestedPkgs, &iNextPkg]() {
+        for ( std::size_t i = iNextPkg++; i < vDigestedPkgs.size();
+              i = iNextPkg++ )
+        {
+            if ( this->m_CancelToken.IsCancelled() == true )
+            {
+                return;
+            }
+
+            uc2::PkgFile* pPkgFile =
+                this->m_vBasePkgFiles[vDigestedPkgs[i]].get();
+            const fs::path pkgPath =
+                this->m_BaseParentPath / pPkgFile->GetFilename();
+
+            // its files are left as changed
+            if ( IndexDelta::DigestPkgFileEntries(
+                     pPkgFile, pkgPath, vPkgEntries[vDigestedPkgs[i]],
+                     false ) == false )
+            {
+                LogWarning( "Could not compare the files of",
+                            pkgPath.generic_string() );
+            }
+        }
+    };
+
+    WorkerPool& workerPool = WorkerPool::GetShared();
+    workerPool.RunConcurrently(
+        std::min( workerPool.GetThreadsNum(), vDigestedPkgs.size() ),
+        WorkPriority::Background, worker );
+}
+
+bool IndexDelta::DigestNewFiles( std::vector<SameSizedFile>& vFiles,
+                                 const NodeExtractionMgr::Snapshot& snapshot,
+                                 const fs::path& pkgParentPath )
+{
+    std::vector<std::vector<std::pair<std::size_t, SameSizedFile*>>>
+        vPkgEntries( snapshot.vPkgWorkLists.size() );
+    std::vector<PkgFileId> vDigestedPkgs;
+
+    for ( auto&& file : vFiles )
+    {
+        auto& vEntries = vPkgEntries[file.iNewPkgId];
+
+        if ( vEntries.empty() == true )
+        {
+            vDigestedPkgs.push_back( file.iNewPkgId );
+        }
+
+        ArchiveFileNode* pFileNode =
+            snapshot.vPkgWorkLists[file.iNewPkgId][file.iWorkIndex].second;
+        vEntries.emplace_back( pFileNode->GetEntryIndex(), &file );
+    }
+
+    std::atomic<std::size_t> iNextPkg = 0;
+    std::atomic<bool> bFailed = false;
+
+    auto worker = [this, &pkgParentPath, &vPkgEntries, &vDigestedPkgs,
+                   &iNextPkg, &bFailed]() {
+        for ( std::size_t i = iNextPkg++; i < vDigestedPkgs.size();
+              i = iNextPkg++ )
+        {
+            if ( this->m_CancelToken.IsCancelled() == true ||
+                 bFailed == true )
+            {
+                return;
+            }
+
+            const PkgFileId iPkgId = vDigestedPkgs[i];
+            uc2::PkgFile* pPkgFile = this->m_PkgFiles.Get( iPkgId );
+            const fs::path pkgPath = pkgParentPath / pPkgFile->GetFilename();
+
+            auto dataLock = this->m_PkgFiles.LockData( iPkgId );
+
+            if ( IndexDelta::DigestPkgFileEntries(
+                     pPkgFile, pkgPath, vPkgEntries[iPkgId], true ) == false )
+            {
+                LogCritical( "Could not compare the files of",
+                             pkgPath.generic_string() );
+                bFailed = true;
+            }
+        }
+    };
+
+    WorkerPool& workerPool = WorkerPool::GetShared();
+    workerPool.RunConcurrently(
+        std::min( workerPool.GetThreadsNum(), vDigestedPkgs.size() ),
+        WorkPriority::Background, worker );
+
+    return bFailed == false && this->m_CancelToken.IsCancelled() == false;
+}
+
+//
+// The entries are decrypted in the package's data, so each of them may
+// only be decrypted once per read
+//
+bool IndexDelta::DigestPkgFileEntries(
+    uc2::PkgFile* pPkgFile, const fs::path& pkgPath,
+    const std::vector<std::pair<std::size_t, SameSizedFile*>>& vEntries,
+    bool bNewSide )
+{
+    auto [bPkgRead, vPkgData] = ReadFileToBuffer( pkgPath );
+
+    if ( bPkgRead == false )
+    {
+        return false;
+    }
+
+    bool bDigested = true;
+
+    try
+    {
+        pPkgFile->SetDataBuffer( vPkgData );
+        pPkgFile->DecryptHeader();
+        pPkgFile->Parse();
+
+        auto& vPkgEntries = pPkgFile->GetEntries();
+
+        // sorted by entry, since several files may share a base entry
+        std::size_t iLastEntryIndex = vPkgEntries.size();
+        EntryDigest lastDigest = {};
+
+        for ( auto&& [iEntryIndex, pFile] : vEntries )
+        {
+            if ( iEntryIndex >= vPkgEntries.size() )
+            {
+                bDigested = false;
+                break;
+            }
+
+            if ( iEntryIndex != iLastEntryIndex )
+            {
+                lastDigest = Md5::Hash(
+                    PairToSpan( vPkgEntries[iEntryIndex]->DecryptFile() ) );
+                iLastEntryIndex = iEntryIndex;
+            }
+
+            if ( bNewSide == true )
+            {
+                pFile->newDigest = lastDigest;
+                pFile->bNewDigested = true;
+            }
+            else
+            {
+                pFile->baseDigest = lastDigest;
+                pFile->bBaseDigested = true;
+            }
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        LogWarning( e.what() );
+        bDigested = false;
+    }
+
+    pPkgFile->ReleaseDataBuffer();
+
+    return bDigested;
+}
@@ -0,0 +1,240 @@
+#include "indexmetadatacache.hpp"
+
+#include <algorithm>
+
+#include <gsl/gsl>
+
+#include <uc2/pkgfile.hpp>
+
+#include "binarybuffer.hpp"
+#include "corelog.hpp"
+#include "fsutils.hpp"
+#include "gamedatainfo.hpp"
+#include "md5.hpp"
+#include "pkgfilesystemshared.hpp"
+
+constexpr const std::array<char, 8> CACHE_FILE_MAGIC = { 'U', 'C', '2', 'I',
+                                                         'D', 'X', 'M', 'C' };
+// bump it when the layout changes
+constexpr const uint32_t CACHE_FILE_VERSION = 1;
+
+bool PkgFileStamp::operator==( const PkgFileStamp& other ) const noexcept
+{
+    return this->iFileSize == other.iFileSize &&
+           this->iModifiedTime == other.iModifiedTime &&
+           this->baseHeaderMd5 == other.baseHeaderMd5;
+}
+
+bool PkgFileMetadata::AreEntryFlagsDetected() const noexcept
+{
+    return std::all_of(
+        this->vEntries.begin(), this->vEntries.end(),
+        []( const auto& entry ) {
+            return ( entry.iEntryFlags & EF_Detected ) != 0;
+        } );
+}
+
+IndexMetadataCache::IndexMetadataCache( const fs::path& cacheDir,
+                                        const fs::path& indexPath,
+                                        GameProvider provider )
+    : m_Provider( provider ), m_bChanged( false )
+{
+    // one cache per index, named after its path
+    const std::string szIndexPath = indexPath.generic_string();
+    const Md5Digest pathHash = Md5::Hash(
+        { reinterpret_cast<const uint8_t*>( szIndexPath.data() ),
+          szIndexPath.size() } );
+
+    this->m_CacheFilePath = cacheDir / ( Md5::ToHex( pathHash ) + ".idxcache" );
+}
+
+bool IndexMetadataCache::Load()
+{
+    this->m_PkgFiles.clear();
+    this->m_bChanged = false;
+
+    auto [bCacheRead, vCacheData] = ReadFileToBuffer( this->m_CacheFilePath );
+
+    if ( bCacheRead == false )
+    {
+        return false;
+    }
+
+    BinaryBufferReader reader( vCacheData );
+
+    std::array<char, CACHE_FILE_MAGIC.size()> magic;
+    uint32_t iVersion;
+    int32_t iProvider;
+    uint32_t iPkgFilesNum;
+
+    if ( reader.Read( magic ) == false || magic != CACHE_FILE_MAGIC ||
+         reader.Read( iVersion ) == false || iVersion != CACHE_FILE_VERSION ||
+         reader.Read( iProvider ) == false ||
+         iProvider != static_cast<int32_t>( this->m_Provider ) ||
+         reader.Read( iPkgFilesNum ) == false )
+    {
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < iPkgFilesNum; i++ )
+    {
+        std::string szPkgFilename;
+        PkgFileMetadata metadata;
+        uint32_t iEntriesNum;
+
+        if ( reader.ReadString( szPkgFilename ) == false ||
+             reader.Read( metadata.stamp.iFileSize ) == false ||
+             reader.Read( metadata.stamp.iModifiedTime ) == false ||
+             reader.Read( metadata.stamp.baseHeaderMd5 ) == false ||
+             reader.Read( iEntriesNum ) == false )
+        {
+            this->m_PkgFiles.clear();
+            return false;
+        }
+
+        // a corrupted count can't make us allocate more than the file holds
+        metadata.vEntries.reserve(
+            std::min<std::size_t>( iEntriesNum, reader.GetBytesLeft() ) );
+
+        for ( uint32_t j = 0; j < iEntriesNum; j++ )
+        {
+            PkgEntryMetadata entry;
+            uint8_t iEncrypted;
+
+            if ( reader.ReadString( entry.szFilePath ) == false ||
+                 reader.Read( entry.iDecryptedSize ) == false ||
+                 reader.Read( iEncrypted ) == false ||
+                 reader.Read( entry.iEntryFlags ) == false )
+            {
+                this->m_PkgFiles.clear();
+                return false;
+            }
+
+            entry.bEncrypted = iEncrypted != 0;
+            metadata.vEntries.push_back( std::move( entry ) );
+        }
+
+        this->m_PkgFiles[szPkgFilename] = { std::move( metadata ), false };
+    }
+
+    return true;
+}
+
+bool IndexMetadataCache::Save()
+{
+    // drop the packages that left the index
+    for ( auto it = this->m_PkgFiles.begin(); it != this->m_PkgFiles.end(); )
+    {
+        if ( it->second.bUsed == false )
+        {
+            it = this->m_PkgFiles.erase( it );
+            this->m_bChanged = true;
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    if ( this->m_bChanged == false )
+    {
+        return true;
+    }
+
+    std::vector<uint8_t> vCacheData;
+    BinaryBufferWriter writer( vCacheData );
+
+    writer.Write( CACHE_FILE_MAGIC );
+    writer.Write( CACHE_FILE_VERSION );
+    writer.Write( static_cast<int32_t>( this->m_Provider ) );
+    writer.Write( gsl::narrow<uint32_t>( this->m_PkgFiles.size() ) );
+
+    for ( auto&& [szPkgFilename, pkgFile] : this->m_PkgFiles )
+    {
+        const PkgFileMetadata& metadata = pkgFile.metadata;
+
+        writer.WriteString( szPkgFilename );
+        writer.Write( metadata.stamp.iFileSize );
+        writer.Write( metadata.stamp.iModifiedTime );
+        writer.Write( metadata.stamp.baseHeaderMd5 );
+        writer.Write( gsl::narrow<uint32_t>( metadata.vEntries.size() ) );
+
+        for ( auto&& entry : metadata.vEntries )
+        {
+            writer.WriteString( entry.szFilePath );
+            writer.Write( entry.iDecryptedSize );
+            writer.Write( static_cast<uint8_t>( entry.bEncrypted ) );
+            writer.Write( entry.iEntryFlags );
+        }
+    }
+
+    if ( CreateDirIfUnexisting( this->m_CacheFilePath.parent_path() ) ==
+             false ||
+         ReplaceFileWithBuffer( this->m_CacheFilePath, vCacheData ) ==
+             false )
+    {
+        LogWarning( "Could not write the index metadata cache to",
+                    this->m_CacheFilePath.generic_string() );
+        return false;
+    }
+
+    this->m_bChanged = false;
+    return true;
+}
+
+const PkgFileMetadata* IndexMetadataCache::Find(
+    const std::string& szPkgFilename, const PkgFileStamp& stamp )
+{
+    auto it = this->m_PkgFiles.find( szPkgFilename );
+
+    if ( it == this->m_PkgFiles.end() ||
+         ( it->second.metadata.stamp == stamp ) == false )
+    {
+        return nullptr;
+    }
+
+    it->second.bUsed = true;
+    return &it->second.metadata;
+}
+
+void IndexMetadataCache::Store( const std::string& szPkgFilename,
+                                PkgFileMetadata metadata )
+{
+    this->m_PkgFiles[szPkgFilename] = { std::move( metadata ), true };
+    this->m_bChanged = true;
+}
+
+bool IndexMetadataCache::ReadPkgFileStamp( const fs::path& pkgPath,
+                                           PkgFileStamp& outStamp )
+{
+    std::error_code errorCode;
+
+    outStamp.iFileSize = fs::file_size( pkgPath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    const auto modifiedTime = fs::last_write_time( pkgPath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    outStamp.iModifiedTime = modifiedTime.time_since_epoch().count();
+
+    // catches packages replaced by others of the same size and time
+    auto [bHeaderRead, vHeaderData] =
+        ReadFileToBuffer( pkgPath, uc2::PkgFile::GetHeaderSize( false ) );
+
+    if ( bHeaderRead == false )
+    {
+        return false;
+    }
+
+    outStamp.baseHeaderMd5 = Md5::Hash( vHeaderData );
+
+    return true;
+}
@@ -1,8 +1,6 @@
 #include "mainwindow.hpp"
 
-#include <chrono>
-#include <future>
-#include <thread>
+#include <algorithm>
 
 #include <QDebug>
 #include <QDesktopServices>
@@ -20,26 +18,31 @@
 #include "pkgpropertiesdialog.hpp"
 
 #include "archivefilenode.hpp"
+#include "backgroundjob.hpp"
 #include "busywinwrapper.hpp"
+#include "extractionqueue.hpp"
 #include "nodeextractionmgr.hpp"
 #include "pkgfilesystemshared.hpp"
+#include "widgets/extractionqueuewidget.hpp"
+#include "workerpool.hpp"
 
-using namespace std::chrono_literals;
 using namespace std::string_view_literals;
 
-// the index file name should be the same in cso2 and tfo
-constexpr const std::string_view INDEX_FILENAME =
-    "1b87c6b551e518d11114ee21b7645a47.pkg"sv;
-
 extern QString GetCurrentCommit();
 extern QString GetAppVersion();
 
 CMainWindow::CMainWindow( QWidget* pParent )
     : MainWindowInit( pParent ), m_Model( this ),
       m_ErrorBoxWidget( this->errorBox, this->errorBoxMsg, this->errorBoxBtn ),
-      m_StatusWidget( this->lblStatus, this->pbStatus ),
+      m_StatusWidget( this->lblStatus, this->lblThroughput, this->pbStatus,
+                      this->btnCancel ),
+      m_ExtractionQueue( m_Model.GetLoadedPkgFiles() ),
+      m_PreviewCache( fs::path( m_TempDir.path().toStdString() ) / "previews" ),
       m_LastOpenDir( QDir::homePath() ), m_LastExtractDir( QDir::homePath() ),
-      m_bShouldDecrypt( true ), m_bShouldDecompress( true )
+      m_bShouldDecrypt( true ), m_bShouldDecompress( true ),
+      m_bShouldSkipUpToDate( false ),
+      m_bLastJobCancelled( false ), m_bCloseAfterJob( false ),
+      m_iWorkerThreads( 0 )
 {
     this->SetLoadedFilename();
 
@@ -51,6 +54,12 @@ CMainWindow::CMainWindow( QWidget* pParent )
             .width();
     this->treeView->setColumnWidth( PFS_FileNameColumn, iLongColWidth );
 
+    this->m_pExtractionQueueWidget =
+        new ExtractionQueueWidget( this->m_ExtractionQueue, this );
+    this->addDockWidget( Qt::BottomDockWidgetArea,
+                         this->m_pExtractionQueueWidget );
+    this->m_pExtractionQueueWidget->hide();
+
     this->ConnectActions();
     this->CreateRecentFilesMenu();
 
@@ -67,37 +76,63 @@ CMainWindow::~CMainWindow()
 
 void CMainWindow::OnIndexFileAccepted( GameDataInfo info )
 {
+    if ( this->CanReplaceModel() == false )
+    {
+        return;
+    }
+
     if ( this->m_Model.IsGenerated() == true )
     {
         this->m_Model.ResetModel();
     }
 
     const fs::path indexPath = info.GetGameDataPath() / INDEX_FILENAME;
+    const GameProvider provider = info.GetGameProvider();
 
-    bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w( this, tr( "Loading index's packages" ) );
-        return this->DoLoadIndexJob( indexPath, info.GetGameProvider() );
-    }();
+    auto loadIndex = [this, indexPath, provider]( BackgroundJob& job ) {
+        return this->m_Model.LoadIndex( indexPath, provider, job.GetProgress(),
+                                        job.GetMaxProgress(),
+                                        job.GetCancelToken() );
+    };
 
-    if ( bLoaded == false )
-    {
-        QString convertedIndexPath =
-            QString::fromStdString( indexPath.generic_string() );
-        this->ShowError( tr( "Failed to load index's <code>%1</code> packages" )
-                             .arg( convertedIndexPath ),
-                         this->m_Model.GetError() );
-        return;
-    }
+    auto onLoaded = [this, indexPath, info]( bool bLoaded ) {
+        if ( bLoaded == false )
+        {
+            if ( this->m_bLastJobCancelled == true )
+            {
+                return;
+            }
+
+            QString convertedIndexPath =
+                QString::fromStdString( indexPath.generic_string() );
+            this->ShowError(
+                tr( "Failed to load index's <code>%1</code> packages" )
+                    .arg( convertedIndexPath ),
+                this->m_Model.GetError() );
+            return;
+        }
+
+        this->SetArchiveOptionsEnabled( true );
 
-    this->SetArchiveOptionsEnabled( true );
+        // FIXME: index entry is loaded as a package
+        // this->AddToRecentFiles( info.GetGameDataPath() );
+        this->SetLoadedFilename( info.GetGameDataPath().generic_string() );
+    };
 
-    // FIXME: index entry is loaded as a package
-    // this->AddToRecentFiles( info.GetGameDataPath() );
-    this->SetLoadedFilename( info.GetGameDataPath().generic_string() );
+    this->StartJob( loadIndex, onLoaded, tr( "Loading index's packages" ) );
 }
 
 void CMainWindow::closeEvent( QCloseEvent* event )
 {
+    // the job uses the model, so it must be done before the window goes
+    if ( this->m_pCurrentJob != nullptr )
+    {
+        this->m_bCloseAfterJob = true;
+        this->m_pCurrentJob->Cancel();
+        event->ignore();
+        return;
+    }
+
     this->HandleExit();
     event->accept();
 }
@@ -127,7 +162,7 @@ void CMainWindow::dropEvent( QDropEvent* event )
 {
     qDebug() << event;
 
-    if ( this->m_Model.IsBusy() == true )
+    if ( this->m_Model.IsBusy() == true || this->m_pCurrentJob != nullptr )
     {
         return;
     }
@@ -155,6 +190,8 @@ void CMainWindow::ConnectActions()
                    &CMainWindow::OnIndexFileOpen );
     this->connect( this->action_Extract_All, &QAction::triggered, this,
                    &CMainWindow::OnExtractAll );
+    this->connect( this->action_Extract_Changes, &QAction::triggered, this,
+                   &CMainWindow::OnExtractChanges );
     this->connect( this->action_Properties, &QAction::triggered, this,
                    &CMainWindow::OnProperties );
     this->connect( this->action_Quit, &QAction::triggered, this,
@@ -172,12 +209,19 @@ void CMainWindow::ConnectActions()
                    &CMainWindow::OnDecryptToggle );
     this->connect( this->actionDecompress_textures, &QAction::toggled, this,
                    &CMainWindow::OnDecompressToggle );
+    this->connect( this->actionSkip_up_to_date_files, &QAction::toggled, this,
+                   &CMainWindow::OnSkipUpToDateToggle );
+    this->connect( this->actionDetect_file_types, &QAction::toggled, this,
+                   &CMainWindow::OnDetectTypesToggle );
 
     this->connect( this->actionAbout_UnCSO2, &QAction::triggered, this,
                    &CMainWindow::OnAbout );
     this->connect( this->actionAbout_Qt, &QAction::triggered, this,
                    &QApplication::aboutQt );
 
+    this->connect( &this->m_ExtractionQueue, &ExtractionQueue::jobFinished,
+                   this, &CMainWindow::OnExtractionFinished );
+
     this->connect( this->treeView, &PkgFileView::selected, &this->m_Model,
                    &PkgFileModel::OnSelectionChanged );
     this->connect( this->treeView, &PkgFileView::doubleClicked, this,
@@ -272,6 +316,9 @@ void CMainWindow::SetWidgetsEnabled( bool bEnabled )
 void CMainWindow::SetArchiveOptionsEnabled( bool bEnabled )
 {
     this->action_Extract_All->setEnabled( bEnabled );
+    // compares two indexes
+    this->action_Extract_Changes->setEnabled(
+        bEnabled == true && this->m_Model.IsIndexLoaded() == true );
     this->action_Properties->setEnabled( bEnabled );
 
     this->action_Extract->setEnabled( bEnabled );
@@ -294,207 +341,228 @@ void CMainWindow::SetLoadedFilename( std::string_view filename /*= {}*/ )
 void CMainWindow::LoadPackage(
     const fs::path& pkgPath, GameProvider provider /*= GameProvider::Unknown*/ )
 {
+    if ( this->CanReplaceModel() == false )
+    {
+        return;
+    }
+
     if ( this->m_Model.IsGenerated() == true )
     {
         this->m_Model.ResetModel();
     }
 
-    bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w( this, tr( "Loading package" ) );
-        return this->DoLoadPackageJob( pkgPath, provider );
-    }();
+    auto loadPkg = [this, pkgPath, provider]( BackgroundJob& ) {
+        return this->m_Model.LoadPackage( pkgPath, provider );
+    };
 
-    if ( bLoaded == false )
-    {
-        QString convertedPath =
-            QString::fromStdString( pkgPath.generic_string() );
-        this->ShowError(
-            tr( "Failed to load package <code>%1</code>" ).arg( convertedPath ),
-            this->m_Model.GetError() );
-        return;
-    }
+    auto onLoaded = [this, pkgPath]( bool bLoaded ) {
+        if ( bLoaded == false )
+        {
+            QString convertedPath =
+                QString::fromStdString( pkgPath.generic_string() );
+            this->ShowError( tr( "Failed to load package <code>%1</code>" )
+                                 .arg( convertedPath ),
+                             this->m_Model.GetError() );
+            return;
+        }
+
+        this->SetArchiveOptionsEnabled( true );
 
-    this->SetArchiveOptionsEnabled( true );
+        this->AddToRecentFiles( pkgPath );
+        this->SetLoadedFilename( pkgPath.filename().generic_string() );
+    };
 
-    this->AddToRecentFiles( pkgPath );
-    this->SetLoadedFilename( pkgPath.filename().generic_string() );
+    this->StartJob( loadPkg, onLoaded, tr( "Loading package" ), false );
 }
 
-bool CMainWindow::DoLoadPackageJob( const fs::path& pkgPath,
-                                    GameProvider provider )
+void CMainWindow::PreviewFileNode( ArchiveFileNode* pFileNode )
 {
-    std::future<bool> loadPkgFuture = std::async(
-        std::launch::async,
-        [&, this] { return this->m_Model.LoadPackage( pkgPath, provider ); } );
+    const fs::path pkgParentPath = this->m_Model.GetCurrentParentPath();
+    const fs::path ownerPkgPath =
+        pkgParentPath / pFileNode->GetOwnerPkgFilename();
 
-    if ( loadPkgFuture.valid() == false )
+    std::string szCacheKey;
+    const bool bCacheable = PreviewCache::MakeKey(
+        ownerPkgPath, pFileNode->GetPath().generic_string(),
+        this->m_bShouldDecrypt, this->m_bShouldDecompress, szCacheKey );
+
+    if ( bCacheable == true )
     {
-        return false;
-    }
+        const fs::path cachedPath = this->m_PreviewCache.Find( szCacheKey );
 
-    std::future_status status;
+        if ( cachedPath.empty() == false )
+        {
+            this->OpenPreview( cachedPath );
+            return;
+        }
+    }
 
-    do
-    {
-        status = loadPkgFuture.wait_for( 5ms );
-        QCoreApplication::processEvents();
-    } while ( status != std::future_status::ready );
+    const fs::path outDirPath =
+        bCacheable == true
+            ? this->m_PreviewCache.GetPreviewDir( szCacheKey )
+            : fs::path( this->m_TempDir.path().toStdString() );
 
-    bool bLoaded = loadPkgFuture.get();
-    return bLoaded;
-}
+    // written by the job, read once it's done
+    auto pResultPath = std::make_shared<fs::path>();
+    auto pError = std::make_shared<std::string>();
 
-bool CMainWindow::DoLoadIndexJob( const fs::path& indexPath,
-                                  GameProvider provider )
-{
-    int iCurProgress = 0;
-    std::size_t pkgNum = 0;
+    auto extractFile = [this, pFileNode, pkgParentPath, outDirPath,
+                        pResultPath, pError,
+                        bDecrypt = this->m_bShouldDecrypt,
+                        bDecompress =
+                            this->m_bShouldDecompress]( BackgroundJob& job ) {
+        NodeExtractionMgr extractMgr( this->m_Model.GetLoadedPkgFiles(),
+                                      outDirPath, job.GetProgress(),
+                                      job.GetCancelToken(), bDecrypt,
+                                      bDecompress );
+        extractMgr.SetPriority( WorkPriority::Interactive );
+        extractMgr.SetStats( &job.GetStats() );
 
-    std::future<bool> loadIndexFuture =
-        std::async( std::launch::async, [&, this] {
-            return this->m_Model.LoadIndex( indexPath, provider, iCurProgress,
-                                            pkgNum );
-        } );
+        const bool bExtracted = extractMgr.ExtractSingleFileNode(
+            pFileNode, pkgParentPath, *pResultPath );
 
-    if ( loadIndexFuture.valid() == false )
-    {
-        return false;
-    }
+        if ( bExtracted == false )
+        {
+            *pError = extractMgr.GetError();
+        }
 
-    std::future_status status;
+        return bExtracted;
+    };
 
-    bool bShouldSetMargins = true;
+    auto onExtracted = [this, pResultPath, pError, bCacheable,
+                        szCacheKey]( bool bExtracted ) {
+        if ( bExtracted == false )
+        {
+            if ( this->m_bLastJobCancelled == true )
+            {
+                return;
+            }
+
+            this->ShowError( tr( "Could not extract file for preview." ),
+                             QString::fromStdString( *pError ) );
+            return;
+        }
 
-    do
-    {
-        if ( bShouldSetMargins == true && pkgNum != 0 )
+        if ( bCacheable == true )
         {
-            this->m_StatusWidget.SetMargins( 0,
-                                             gsl::narrow_cast<int>( pkgNum ) );
-            bShouldSetMargins = false;
+            this->m_PreviewCache.Insert( szCacheKey, *pResultPath );
         }
 
-        status = loadIndexFuture.wait_for( 5ms );
-        this->m_StatusWidget.SetProgressNum( iCurProgress );
-        QCoreApplication::processEvents();
-    } while ( status != std::future_status::ready );
+        this->OpenPreview( *pResultPath );
+    };
 
-    bool bLoaded = loadIndexFuture.get();
-    return bLoaded;
+    this->StartJob( extractFile, onExtracted, tr( "Previewing file" ) );
 }
 
-bool CMainWindow::DoExtractionJob( const fs::path& outPath )
+void CMainWindow::OpenPreview( const fs::path& previewPath )
 {
-    int iCurrentEntry = 0;
-
-    std::future<bool> extractFuture =
-        std::async( std::launch::async, [&, this] {
-            NodeExtractionMgr extractMgr(
-                this->m_Model.GetLoadedPkgFiles(), outPath, iCurrentEntry,
-                this->m_bShouldDecrypt, this->m_bShouldDecompress );
-
-            auto vSelectedNodes = this->m_Model.GetCopyOfSelectedNodes();
-            auto pkgParentPath = this->m_Model.GetCurrentParentPath();
+    QString convertedFilePath =
+        QString::fromStdString( previewPath.generic_string() );
 
-            return extractMgr.ExtractNodes( vSelectedNodes, pkgParentPath );
-        } );
+    const bool bUrlOpened =
+        QDesktopServices::openUrl( QUrl( convertedFilePath ) );
 
-    if ( extractFuture.valid() == false )
+    if ( bUrlOpened == false )
     {
-        return false;
+        this->ShowError( tr( "Could not open <code>%1</code> for view." )
+                             .arg( convertedFilePath ),
+                         this->m_Model.GetError() );
     }
-
-    std::future_status status;
-
-    do
-    {
-        status = extractFuture.wait_for( 5ms );
-        this->m_StatusWidget.SetProgressNum( iCurrentEntry );
-        QCoreApplication::processEvents();
-    } while ( status != std::future_status::ready );
-
-    bool bExtracted = extractFuture.get();
-    return bExtracted;
 }
 
-bool CMainWindow::DoPreviewExtractionJob( ArchiveFileNode* pFileNode,
-                                          const fs::path& outDirPath,
-                                          fs::path& outResultPath )
+void CMainWindow::StartJob( BackgroundJob::job_t job, jobDone_t onDone,
+                            const QString& label, bool bCancelable /*= true*/ )
 {
-    std::future<bool> previewFuture =
-        std::async( std::launch::async, [&, this] {
-            int unused;
-            NodeExtractionMgr extractMgr(
-                this->m_Model.GetLoadedPkgFiles(), outDirPath, unused,
-                this->m_bShouldDecrypt, this->m_bShouldDecompress );
+    Q_ASSERT( this->m_pCurrentJob == nullptr );
 
-            auto pkgParentPath = this->m_Model.GetCurrentParentPath();
+    this->m_pJobBusyWin = std::make_unique<CBusyWinWrapper>( this, label );
+    this->m_pCurrentJob = std::make_unique<BackgroundJob>( std::move( job ) );
+    this->m_OnJobDone = std::move( onDone );
 
-            return extractMgr.ExtractSingleFileNode( pFileNode, pkgParentPath,
-                                                     outResultPath );
-        } );
+    BackgroundJob* pJob = this->m_pCurrentJob.get();
 
-    if ( previewFuture.valid() == false )
+    if ( bCancelable == true )
     {
-        return false;
+        this->connect( this->btnCancel, &QPushButton::clicked, pJob,
+                       [this, pJob]() {
+                           this->m_StatusWidget.SetLabel( tr( "Cancelling" ) );
+                           this->m_StatusWidget.SetCancelable( false );
+                           pJob->Cancel();
+                       } );
     }
 
-    std::future_status status;
+    this->m_StatusWidget.SetCancelable( bCancelable );
 
-    do
-    {
-        status = previewFuture.wait_for( 5ms );
-        QCoreApplication::processEvents();
-    } while ( status != std::future_status::ready );
+    this->connect( pJob, &BackgroundJob::progressChanged, this,
+                   [this]( int iProgress ) {
+                       this->m_StatusWidget.SetProgressNum( iProgress );
+                   } );
+    this->connect( pJob, &BackgroundJob::maxProgressChanged, this,
+                   [this]( int iMaxProgress ) {
+                       this->m_StatusWidget.SetMargins( 0, iMaxProgress );
+                   } );
+    this->connect( pJob, &BackgroundJob::throughputChanged, this,
+                   [this]( const ThroughputSample& sample ) {
+                       this->m_StatusWidget.SetThroughput( sample );
+                   } );
+    this->connect( pJob, &BackgroundJob::completed, this,
+                   &CMainWindow::OnJobCompleted );
 
-    bool bExtracted = previewFuture.get();
-    return bExtracted;
+    pJob->Start();
 }
 
-bool CMainWindow::DoExtractionAllJob( const fs::path& outPath )
+void CMainWindow::OnJobCompleted( bool bSucceeded )
 {
-    int iCurrentEntry = 0;
+    Q_ASSERT( this->m_pCurrentJob != nullptr );
 
-    std::future<bool> extractAllFuture =
-        std::async( std::launch::async, [&, this] {
-            const auto& loadedPkgFiles = this->m_Model.GetLoadedPkgFiles();
+    this->m_bLastJobCancelled = this->m_pCurrentJob->WasCancelled();
 
-            std::vector<uc2::PkgFile*> vPkgFiles;
-            std::transform( loadedPkgFiles.begin(), loadedPkgFiles.end(),
-                            back_inserter( vPkgFiles ), []( const auto& val ) {
-                                return val.second.get();
-                            } );
+    // the job is the sender, so let Qt delete it once we're done here
+    this->m_pCurrentJob.release()->deleteLater();
+    this->m_pJobBusyWin.reset();
 
-            NodeExtractionMgr extractMgr( loadedPkgFiles, outPath,
-                                          iCurrentEntry, this->m_bShouldDecrypt,
-                                          this->m_bShouldDecompress );
+    jobDone_t onDone = std::move( this->m_OnJobDone );
+    this->m_OnJobDone = nullptr;
 
-            auto pkgParentPath = this->m_Model.GetCurrentParentPath();
-
-            return extractMgr.ExtractPackages( vPkgFiles, pkgParentPath );
-        } );
-
-    if ( extractAllFuture.valid() == false )
+    if ( this->m_bCloseAfterJob == true )
     {
-        return false;
+        this->close();
+        return;
     }
 
-    std::future_status status;
+    onDone( bSucceeded );
+}
 
-    do
+void CMainWindow::HandleExit()
+{
+    this->SaveSettings();
+    this->m_ExtractionQueue.CancelAllAndWait();
+}
+
+// the queued extractions use the loaded packages, so they must be done
+// before loading others
+bool CMainWindow::CanReplaceModel()
+{
+    if ( this->m_ExtractionQueue.IsBusy() == true )
     {
-        status = extractAllFuture.wait_for( 5ms );
-        this->m_StatusWidget.SetProgressNum( iCurrentEntry );
-        QCoreApplication::processEvents();
-    } while ( status != std::future_status::ready );
+        this->ShowError(
+            tr( "Please wait for the queued extractions to finish, or cancel "
+                "them, before opening another file." ),
+            {} );
+        return false;
+    }
 
-    bool bExtracted = extractAllFuture.get();
-    return bExtracted;
+    return true;
 }
 
-void CMainWindow::HandleExit()
+void CMainWindow::OnExtractionFinished( int /*iJobId*/, bool bSucceeded,
+                                        bool bCancelled,
+                                        const QString& szError )
 {
-    this->SaveSettings();
+    if ( bSucceeded == false && bCancelled == false )
+    {
+        this->ShowError( tr( "Could not extract files." ), szError );
+    }
 }
 
 void CMainWindow::ValidateLastDirs()
@@ -528,6 +596,16 @@ void CMainWindow::LoadSettings()
         settings.value( QStringLiteral( "decryptedfiles" ), true ).toBool() );
     this->actionDecompress_textures->setChecked(
         settings.value( QStringLiteral( "decompressvtf" ), true ).toBool() );
+    this->actionDetect_file_types->setChecked(
+        settings.value( QStringLiteral( "detectfiletypes" ), false ).toBool() );
+    this->actionSkip_up_to_date_files->setChecked(
+        settings.value( QStringLiteral( "skipuptodate" ), false ).toBool() );
+    // the pool is created when it's first used, so this must be read before
+    // any job is started
+    this->m_iWorkerThreads = std::max(
+        settings.value( QStringLiteral( "workerthreads" ), 0 ).toInt(), 0 );
+    WorkerPool::SetSharedThreadsNum(
+        gsl::narrow_cast<std::size_t>( this->m_iWorkerThreads ) );
     settings.endGroup();
 
     settings.beginGroup( QStringLiteral( "filedialogs" ) );
@@ -562,6 +640,12 @@ void CMainWindow::SaveSettings()
                        this->actionDecrypt_e_files->isChecked() );
     settings.setValue( QStringLiteral( "decompressvtf" ),
                        this->actionDecompress_textures->isChecked() );
+    settings.setValue( QStringLiteral( "detectfiletypes" ),
+                       this->actionDetect_file_types->isChecked() );
+    settings.setValue( QStringLiteral( "skipuptodate" ),
+                       this->actionSkip_up_to_date_files->isChecked() );
+    settings.setValue( QStringLiteral( "workerthreads" ),
+                       this->m_iWorkerThreads );
     settings.endGroup();
 
     settings.beginGroup( QStringLiteral( "filedialogs" ) );
@@ -628,17 +712,75 @@ void CMainWindow::OnExtractAll()
 
     this->m_LastExtractDir = QString::fromStdString( outPath.generic_string() );
 
-    bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w( this, tr( "Extracting files" ) );
-        return this->DoExtractionAllJob( outPath );
-    }();
+    const auto& loadedPkgFiles = this->m_Model.GetLoadedPkgFiles();
+
+    ExtractionRequest request;
+    request.szName = tr( "All files to %1" ).arg( this->m_LastExtractDir );
+    request.outPath = outPath;
+    request.pkgParentPath = this->m_Model.GetCurrentParentPath();
+    request.bDecrypt = this->m_bShouldDecrypt;
+    request.bDecompress = this->m_bShouldDecompress;
+    request.bSkipUpToDate = this->m_bShouldSkipUpToDate;
+    request.bAllPackages = true;
 
-    if ( bLoaded == false )
+    for ( PkgFileId iPkgId = 0; iPkgId < loadedPkgFiles.GetCount(); iPkgId++ )
+    {
+        request.iFilesNum += loadedPkgFiles.GetSummary( iPkgId ).iEntriesNum;
+    }
+
+    this->m_ExtractionQueue.Enqueue( std::move( request ) );
+}
+
+void CMainWindow::OnExtractChanges()
+{
+    const fs::path baseIndexPath =
+        QFileDialog::getOpenFileName(
+            this, tr( "Select the older index to compare with" ),
+            this->m_LastOpenDir,
+            tr( "Index files (%1)" ).arg( INDEX_FILENAME.data() ) )
+            .toStdString();
+
+    if ( baseIndexPath.empty() == true )
+    {
+        return;
+    }
+
+    const fs::path outPath =
+        QFileDialog::getExistingDirectory(
+            this, tr( "Select the output directory" ), this->m_LastExtractDir )
+            .toStdString();
+
+    if ( outPath.empty() == true )
     {
-        this->ShowError( tr( "Could not extract all files" ),
-                         this->m_Model.GetError() );
         return;
     }
+
+    this->m_LastExtractDir = QString::fromStdString( outPath.generic_string() );
+
+    // every file is compared, the unchanged ones are left out by the job
+    std::vector<ArchiveBaseNode*> vRootNodes = { this->m_Model.GetNode(
+        QModelIndex() ) };
+
+    ExtractionRequest request;
+    request.szName =
+        tr( "Changes since %1 to %2" )
+            .arg( QString::fromStdString(
+                baseIndexPath.parent_path().generic_string() ) )
+            .arg( this->m_LastExtractDir );
+    request.outPath = outPath;
+    request.pkgParentPath = this->m_Model.GetCurrentParentPath();
+    request.bDecrypt = this->m_bShouldDecrypt;
+    request.bDecompress = this->m_bShouldDecompress;
+    request.bSkipUpToDate = this->m_bShouldSkipUpToDate;
+    request.snapshot = NodeExtractionMgr::TakeSnapshot(
+        vRootNodes, this->m_Model.GetLoadedPkgFiles().GetCount() );
+    request.iFilesNum = request.snapshot.iFilesNum;
+    request.baseIndexPath = baseIndexPath;
+    request.baseProvider = this->m_Model.GetCurrentFileProperties()
+                               .GetGameDataInfo()
+                               .GetGameProvider();
+
+    this->m_ExtractionQueue.Enqueue( std::move( request ) );
 }
 
 void CMainWindow::OnQuitButton()
@@ -662,6 +804,16 @@ void CMainWindow::OnDecompressToggle( bool bChecked )
     this->m_bShouldDecompress = bChecked;
 }
 
+void CMainWindow::OnSkipUpToDateToggle( bool bChecked )
+{
+    this->m_bShouldSkipUpToDate = bChecked;
+}
+
+void CMainWindow::OnDetectTypesToggle( bool bChecked )
+{
+    this->m_Model.SetEntryFlagDetection( bChecked );
+}
+
 void CMainWindow::OnPreviewClick()
 {
     std::size_t iSelectedNodesNum = this->m_Model.GetSelectedNodesCount();
@@ -671,46 +823,19 @@ void CMainWindow::OnPreviewClick()
         return;
     }
 
-    fs::path tempDirPath = this->m_TempDir.path().toStdString();
-    fs::path outFilePath;
-
-    const bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w( this, tr( "Previewing file" ) );
-
-        auto vSelectedNodes = this->m_Model.GetCopyOfSelectedNodes();
-        Q_ASSERT( vSelectedNodes.size() == 1 );
-
-        auto pFileNode = BaseToFileNode( *vSelectedNodes.begin() );
-
-        if ( pFileNode == nullptr )
-        {
-            return false;
-        }
+    auto vSelectedNodes = this->m_Model.GetCopyOfSelectedNodes();
+    Q_ASSERT( vSelectedNodes.size() == 1 );
 
-        return this->DoPreviewExtractionJob( pFileNode, tempDirPath,
-                                             outFilePath );
-    }();
+    auto pFileNode = BaseToFileNode( *vSelectedNodes.begin() );
 
-    if ( bLoaded == false )
+    if ( pFileNode == nullptr )
     {
         this->ShowError( tr( "Could not extract file for preview." ),
                          this->m_Model.GetError() );
         return;
     }
 
-    QString convertedFilePath =
-        QString::fromStdString( outFilePath.generic_string() );
-
-    const bool bUrlOpened =
-        QDesktopServices::openUrl( QUrl( convertedFilePath ) );
-
-    if ( bUrlOpened == false )
-    {
-        this->ShowError( tr( "Could not open <code>%1</code> for view." )
-                             .arg( convertedFilePath ),
-                         this->m_Model.GetError() );
-        return;
-    }
+    this->PreviewFileNode( pFileNode );
 }
 
 void CMainWindow::OnExtractClick()
@@ -734,18 +859,23 @@ void CMainWindow::OnExtractClick()
 
     this->m_LastExtractDir = QString::fromStdString( outPath.generic_string() );
 
-    bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w(
-            this, tr( "Extracting %1 files" ).arg( iSelectedNodesNum ) );
-        return this->DoExtractionJob( outPath );
-    }();
+    // taken now, the tree may be sorted while the extraction is queued
+    auto vSelectedNodes = this->m_Model.GetCopyOfSelectedNodes();
 
-    if ( bLoaded == false )
-    {
-        this->ShowError( tr( "Could not extract file." ),
-                         this->m_Model.GetError() );
-        return;
-    }
+    ExtractionRequest request;
+    request.szName = tr( "%1 selected items to %2" )
+                         .arg( iSelectedNodesNum )
+                         .arg( this->m_LastExtractDir );
+    request.outPath = outPath;
+    request.pkgParentPath = this->m_Model.GetCurrentParentPath();
+    request.bDecrypt = this->m_bShouldDecrypt;
+    request.bDecompress = this->m_bShouldDecompress;
+    request.bSkipUpToDate = this->m_bShouldSkipUpToDate;
+    request.snapshot = NodeExtractionMgr::TakeSnapshot(
+        vSelectedNodes, this->m_Model.GetLoadedPkgFiles().GetCount() );
+    request.iFilesNum = request.snapshot.iFilesNum;
+
+    this->m_ExtractionQueue.Enqueue( std::move( request ) );
 }
 
 void CMainWindow::OnProperties()
@@ -775,44 +905,15 @@ void CMainWindow::OnItemDoubleClicked( const QModelIndex& index )
         return;
     }
 
-    fs::path tempDirPath = this->m_TempDir.path().toStdString();
-    fs::path outFilePath;
-
-    const bool bLoaded = [&, this]() -> bool {
-        CBusyWinWrapper w( this, tr( "Previewing file" ) );
+    auto pFileNode = IndexToFileNode( index );
 
-        auto pFileNode = IndexToFileNode( index );
-
-        if ( pFileNode == nullptr )
-        {
-            // the node should have its type verified before, since you can
-            // only extract file nodes
-            Q_ASSERT( false );
-            return false;
-        }
-
-        return this->DoPreviewExtractionJob( pFileNode, tempDirPath,
-                                             outFilePath );
-    }();
-
-    if ( bLoaded == false )
+    if ( pFileNode == nullptr )
     {
-        this->ShowError( tr( "Could not extract file for preview." ),
-                         this->m_Model.GetError() );
+        // the node should have its type verified before, since you can
+        // only extract file nodes
+        Q_ASSERT( false );
         return;
     }
 
-    QString convertedFilePath =
-        QString::fromStdString( outFilePath.generic_string() );
-
-    const bool bUrlOpened =
-        QDesktopServices::openUrl( QUrl( convertedFilePath ) );
-
-    if ( bUrlOpened == false )
-    {
-        this->ShowError( tr( "Could not open <code>%1</code> for view." )
-                             .arg( convertedFilePath ),
-                         this->m_Model.GetError() );
-        return;
-    }
+    this->PreviewFileNode( pFileNode );
 }
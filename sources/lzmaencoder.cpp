@@ -0,0 +1,142 @@
+#include "lzmaencoder.hpp"
+
+// lc=3 lp=0 pb=2, LZMA's defaults
+constexpr const uint32_t LZMA_LITERAL_CONTEXT_BITS = 3;
+constexpr const uint32_t LZMA_POS_BITS = 2;
+// nothing is matched, so any dictionary works
+constexpr const uint32_t LZMA_DICTIONARY_SIZE = 1 << 16;
+
+constexpr const uint32_t LZMA_PROB_BITS = 11;
+constexpr const uint16_t LZMA_PROB_INIT = 1 << ( LZMA_PROB_BITS - 1 );
+constexpr const uint32_t LZMA_MOVE_BITS = 5;
+constexpr const uint32_t LZMA_RANGE_TOP = 1 << 24;
+
+constexpr const std::size_t LZMA_LITERAL_CODER_SIZE = 0x300;
+
+class LzmaRangeEncoder
+{
+public:
+    LzmaRangeEncoder( std::vector<uint8_t>& vOut )
+        : m_vOut( vOut ), m_iLow( 0 ), m_iRange( 0xFFFFFFFF ), m_iCache( 0 ),
+          m_iCacheSize( 1 )
+    {
+    }
+
+    void EncodeBit( uint16_t& iProb, uint32_t iBit )
+    {
+        const uint32_t iBound = ( this->m_iRange >> LZMA_PROB_BITS ) * iProb;
+
+        if ( iBit == 0 )
+        {
+            this->m_iRange = iBound;
+            iProb = static_cast<uint16_t>(
+                iProb + ( ( ( 1 << LZMA_PROB_BITS ) - iProb ) >>
+                          LZMA_MOVE_BITS ) );
+        }
+        else
+        {
+            this->m_iLow += iBound;
+            this->m_iRange -= iBound;
+            iProb =
+                static_cast<uint16_t>( iProb - ( iProb >> LZMA_MOVE_BITS ) );
+        }
+
+        while ( this->m_iRange < LZMA_RANGE_TOP )
+        {
+            this->m_iRange <<= 8;
+            this->ShiftLow();
+        }
+    }
+
+    void Flush()
+    {
+        for ( int i = 0; i < 5; i++ )
+        {
+            this->ShiftLow();
+        }
+    }
+
+private:
+    // a byte is held back until it's known whether a carry changes it
+    void ShiftLow()
+    {
+        const uint32_t iCarry = static_cast<uint32_t>( this->m_iLow >> 32 );
+
+        if ( this->m_iLow < 0xFF000000 || iCarry != 0 )
+        {
+            uint8_t iPending = this->m_iCache;
+
+            do
+            {
+                this->m_vOut.push_back(
+                    static_cast<uint8_t>( iPending + iCarry ) );
+                iPending = 0xFF;
+            } while ( --this->m_iCacheSize != 0 );
+
+            this->m_iCache = static_cast<uint8_t>( this->m_iLow >> 24 );
+        }
+
+        this->m_iCacheSize++;
+        this->m_iLow = ( this->m_iLow & 0x00FFFFFF ) << 8;
+    }
+
+private:
+    std::vector<uint8_t>& m_vOut;
+
+    uint64_t m_iLow;
+    uint32_t m_iRange;
+    uint8_t m_iCache;
+    uint64_t m_iCacheSize;
+};
+
+std::array<uint8_t, LzmaEncoder::PROPS_SIZE> LzmaEncoder::GetProps() noexcept
+{
+    std::array<uint8_t, PROPS_SIZE> props;
+    props[0] = static_cast<uint8_t>( LZMA_POS_BITS * 5 * 9 +
+                                     LZMA_LITERAL_CONTEXT_BITS );
+
+    for ( std::size_t i = 0; i < 4; i++ )
+    {
+        props[i + 1] =
+            static_cast<uint8_t>( LZMA_DICTIONARY_SIZE >> ( i * 8 ) );
+    }
+
+    return props;
+}
+
+void LzmaEncoder::Encode( gsl::span<const uint8_t> data,
+                          std::vector<uint8_t>& vOut )
+{
+    constexpr const uint32_t POS_STATES_NUM = 1 << LZMA_POS_BITS;
+
+    // only literals are coded, so the state never leaves its first value
+    std::vector<uint16_t> vIsMatchProbs( POS_STATES_NUM, LZMA_PROB_INIT );
+    std::vector<uint16_t> vLiteralProbs(
+        LZMA_LITERAL_CODER_SIZE << LZMA_LITERAL_CONTEXT_BITS,
+        LZMA_PROB_INIT );
+
+    LzmaRangeEncoder encoder( vOut );
+    uint8_t iPrevByte = 0;
+
+    for ( std::size_t i = 0; i < data.size(); i++ )
+    {
+        encoder.EncodeBit( vIsMatchProbs[i & ( POS_STATES_NUM - 1 )], 0 );
+
+        uint16_t* pProbs =
+            &vLiteralProbs[LZMA_LITERAL_CODER_SIZE *
+                           ( iPrevByte >> ( 8 - LZMA_LITERAL_CONTEXT_BITS ) )];
+        const uint8_t iByte = data[i];
+        uint32_t iSymbol = 1;
+
+        for ( int iBit = 7; iBit >= 0; iBit-- )
+        {
+            const uint32_t iBitValue = ( iByte >> iBit ) & 1;
+            encoder.EncodeBit( pProbs[iSymbol], iBitValue );
+            iSymbol = ( iSymbol << 1 ) | iBitValue;
+        }
+
+        iPrevByte = iByte;
+    }
+
+    encoder.Flush();
+}
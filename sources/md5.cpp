@@ -0,0 +1,189 @@
+#include "md5.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// the shift amounts of each round's steps
+constexpr const std::array<uint32_t, 64> MD5_SHIFTS = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+// floor(abs(sin(i + 1)) * 2^32)
+constexpr const std::array<uint32_t, 64> MD5_CONSTANTS = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static inline uint32_t RotateLeft( uint32_t iValue, uint32_t iBits ) noexcept
+{
+    return ( iValue << iBits ) | ( iValue >> ( 32 - iBits ) );
+}
+
+Md5::Md5() noexcept
+    : m_State{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 }, m_Block{},
+      m_iTotalBytes( 0 )
+{
+}
+
+Md5Digest Md5::Hash( gsl::span<const uint8_t> data ) noexcept
+{
+    Md5 hash;
+    hash.Update( data );
+    return hash.Finish();
+}
+
+std::string Md5::ToHex( const Md5Digest& digest )
+{
+    constexpr const char HEX_DIGITS[] = "0123456789abcdef";
+
+    std::string szHex;
+    szHex.reserve( digest.size() * 2 );
+
+    for ( auto&& byte : digest )
+    {
+        szHex += HEX_DIGITS[byte >> 4];
+        szHex += HEX_DIGITS[byte & 0xF];
+    }
+
+    return szHex;
+}
+
+void Md5::Update( gsl::span<const uint8_t> data ) noexcept
+{
+    const uint8_t* pData = data.data();
+    std::size_t iBytesLeft = data.size();
+
+    std::size_t iBlockUsed = this->m_iTotalBytes % this->m_Block.size();
+    this->m_iTotalBytes += iBytesLeft;
+
+    // complete the block left over by the last update
+    if ( iBlockUsed != 0 )
+    {
+        const std::size_t iCopyBytes =
+            std::min( this->m_Block.size() - iBlockUsed, iBytesLeft );
+        std::memcpy( &this->m_Block[iBlockUsed], pData, iCopyBytes );
+
+        pData += iCopyBytes;
+        iBytesLeft -= iCopyBytes;
+        iBlockUsed += iCopyBytes;
+
+        if ( iBlockUsed != this->m_Block.size() )
+        {
+            return;
+        }
+
+        this->Transform( this->m_Block.data() );
+    }
+
+    while ( iBytesLeft >= this->m_Block.size() )
+    {
+        this->Transform( pData );
+        pData += this->m_Block.size();
+        iBytesLeft -= this->m_Block.size();
+    }
+
+    if ( iBytesLeft != 0 )
+    {
+        std::memcpy( this->m_Block.data(), pData, iBytesLeft );
+    }
+}
+
+Md5Digest Md5::Finish() noexcept
+{
+    const uint64_t iTotalBits = this->m_iTotalBytes * 8;
+
+    // a one bit, then zeroes until there's just room left for the length
+    std::array<uint8_t, 64> padding = { 0x80 };
+    const std::size_t iBlockUsed = this->m_iTotalBytes % padding.size();
+    const std::size_t iPaddingBytes =
+        iBlockUsed < 56 ? 56 - iBlockUsed : 120 - iBlockUsed;
+    this->Update( { padding.data(), iPaddingBytes } );
+
+    std::array<uint8_t, 8> length;
+
+    for ( std::size_t i = 0; i < length.size(); i++ )
+    {
+        length[i] = static_cast<uint8_t>( iTotalBits >> ( i * 8 ) );
+    }
+
+    this->Update( length );
+
+    Md5Digest digest;
+
+    for ( std::size_t i = 0; i < digest.size(); i++ )
+    {
+        digest[i] =
+            static_cast<uint8_t>( this->m_State[i / 4] >> ( ( i % 4 ) * 8 ) );
+    }
+
+    return digest;
+}
+
+void Md5::Transform( const uint8_t* pBlock ) noexcept
+{
+    std::array<uint32_t, 16> words;
+
+    // little endian, whatever the host is
+    for ( std::size_t i = 0; i < words.size(); i++ )
+    {
+        words[i] = static_cast<uint32_t>( pBlock[i * 4] ) |
+                   static_cast<uint32_t>( pBlock[i * 4 + 1] ) << 8 |
+                   static_cast<uint32_t>( pBlock[i * 4 + 2] ) << 16 |
+                   static_cast<uint32_t>( pBlock[i * 4 + 3] ) << 24;
+    }
+
+    uint32_t a = this->m_State[0];
+    uint32_t b = this->m_State[1];
+    uint32_t c = this->m_State[2];
+    uint32_t d = this->m_State[3];
+
+    for ( std::size_t i = 0; i < 64; i++ )
+    {
+        uint32_t f;
+        std::size_t g;
+
+        if ( i < 16 )
+        {
+            f = ( b & c ) | ( ~b & d );
+            g = i;
+        }
+        else if ( i < 32 )
+        {
+            f = ( d & b ) | ( ~d & c );
+            g = ( 5 * i + 1 ) % 16;
+        }
+        else if ( i < 48 )
+        {
+            f = b ^ c ^ d;
+            g = ( 3 * i + 5 ) % 16;
+        }
+        else
+        {
+            f = c ^ ( b | ~d );
+            g = ( 7 * i ) % 16;
+        }
+
+        f += a + MD5_CONSTANTS[i] + words[g];
+        a = d;
+        d = c;
+        c = b;
+        b += RotateLeft( f, MD5_SHIFTS[i] );
+    }
+
+    this->m_State[0] += a;
+    this->m_State[1] += b;
+    this->m_State[2] += c;
+    this->m_State[3] += d;
+}
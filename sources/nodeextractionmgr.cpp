@@ -1,13 +1,14 @@
 #include "nodeextractionmgr.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <numeric>
 #include <string>
-#include <unordered_set>
-
-#include <QDebug>
 
 #include <uc2/pkgentry.hpp>
 #include <uc2/pkgfile.hpp>
 
+#include "corelog.hpp"
 #include "fsutils.hpp"
 #include "miscutils.hpp"
 
@@ -16,49 +17,58 @@
 #include "specialfilehandler.hpp"
 
 NodeExtractionMgr::NodeExtractionMgr(
-    const std::unordered_map<std::size_t, uc2::PkgFile::ptr_t>& pkgFiles,
-    fs::path outPath, int& outProgressNum, bool canDecrypt, bool canDecompress )
+    const LoadedPkgFiles& pkgFiles, fs::path outPath,
+    std::atomic<int>& outProgressNum, const CancellationToken& cancelToken,
+    bool canDecrypt, bool canDecompress )
     : m_PkgFiles( pkgFiles ), m_OutPath( outPath ),
-      m_iExtractionProgress( outProgressNum ), m_bAllowDecryption( canDecrypt ),
-      m_bAllowDecompression( canDecompress )
+      m_iExtractionProgress( outProgressNum ), m_CancelToken( cancelToken ),
+      m_Priority( WorkPriority::Background ), m_pStats( nullptr ),
+      m_pManifest( nullptr ), m_pJournal( nullptr ),
+      m_bAllowDecryption( canDecrypt ), m_bAllowDecompression( canDecompress )
 {
 }
 
-void NodeExtractionMgr::AddNodes( const gsl::span<ArchiveBaseNode*> nodes,
-                                  uc2::PkgFile* ownerPkgFile )
+void NodeExtractionMgr::AddNodes( Snapshot& snapshot,
+                                  const gsl::span<ArchiveBaseNode*> nodes )
 {
-    std::string szPkgFilename( ownerPkgFile->GetFilename() );
-
     for ( const auto& index : nodes )
     {
         if ( index->IsDirectory() == true )
         {
             auto pDirNode = BaseToDirectoryNode( index );
-            Q_ASSERT( pDirNode != nullptr );
-            this->AddDirectoryNode( pDirNode, ownerPkgFile );
+            assert( pDirNode != nullptr );
+            NodeExtractionMgr::AddDirectoryNode( snapshot, pDirNode );
         }
         else
         {
             ArchiveFileNode* pFileNode = BaseToFileNode( index );
-            Q_ASSERT( pFileNode != nullptr );
-            this->AddFileNode( pFileNode, ownerPkgFile );
+            assert( pFileNode != nullptr );
+            NodeExtractionMgr::AddFileNode( snapshot, pFileNode );
         }
     }
 }
 
-void NodeExtractionMgr::AddFileNode( ArchiveFileNode* pFileNode,
-                                     uc2::PkgFile* ownerPkgFile,
-                                     fs::path nodeParentDir /*= {} */ )
+void NodeExtractionMgr::AddFileNode( Snapshot& snapshot,
+                                     ArchiveFileNode* pFileNode,
+                                     const fs::path& nodeParentDir /*= {} */ )
 {
-    std::size_t iPkgPathHash =
-        GenerateHashFromString( ownerPkgFile->GetFilename() );
-    this->HandleFileNode( pFileNode, iPkgPathHash, nodeParentDir );
+    const PkgFileId iOwnerId = pFileNode->GetOwnerPkgId();
+    assert( iOwnerId < snapshot.vPkgWorkLists.size() );
+
+    fs::path fullFilePath = nodeParentDir;
+    fullFilePath /= pFileNode->GetPath().filename();
+
+    snapshot.vPkgWorkLists[iOwnerId].emplace_back( std::move( fullFilePath ),
+                                                   pFileNode );
+    snapshot.iFilesNum++;
 }
 
-void NodeExtractionMgr::AddDirectoryNode( ArchiveDirectoryNode* pDirNode,
-                                          uc2::PkgFile* ownerPkgFile,
-                                          fs::path parentNodePath /*= {} */ )
+void NodeExtractionMgr::AddDirectoryNode(
+    Snapshot& snapshot, ArchiveDirectoryNode* pDirNode,
+    const fs::path& parentNodePath /*= {} */ )
 {
+    const fs::path dirPath = parentNodePath / pDirNode->GetPath().filename();
+
     for ( std::size_t i = 0; i < pDirNode->GetNumOfChildren(); i++ )
     {
         auto pBaseChild = pDirNode->GetChild( i );
@@ -66,105 +76,245 @@ void NodeExtractionMgr::AddDirectoryNode( ArchiveDirectoryNode* pDirNode,
         if ( pBaseChild->IsDirectory() == true )
         {
             auto pDirChild = BaseToDirectoryNode( pBaseChild );
-            Q_ASSERT( pDirChild != nullptr );
-            Q_ASSERT( pDirChild != pDirNode );
-
-            fs::path newParentNodePath =
-                parentNodePath / pDirNode->GetPath().filename();
+            assert( pDirChild != nullptr );
+            assert( pDirChild != pDirNode );
 
-            this->AddDirectoryNode( pDirChild, ownerPkgFile,
-                                    newParentNodePath );
+            NodeExtractionMgr::AddDirectoryNode( snapshot, pDirChild,
+                                                 dirPath );
         }
         else
         {
             auto pFileChild = BaseToFileNode( pBaseChild );
-            Q_ASSERT( pFileChild != nullptr );
-
-            fs::path dirPath = parentNodePath;
-            dirPath /= pDirNode->GetPath().filename();
+            assert( pFileChild != nullptr );
 
-            this->AddFileNode( pFileChild, ownerPkgFile, dirPath );
+            NodeExtractionMgr::AddFileNode( snapshot, pFileChild, dirPath );
         }
     }
 }
 
 bool NodeExtractionMgr::LoadPkgFileData( const fs::path& pkgParentPath,
-                                         uc2::PkgFile* pkgFile )
+                                         PkgFileWork& work )
 {
-    Q_ASSERT( pkgFile != nullptr );
+    uc2::PkgFile* pPkgFile = work.pPkgFile;
+    assert( pPkgFile != nullptr );
+
+    // the error is kept with the package too, since the last error may
+    // come from another package being extracted
+    auto failLoad = [&work, this]( std::string szError ) {
+        this->SetError( szError );
+        work.szLoadError = std::move( szError );
+        return false;
+    };
 
     fs::path ownerPkgPath = pkgParentPath;
-    ownerPkgPath /= pkgFile->GetFilename();
+    ownerPkgPath /= pPkgFile->GetFilename();
+
+    // the resident data is only trusted if the file didn't change since
+    PkgFileStamp pkgStamp = work.source.pkgStamp;
+    const bool bStamped =
+        work.bStamped == true ||
+        IndexMetadataCache::ReadPkgFileStamp( ownerPkgPath, pkgStamp ) == true;
 
-    auto [bPkgRead, vPkgData] = ReadFileToBuffer( ownerPkgPath );
+    ResidentPkgData& residentData = this->m_PkgFiles.GetResidentData();
+    ResidentPkgData::data_t pPkgData =
+        bStamped == true ? residentData.Find( work.iPkgId, pkgStamp )
+                         : nullptr;
 
-    if ( bPkgRead == false )
+    if ( pPkgData != nullptr )
     {
-        return false;
+        // it's decrypted in place, so the resident data can't be shared
+        work.vData.assign( pPkgData->begin(), pPkgData->end() );
     }
+    else
+    {
+        auto [bPkgRead, vPkgData] = ReadFileToBuffer( ownerPkgPath );
 
-    this->m_vLoadedPkgFile = std::move( vPkgData );
-    pkgFile->SetDataBuffer( this->m_vLoadedPkgFile );
-    pkgFile->DecryptHeader();
-    pkgFile->Parse();
+        if ( bPkgRead == false )
+        {
+            return failLoad( "Could not read " +
+                             ownerPkgPath.generic_string() );
+        }
 
-    return true;
-}
+        if ( this->m_pStats != nullptr )
+        {
+            this->m_pStats->AddReadBytes( vPkgData.size() );
+        }
 
-bool NodeExtractionMgr::WriteNodesToDisk()
-{
-    for ( auto&& nodePair : this->m_vOutNodesData )
-    {
-        auto nodePath = nodePair.first;
-        auto pFileNode = nodePair.second;
+        if ( bStamped == true && work.bKeepResident == true )
+        {
+            work.vData = vPkgData;
+            residentData.Insert(
+                work.iPkgId, pkgStamp,
+                std::make_shared<const std::vector<uint8_t>>(
+                    std::move( vPkgData ) ) );
+        }
+        else
+        {
+            work.vData = std::move( vPkgData );
+        }
+    }
 
-        fs::path targetFilePath = this->m_OutPath / nodePath;
-        uc2::PkgEntry* pPkgEntry = pFileNode->GetPkgEntry();
+    try
+    {
+        pPkgFile->SetDataBuffer( work.vData );
 
-        if ( this->WritePkgEntryInternal(
-                 pPkgEntry, targetFilePath, this->m_bAllowDecryption,
-                 this->m_bAllowDecompression ) == false )
+        if ( pPkgFile->DecryptHeader() == false )
         {
-            return false;
+            return failLoad( "Could not decrypt the header of " +
+                             std::string( pPkgFile->GetFilename() ) );
         }
 
-        this->m_iExtractionProgress++;
+        pPkgFile->Parse();
+    }
+    catch ( const std::exception& e )
+    {
+        LogCritical( "Failed to load package", pPkgFile->GetFilename(),
+                     "with error", e.what() );
+        return failLoad( "Could not load " +
+                         std::string( pPkgFile->GetFilename() ) + ": " +
+                         e.what() );
     }
-
-    this->m_vOutNodesData.clear();
 
     return true;
 }
 
-bool NodeExtractionMgr::WriteSingleNodeToDisk( fs::path& outPath )
+std::string NodeExtractionMgr::GetError()
 {
-    Q_ASSERT( this->m_vOutNodesData.size() == 1 );
+    std::lock_guard<std::mutex> lock( this->m_ErrorLock );
+    return this->m_szLastError;
+}
 
-    auto nodePair = this->m_vOutNodesData[0];
+void NodeExtractionMgr::SetError( std::string szError )
+{
+    std::lock_guard<std::mutex> lock( this->m_ErrorLock );
+    this->m_szLastError = std::move( szError );
+}
 
-    auto nodePath = nodePair.first;
-    auto pFileNode = nodePair.second;
+void NodeExtractionMgr::OnPkgFileFailed( const PkgFileWork& work )
+{
+    std::string szPkgFilename( work.pPkgFile->GetFilename() );
 
-    outPath = this->m_OutPath / nodePath;
-    uc2::PkgEntry* pPkgEntry = pFileNode->GetPkgEntry();
+    LogCritical( "Skipping package", szPkgFilename, "that failed to load" );
 
-    if ( this->WritePkgEntryInternal( pPkgEntry, outPath,
-                                      this->m_bAllowDecryption,
-                                      this->m_bAllowDecompression ) == false )
+    if ( this->m_pJournal != nullptr )
     {
-        return false;
+        this->m_pJournal->AddFailedPkgFile( szPkgFilename, work.szLoadError );
     }
 
-    this->m_vOutNodesData.clear();
+    std::lock_guard<std::mutex> lock( this->m_ErrorLock );
+    this->m_vFailedPkgFiles.push_back( std::move( szPkgFilename ) );
+}
 
-    return true;
+//
+// Nodes only know the index of their entry, since their package may not be
+// parsed until it's loaded here
+//
+static uc2::PkgEntry* GetNodeEntry( uc2::PkgFile* pPkgFile,
+                                    ArchiveFileNode* pFileNode ) noexcept
+{
+    auto& vEntries = pPkgFile->GetEntries();
+    const std::size_t iEntryIndex = pFileNode->GetEntryIndex();
+
+    if ( iEntryIndex >= vEntries.size() )
+    {
+        LogCritical( "The entry of", pFileNode->GetPath().generic_string(),
+                     "is missing from its package" );
+        return nullptr;
+    }
+
+    return vEntries[iEntryIndex].get();
 }
 
-bool NodeExtractionMgr::WritePackageToDisk( uc2::PkgFile* pPkgFile )
+//
+// Runs extractPkgFile on several packages at once, each of them on a single
+// worker, which then spreads the package's entries across the pool
+//
+// This keeps every thread busy on indexes of small packages, where a single
+// package doesn't have enough entries for all of them
+//
+bool NodeExtractionMgr::ExtractPkgFilesParallel(
+    const std::vector<PkgFileId>& vPkgIds,
+    const std::function<bool( PkgFileWork& )>& extractPkgFile )
 {
+    std::atomic<std::size_t> iNextPkg = 0;
+    std::atomic<bool> bFailed = false;
+
+    auto worker = [&, this]() {
+        for ( std::size_t i = iNextPkg++; i < vPkgIds.size();
+              i = iNextPkg++ )
+        {
+            if ( this->m_CancelToken.IsCancelled() == true ||
+                 bFailed == true )
+            {
+                bFailed = true;
+                return;
+            }
+
+            PkgFileWork work;
+            work.iPkgId = vPkgIds[i];
+            work.pPkgFile = this->m_PkgFiles.Get( work.iPkgId );
+            assert( work.pPkgFile != nullptr );
+
+            try
+            {
+                if ( extractPkgFile( work ) == false )
+                {
+                    bFailed = true;
+                }
+            }
+            catch ( const std::exception& e )
+            {
+                LogCritical( "Failed to extract package",
+                             work.pPkgFile->GetFilename(), "with error",
+                             e.what() );
+                this->SetError( e.what() );
+                bFailed = true;
+            }
+        }
+    };
+
+    WorkerPool& workerPool = WorkerPool::GetShared();
+    workerPool.RunConcurrently(
+        std::min( workerPool.GetThreadsNum(), vPkgIds.size() ),
+        this->m_Priority, worker );
+
+    // the same order however the packages were scheduled
+    std::sort( this->m_vFailedPkgFiles.begin(), this->m_vFailedPkgFiles.end() );
+
+    return bFailed == false && this->m_vFailedPkgFiles.empty() == true;
+}
+
+bool NodeExtractionMgr::WriteNodesToDisk( PkgFileWork& work,
+                                          const NodeWorkList& workList )
+{
+    return this->WriteEntriesParallel(
+        work, workList.size(),
+        [&workList, this]( std::size_t iIndex ) {
+            return this->GetNodeCost( workList[iIndex].second );
+        },
+        [&work, &workList, this]( std::size_t iIndex, EntryTarget& target ) {
+            auto& [nodePath, pFileNode] = workList[iIndex];
+            target.pEntry = GetNodeEntry( work.pPkgFile, pFileNode );
+
+            if ( target.pEntry == nullptr )
+            {
+                this->SetError( "The entry of " +
+                                pFileNode->GetPath().generic_string() +
+                                " is missing from its package" );
+                return false;
+            }
+
+            target.targetFilePath = this->m_OutPath / nodePath;
+            return true;
+        } );
+}
+
+bool NodeExtractionMgr::WritePackageToDisk( PkgFileWork& work )
+{
+    auto& vEntries = work.pPkgFile->GetEntries();
+
     std::string_view firstEntryParentView =
-        pPkgFile->GetEntries().at( 0 )->GetFilePath().substr(
-            1 );  // skip the root path
+        vEntries.at( 0 )->GetFilePath().substr( 1 );  // skip the root path
     fs::path targetParentDir = this->m_OutPath / firstEntryParentView;
 
     if ( CreateDirIfUnexisting( targetParentDir.parent_path() ) == false )
@@ -172,246 +322,783 @@ bool NodeExtractionMgr::WritePackageToDisk( uc2::PkgFile* pPkgFile )
         return false;
     }
 
-    for ( auto&& entry : pPkgFile->GetEntries() )
-    {
-        std::string_view entryParentDirView =
-            entry->GetFilePath().substr( 1 );  // skip the root path
-        fs::path targetFilePath = this->m_OutPath / entryParentDirView;
+    return this->WriteEntriesParallel(
+        work, vEntries.size(),
+        [&vEntries]( std::size_t iIndex ) {
+            return vEntries[iIndex]->GetDecryptedSize();
+        },
+        [&work, &vEntries, this]( std::size_t iIndex, EntryTarget& target ) {
+            uc2::PkgEntry* pEntry = vEntries[iIndex].get();
+
+            std::string_view entryParentDirView =
+                pEntry->GetFilePath().substr( 1 );  // skip the root path
+            fs::path targetFilePath = this->m_OutPath / entryParentDirView;
+
+            // left behind by an interrupted extraction
+            if ( this->IsTargetUpToDate( work, targetFilePath,
+                                         pEntry->GetFilePath(),
+                                         pEntry->GetDecryptedSize() ) == true )
+            {
+                this->OnFilesSkipped( 1, pEntry->GetDecryptedSize() );
+                return true;
+            }
 
-        if ( this->WritePkgEntryInternal(
-                 entry.get(), targetFilePath, this->m_bAllowDecryption,
-                 this->m_bAllowDecompression ) == false )
+            target.pEntry = pEntry;
+            target.targetFilePath = std::move( targetFilePath );
+            return true;
+        } );
+}
+
+//
+// Spreads a package's entries across the shared worker pool, so the work
+// around their decryption (special file decryption, hashing and writing to
+// the disk) runs in parallel
+//
+// The package's entries are still decrypted one at a time, under its
+// PkgFileWork's lock
+//
+// Packages are mostly made of small files, so consecutive small entries are
+// handed out in batches to keep the per entry scheduling and locking costs
+// out of the way
+//
+// Compressed textures found while decrypting are queued to a decompression
+// stage, which the same workers serve first, so LZMA doesn't hold back
+// the decryption of the remaining entries
+//
+bool NodeExtractionMgr::WriteEntriesParallel(
+    PkgFileWork& work, std::size_t iEntriesNum,
+    const std::function<uint64_t( std::size_t )>& getEntrySize,
+    const GetEntryTargetFn& getEntryTarget )
+{
+    const std::vector<std::size_t> vBatchEnds =
+        NodeExtractionMgr::SplitIntoBatches( iEntriesNum, getEntrySize );
+    const std::size_t iBatchesNum = vBatchEnds.size();
+
+    WorkerPool& workerPool = WorkerPool::GetShared();
+
+    // the calling thread always takes part, even without any batch
+    const std::size_t iWorkersNum = std::max<std::size_t>(
+        std::min( workerPool.GetThreadsNum(), iBatchesNum ), 1 );
+
+    TextureQueue texQueue;
+
+    std::atomic<std::size_t> iNextBatch = 0;
+    std::atomic<bool> bFailed = false;
+
+    // guarded by texQueue.lock, only counts the workers that started since
+    // the pool may start some of them late (or never) when it's busy
+    std::size_t iDecryptingWorkers = 0;
+
+    auto failJob = [&]() {
+        {
+            std::lock_guard<std::mutex> lock( texQueue.lock );
+            bFailed = true;
+        }
+        texQueue.cond.notify_all();
+    };
+
+    auto worker = [&, this]() {
+        {
+            std::lock_guard<std::mutex> lock( texQueue.lock );
+            iDecryptingWorkers++;
+        }
+
+        bool bDecrypting = true;
+
+        auto stopDecrypting = [&]() {
+            if ( bDecrypting == false )
+            {
+                return;
+            }
+
+            bDecrypting = false;
+
+            {
+                std::lock_guard<std::mutex> lock( texQueue.lock );
+                iDecryptingWorkers--;
+            }
+
+            texQueue.cond.notify_all();
+        };
+
+        // however the worker leaves, the ones waiting for textures must not
+        // keep waiting for it to finish decrypting
+        auto decryptGuard = gsl::finally( stopDecrypting );
+
+        try
+        {
+            while ( bFailed == false )
+            {
+                std::unique_lock<std::mutex> lock( texQueue.lock );
+
+                if ( bDecrypting == false )
+                {
+                    texQueue.cond.wait( lock, [&]() {
+                        return texQueue.textures.empty() == false ||
+                               iDecryptingWorkers == 0 || bFailed == true;
+                    } );
+                }
+
+                if ( texQueue.textures.empty() == false )
+                {
+                    QueuedTexture texture =
+                        std::move( texQueue.textures.front() );
+                    texQueue.textures.pop_front();
+                    lock.unlock();
+
+                    if ( this->m_CancelToken.IsCancelled() == true ||
+                         this->WriteTextureToDisk( texture ) == false )
+                    {
+                        failJob();
+                    }
+
+                    continue;
+                }
+
+                if ( bDecrypting == false )
+                {
+                    // every entry was decrypted and no texture is left
+                    break;
+                }
+
+                lock.unlock();
+
+                const std::size_t iCurBatch = iNextBatch++;
+
+                if ( iCurBatch >= iBatchesNum )
+                {
+                    stopDecrypting();
+                    continue;
+                }
+
+                const std::size_t iBatchBegin =
+                    iCurBatch == 0 ? 0 : vBatchEnds[iCurBatch - 1];
+
+                if ( this->WriteBatch( work, iBatchBegin,
+                                       vBatchEnds[iCurBatch], getEntryTarget,
+                                       texQueue ) == false )
+                {
+                    failJob();
+                    return;
+                }
+            }
+        }
+        catch ( const std::exception& e )
+        {
+            LogCritical( "Extraction worker failed with error", e.what() );
+            this->SetError( e.what() );
+            failJob();
+        }
+        catch ( ... )
+        {
+            LogCritical( "Extraction worker failed with an unknown error" );
+            this->SetError( "An unknown error stopped the extraction" );
+            failJob();
+        }
+    };
+
+    workerPool.RunConcurrently( iWorkersNum, this->m_Priority, worker );
+
+    return bFailed == false;
+}
+
+//
+// Decrypts a batch's entries back to back, taking the package's lock once
+// for the whole batch, then handles and writes them outside of it so
+// another worker can decrypt the next batch in the meantime
+//
+// The entries are decrypted in place in the package's data, which they
+// don't share, so their buffers stay valid once the lock is released
+//
+bool NodeExtractionMgr::WriteBatch( PkgFileWork& work, std::size_t iBatchBegin,
+                                    std::size_t iBatchEnd,
+                                    const GetEntryTargetFn& getEntryTarget,
+                                    TextureQueue& texQueue )
+{
+    std::vector<EntryTarget> vTargets( iBatchEnd - iBatchBegin );
+
+    for ( std::size_t i = 0; i < vTargets.size(); i++ )
+    {
+        if ( getEntryTarget( iBatchBegin + i, vTargets[i] ) == false )
         {
             return false;
         }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( work.decryptLock );
 
-        this->m_iExtractionProgress++;
+        for ( auto&& target : vTargets )
+        {
+            if ( target.pEntry != nullptr &&
+                 ( this->m_CancelToken.IsCancelled() == true ||
+                   this->DecryptPkgEntry( target ) == false ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    fs::path resultFilePath;
+
+    for ( auto&& target : vTargets )
+    {
+        if ( target.pEntry != nullptr &&
+             ( this->m_CancelToken.IsCancelled() == true ||
+               this->WriteDecryptedEntry( work, target, resultFilePath,
+                                          &texQueue ) == false ) )
+        {
+            return false;
+        }
     }
 
     return true;
 }
 
-void NodeExtractionMgr::HandleFileNode( ArchiveFileNode* pFileNode,
-                                        std::size_t iPkgPathHash,
-                                        fs::path parentDir )
+//
+// How much work a node is expected to take, in decrypted bytes
+//
+// Textures known to be compressed also have to go through LZMA, which is
+// much slower than decryption, so they're weighted up to get a batch of
+// their own instead of being grouped with other entries
+//
+uint64_t NodeExtractionMgr::GetNodeCost( ArchiveFileNode* pFileNode ) const
+    noexcept
 {
-    std::size_t iOwnerFilenameHash =
-        GenerateHashFromString( pFileNode->GetOwnerPkgFilename() );
+    constexpr const uint64_t TEXTURE_COST_FACTOR = 8;
+
+    const uint64_t iDecryptedSize = pFileNode->GetDecryptedSize();
 
-    if ( iPkgPathHash != iOwnerFilenameHash )
+    if ( this->m_bAllowDecompression == true &&
+         pFileNode->IsLzmaTexture() == true )
     {
-        return;
+        return iDecryptedSize * TEXTURE_COST_FACTOR;
     }
 
-    fs::path fullFilePath = parentDir;
-    fullFilePath /= pFileNode->GetPath().filename();
+    return iDecryptedSize;
+}
+
+// returns the (exclusive) end index of each batch
+std::vector<std::size_t> NodeExtractionMgr::SplitIntoBatches(
+    std::size_t iEntriesNum,
+    const std::function<uint64_t( std::size_t )>& getEntrySize )
+{
+    constexpr const uint64_t BATCH_MAX_BYTES = 1024 * 1024;
+    constexpr const std::size_t BATCH_MAX_ENTRIES = 128;
+
+    std::vector<std::size_t> vBatchEnds;
+
+    uint64_t iBatchBytes = 0;
+    std::size_t iBatchEntries = 0;
+
+    for ( std::size_t i = 0; i < iEntriesNum; i++ )
+    {
+        const uint64_t iEntrySize = getEntrySize( i );
+
+        // big entries get a batch of their own
+        if ( iBatchEntries != 0 &&
+             ( iBatchBytes + iEntrySize > BATCH_MAX_BYTES ||
+               iBatchEntries == BATCH_MAX_ENTRIES ) )
+        {
+            vBatchEnds.push_back( i );
+            iBatchBytes = 0;
+            iBatchEntries = 0;
+        }
+
+        iBatchBytes += iEntrySize;
+        iBatchEntries++;
+    }
 
-    this->m_vOutNodesData.push_back( { fullFilePath, pFileNode } );
+    if ( iBatchEntries != 0 )
+    {
+        vBatchEnds.push_back( iEntriesNum );
+    }
+
+    return vBatchEnds;
 }
 
-bool NodeExtractionMgr::WritePkgEntryInternal( uc2::PkgEntry* pEntry,
-                                               fs::path& outFilePath,
-                                               bool canDecrypt,
-                                               bool canDecompress )
+bool NodeExtractionMgr::DecryptPkgEntry( EntryTarget& target )
 {
-    gsl::span<uint8_t> decryptedBuffer;
+    uc2::PkgEntry* pEntry = target.pEntry;
 
     try
     {
-        decryptedBuffer = PairToSpan( pEntry->DecryptFile() );
+        target.decryptedBuffer = PairToSpan( pEntry->DecryptFile() );
     }
     catch ( const std::exception& e )
     {
-        qCritical() << "Failed to extract file '"
-                    << pEntry->GetFilePath().data() << "' with error '"
-                    << e.what() << "'";
+        LogCritical( "Failed to extract file", pEntry->GetFilePath(),
+                     "with error", e.what() );
+        this->SetError( "Could not extract " +
+                        std::string( pEntry->GetFilePath() ) + ": " +
+                        e.what() );
         return false;
     }
 
-    if ( CreateDirIfUnexisting( outFilePath.parent_path() ) == false )
+    return true;
+}
+
+bool NodeExtractionMgr::WriteDecryptedEntry(
+    const PkgFileWork& work, const EntryTarget& target,
+    fs::path& outResultPath, TextureQueue* pTexQueue /*= nullptr*/ )
+{
+    const fs::path& targetFilePath = target.targetFilePath;
+
+    if ( CreateDirIfUnexisting( targetFilePath.parent_path() ) == false )
     {
+        this->SetError( "Could not create " +
+                        targetFilePath.parent_path().generic_string() );
         return false;
     }
 
-    SpecialFileHandler handler( decryptedBuffer, outFilePath, canDecrypt,
-                                canDecompress );
+    outResultPath = targetFilePath;
+
+    SpecialFileHandler handler( target.decryptedBuffer, outResultPath,
+                                this->m_bAllowDecryption,
+                                this->m_bAllowDecompression,
+                                this->m_TexBufferPool );
+
+    gsl::span<uint8_t> resultBuffer = handler.ProcessDecryption();
+    outResultPath = handler.GetNewFilePath();
+
+    if ( handler.ShouldDecompress() == true )
+    {
+        QueuedTexture texture{ std::move( handler ), &work, target.pEntry,
+                               targetFilePath };
 
-    decryptedBuffer = handler.ProcessData();
-    outFilePath = handler.GetNewFilePath();
+        if ( pTexQueue != nullptr )
+        {
+            {
+                std::lock_guard<std::mutex> lock( pTexQueue->lock );
+                pTexQueue->textures.push_back( std::move( texture ) );
+            }
 
-    bool bFileWritten = WriteBufferToFile( outFilePath, decryptedBuffer );
+            pTexQueue->cond.notify_one();
+            return true;
+        }
+
+        return this->WriteTextureToDisk( texture );
+    }
+
+    bool bFileWritten = WriteBufferToFile( outResultPath, resultBuffer );
 
     if ( bFileWritten == false )
     {
+        this->SetError( "Could not write " + outResultPath.generic_string() );
         return false;
     }
 
+    this->OnFileExtracted( work, target.pEntry, targetFilePath,
+                           outResultPath, resultBuffer.size() );
+
     return true;
 }
 
-static std::set<std::string_view> GetDirChildrenFiles(
-    ArchiveDirectoryNode* pDirNode )
+bool NodeExtractionMgr::WriteTextureToDisk( QueuedTexture& texture )
 {
-    std::set<std::string_view> vChildrenFilenames;
+    gsl::span<uint8_t> texBuffer = texture.handler.ProcessDecompression();
+    const fs::path resultFilePath = texture.handler.GetNewFilePath();
 
-    for ( std::size_t i = 0; i < pDirNode->GetNumOfChildren(); i++ )
+    bool bFileWritten = WriteBufferToFile( resultFilePath, texBuffer );
+
+    if ( bFileWritten == false )
+    {
+        this->SetError( "Could not write " + resultFilePath.generic_string() );
+        return false;
+    }
+
+    this->OnFileExtracted( *texture.pWork, texture.pEntry,
+                           texture.targetFilePath, resultFilePath,
+                           texBuffer.size() );
+
+    return true;
+}
+
+void NodeExtractionMgr::OnFileExtracted( const PkgFileWork& work,
+                                         uc2::PkgEntry* pEntry,
+                                         const fs::path& targetFilePath,
+                                         const fs::path& resultFilePath,
+                                         uint64_t iWrittenBytes )
+{
+    const uint64_t iEntryBytes = pEntry->GetDecryptedSize();
+
+    this->m_iExtractionProgress++;
+
+    if ( this->m_pStats != nullptr )
     {
-        ArchiveBaseNode* pChild = pDirNode->GetChild( i );
-        Q_ASSERT( pChild != nullptr );
+        this->m_pStats->AddWrittenBytes( iWrittenBytes );
+        this->m_pStats->AddExtractedFile( iEntryBytes );
+    }
+
+    if ( work.bStamped == false )
+    {
+        return;
+    }
+
+    ExtractedFileSource source = work.source;
+    source.szEntryPath = pEntry->GetFilePath();
+    source.iEntryBytes = iEntryBytes;
+
+    const std::string szTargetPath =
+        targetFilePath.lexically_relative( this->m_OutPath ).generic_string();
+
+    if ( this->m_pJournal != nullptr )
+    {
+        this->m_pJournal->AddFile(
+            { szTargetPath, source,
+              resultFilePath.lexically_relative( this->m_OutPath )
+                  .generic_string() } );
+    }
 
-        if ( pChild->IsDirectory() == true )
+    if ( this->m_pManifest != nullptr )
+    {
+        this->m_pManifest->Record( szTargetPath, std::move( source ),
+                                   resultFilePath );
+    }
+}
+
+void NodeExtractionMgr::OnFilesSkipped( uint64_t iFilesNum,
+                                        uint64_t iEntryBytes )
+{
+    this->m_iExtractionProgress += gsl::narrow_cast<int>( iFilesNum );
+
+    if ( this->m_pStats != nullptr )
+    {
+        this->m_pStats->AddSkippedFiles( iFilesNum, iEntryBytes );
+    }
+}
+
+bool NodeExtractionMgr::BeginPkgFileSource( const fs::path& pkgParentPath,
+                                            PkgFileWork& work )
+{
+    work.bStamped = false;
+
+    if ( this->m_pManifest == nullptr && this->m_pJournal == nullptr )
+    {
+        return false;
+    }
+
+    const std::string_view pkgFilename = work.pPkgFile->GetFilename();
+
+    work.source.szPkgFilename = pkgFilename;
+    work.source.iOptions =
+        ( this->m_bAllowDecryption == true ? EO_Decrypt : EO_None ) |
+        ( this->m_bAllowDecompression == true ? EO_Decompress : EO_None );
+
+    // without a stamp, the files are extracted but not recorded
+    work.bStamped = IndexMetadataCache::ReadPkgFileStamp(
+        pkgParentPath / pkgFilename, work.source.pkgStamp );
+
+    return work.bStamped;
+}
+
+bool NodeExtractionMgr::IsTargetUpToDate( const PkgFileWork& work,
+                                          const fs::path& targetFilePath,
+                                          std::string_view entryPath,
+                                          uint64_t iEntryBytes )
+{
+    if ( work.bStamped == false )
+    {
+        return false;
+    }
+
+    ExtractedFileSource source = work.source;
+    source.szEntryPath = entryPath;
+    source.iEntryBytes = iEntryBytes;
+
+    const std::string szTargetPath =
+        targetFilePath.lexically_relative( this->m_OutPath ).generic_string();
+    std::string szResultPath;
+
+    // written by an interrupted extraction, trusted without checking it
+    if ( this->m_pJournal != nullptr &&
+         this->m_pJournal->IsFileDone( szTargetPath, source, szResultPath ) ==
+             true )
+    {
+        if ( this->m_pManifest != nullptr )
         {
-            auto vRecursiveChildFiles = GetDirChildrenFiles(
-                static_cast<ArchiveDirectoryNode*>( pChild ) );
-            vChildrenFilenames.insert( vRecursiveChildFiles.begin(),
-                                       vRecursiveChildFiles.end() );
+            this->m_pManifest->Record( szTargetPath, std::move( source ),
+                                       this->m_OutPath / szResultPath );
         }
-        else
+
+        return true;
+    }
+
+    return this->m_pManifest != nullptr &&
+           this->m_pManifest->IsUpToDate( szTargetPath, source );
+}
+
+bool NodeExtractionMgr::IsPkgFileUpToDate( const PkgFileWork& work )
+{
+    if ( work.bStamped == false )
+    {
+        return false;
+    }
+
+    const ExtractedFileSource& pkgSource = work.source;
+
+    // finished by an interrupted extraction
+    if ( this->m_pJournal != nullptr &&
+         this->m_pJournal->IsPkgFileDone( pkgSource.szPkgFilename,
+                                          pkgSource.pkgStamp,
+                                          pkgSource.iOptions ) == true )
+    {
+        if ( this->m_pManifest != nullptr )
         {
-            vChildrenFilenames.insert( static_cast<ArchiveFileNode*>( pChild )
-                                           ->GetOwnerPkgFilename() );
+            for ( auto&& file :
+                  this->m_pJournal->GetPkgFileFiles( pkgSource.szPkgFilename ) )
+            {
+                this->m_pManifest->Record( file.szTargetPath, file.source,
+                                           this->m_OutPath /
+                                               file.szResultPath );
+            }
         }
+
+        return true;
     }
 
-    return vChildrenFilenames;
+    const PkgFileSummary& summary = this->m_PkgFiles.GetSummary( work.iPkgId );
+
+    if ( this->m_pManifest == nullptr || summary.iEntriesNum == 0 )
+    {
+        return false;
+    }
+
+    return this->m_pManifest->CountUpToDate( pkgSource.szPkgFilename,
+                                             pkgSource.pkgStamp,
+                                             pkgSource.iOptions ) >=
+           summary.iEntriesNum;
 }
 
-std::vector<uc2::PkgFile*> NodeExtractionMgr::GetRequiredPkgFiles(
+
+PkgOwnerSet NodeExtractionMgr::GetRequiredPkgFiles(
     const gsl::span<ArchiveBaseNode*> nodes )
 {
-    std::unordered_set<uc2::PkgFile*> uniquePkgFiles;
+    PkgOwnerSet requiredPkgs;
 
     for ( const auto& node : nodes )
     {
         if ( node->IsDirectory() == true )
         {
-            auto vDirFileNodes = GetDirChildrenFiles(
-                static_cast<ArchiveDirectoryNode*>( node ) );
-
-            for ( auto&& childPkgFilename : vDirFileNodes )
-            {
-                std::size_t iOwnerHash =
-                    GenerateHashFromString( childPkgFilename );
-                uc2::PkgFile* pPkgFile =
-                    this->m_PkgFiles.at( iOwnerHash ).get();
-                Q_ASSERT( pPkgFile != nullptr );
-
-                uniquePkgFiles.insert( pPkgFile );
-            }
+            auto pDirNode = static_cast<ArchiveDirectoryNode*>( node );
+            requiredPkgs.Merge( pDirNode->GetOwnerPkgs() );
         }
         else
         {
             auto pFileNode = static_cast<ArchiveFileNode*>( node );
-            std::size_t iOwnerHash =
-                GenerateHashFromString( pFileNode->GetOwnerPkgFilename() );
-            uc2::PkgFile* pPkgFile = this->m_PkgFiles.at( iOwnerHash ).get();
-            Q_ASSERT( pPkgFile != nullptr );
-
-            uniquePkgFiles.insert( pPkgFile );
+            requiredPkgs.Insert( pFileNode->GetOwnerPkgId() );
         }
     }
 
-    return { uniquePkgFiles.begin(), uniquePkgFiles.end() };
+    return requiredPkgs;
+}
+
+NodeExtractionMgr::Snapshot NodeExtractionMgr::TakeSnapshot(
+    const gsl::span<ArchiveBaseNode*> nodes, std::size_t iPkgFilesNum )
+{
+    Snapshot snapshot;
+    snapshot.vRequiredPkgIds =
+        NodeExtractionMgr::GetRequiredPkgFiles( nodes ).GetIds();
+
+    if ( snapshot.vRequiredPkgIds.empty() == true )
+    {
+        return snapshot;
+    }
+
+    // bucket every selected file by its owner in a single pass, so each
+    // package is loaded once and only its own nodes are visited
+    snapshot.vPkgWorkLists.resize( iPkgFilesNum );
+    NodeExtractionMgr::AddNodes( snapshot, nodes );
+
+    return snapshot;
 }
 
 bool NodeExtractionMgr::ExtractNodes(
     const gsl::span<ArchiveBaseNode*> targetNodes,
     const fs::path& pkgParentPath )
 {
-    auto vPkgFiles = this->GetRequiredPkgFiles( targetNodes );
+    Snapshot snapshot = NodeExtractionMgr::TakeSnapshot(
+        targetNodes, this->m_PkgFiles.GetCount() );
+    return this->ExtractSnapshot( snapshot, pkgParentPath );
+}
 
-    for ( auto&& pPkgFile : vPkgFiles )
+bool NodeExtractionMgr::ExtractSnapshot( Snapshot& snapshot,
+                                         const fs::path& pkgParentPath )
+{
+    if ( this->m_pStats != nullptr )
     {
-        Q_ASSERT( pPkgFile != nullptr );
+        for ( auto&& iPkgId : snapshot.vRequiredPkgIds )
+        {
+            for ( auto&& work : snapshot.vPkgWorkLists[iPkgId] )
+            {
+                this->m_pStats->AddTotalBytes(
+                    work.second->GetDecryptedSize() );
+            }
+        }
+    }
 
-        this->AddNodes( targetNodes, pPkgFile );
+    auto extractPkgFile = [&snapshot, &pkgParentPath,
+                           this]( PkgFileWork& work ) {
+        NodeWorkList& workList = snapshot.vPkgWorkLists[work.iPkgId];
+        assert( workList.empty() == false );
 
-        if ( this->HasAnyNodes() == false )
+        if ( this->BeginPkgFileSource( pkgParentPath, work ) == true )
         {
-            continue;
-        }
+            auto upToDateBegin = std::remove_if(
+                workList.begin(), workList.end(),
+                [&work, this]( const auto& nodeWork ) {
+                    ArchiveFileNode* pFileNode = nodeWork.second;
+                    return this->IsTargetUpToDate(
+                        work, this->m_OutPath / nodeWork.first,
+                        pFileNode->GetPath().generic_string(),
+                        pFileNode->GetDecryptedSize() );
+                } );
+
+            for ( auto it = upToDateBegin; it != workList.end(); it++ )
+            {
+                this->OnFilesSkipped( 1, it->second->GetDecryptedSize() );
+            }
+
+            workList.erase( upToDateBegin, workList.end() );
 
-        const bool bDataLoaded =
-            this->LoadPkgFileData( pkgParentPath, pPkgFile );
+            // the package doesn't even need to be read
+            if ( workList.empty() == true )
+            {
+                return true;
+            }
+        }
 
-        if ( bDataLoaded == false )
+        // start the textures we already know of first, so their
+        // decompression overlaps with the decryption of everything else
+        if ( this->m_bAllowDecompression == true )
         {
-            return false;
+            std::stable_partition(
+                workList.begin(), workList.end(), []( const auto& nodeWork ) {
+                    return nodeWork.second->IsLzmaTexture();
+                } );
         }
 
-        const bool bFilesWritten = this->WriteNodesToDisk();
+        auto dataLock = this->m_PkgFiles.LockData( work.iPkgId );
+        auto releaseData = gsl::finally(
+            [&work]() { work.pPkgFile->ReleaseDataBuffer(); } );
+
+        // the files picked from the tree are likely to be previewed or
+        // extracted again soon
+        work.bKeepResident = true;
+
+        // a package that can't be loaded doesn't stop the others
+        if ( this->LoadPkgFileData( pkgParentPath, work ) == false )
+        {
+            this->OnPkgFileFailed( work );
+            return true;
+        }
 
-        if ( bFilesWritten == false )
+        if ( this->WriteNodesToDisk( work, workList ) == false )
         {
             return false;
         }
 
-        pPkgFile->ReleaseDataBuffer();
-        this->m_vLoadedPkgFile.clear();
-    }
+        if ( this->m_pJournal != nullptr )
+        {
+            this->m_pJournal->Flush();
+        }
 
-    return true;
+        return true;
+    };
+
+    return this->ExtractPkgFilesParallel( snapshot.vRequiredPkgIds,
+                                          extractPkgFile );
 }
 
-bool NodeExtractionMgr::ExtractPackages( gsl::span<uc2::PkgFile*> pkgs,
-                                         const fs::path& pkgParentPath )
+bool NodeExtractionMgr::ExtractPackages( const fs::path& pkgParentPath )
 {
-    for ( auto&& pPkgFile : pkgs )
-    {
-        Q_ASSERT( pPkgFile != nullptr );
+    std::vector<PkgFileId> vPkgIds( this->m_PkgFiles.GetCount() );
+    std::iota( vPkgIds.begin(), vPkgIds.end(), 0 );
 
-        auto ownerPkgPath = pkgParentPath;
-        ownerPkgPath /= pPkgFile->GetFilename();
-
-        auto [bPkgRead, vPkgData] = ReadFileToBuffer( ownerPkgPath );
+    if ( this->m_pStats != nullptr )
+    {
+        // the packages may not be parsed yet, so use their summaries
+        for ( auto&& iPkgId : vPkgIds )
+        {
+            this->m_pStats->AddTotalBytes(
+                this->m_PkgFiles.GetSummary( iPkgId ).iDecryptedBytes );
+        }
+    }
 
-        if ( bPkgRead == false )
+    auto extractPkgFile = [&pkgParentPath, this]( PkgFileWork& work ) {
+        // the package doesn't even need to be read
+        if ( this->BeginPkgFileSource( pkgParentPath, work ) == true &&
+             this->IsPkgFileUpToDate( work ) == true )
         {
-            return false;
+            const PkgFileSummary& summary =
+                this->m_PkgFiles.GetSummary( work.iPkgId );
+            this->OnFilesSkipped( summary.iEntriesNum,
+                                  summary.iDecryptedBytes );
+            return true;
         }
 
-        pPkgFile->SetDataBuffer( vPkgData );
-        pPkgFile->DecryptHeader();
-        pPkgFile->Parse();
+        auto dataLock = this->m_PkgFiles.LockData( work.iPkgId );
+        auto releaseData = gsl::finally(
+            [&work]() { work.pPkgFile->ReleaseDataBuffer(); } );
 
-        bool bRes = this->WritePackageToDisk( pPkgFile );
+        // a package that can't be loaded doesn't stop the others
+        if ( this->LoadPkgFileData( pkgParentPath, work ) == false )
+        {
+            this->OnPkgFileFailed( work );
+            return true;
+        }
 
-        if ( bRes == false )
+        if ( this->WritePackageToDisk( work ) == false )
         {
             return false;
         }
-    }
 
-    return true;
+        if ( this->m_pJournal != nullptr && work.bStamped == true )
+        {
+            this->m_pJournal->AddPkgFile( work.source.szPkgFilename,
+                                          work.source.pkgStamp,
+                                          work.source.iOptions );
+        }
+
+        return true;
+    };
+
+    return this->ExtractPkgFilesParallel( vPkgIds, extractPkgFile );
 }
 
 bool NodeExtractionMgr::ExtractSingleFileNode( ArchiveFileNode* pFileNode,
                                                const fs::path& pkgParentPath,
                                                fs::path& outResultPath )
 {
-    std::size_t iOwnerHash =
-        GenerateHashFromString( pFileNode->GetOwnerPkgFilename() );
-    auto pPkgFile = this->m_PkgFiles.at( iOwnerHash ).get();
-    Q_ASSERT( pPkgFile != nullptr );
-
-    this->AddFileNode( pFileNode, pPkgFile );
+    // previews aren't recorded in manifests or journals
+    PkgFileWork work;
+    work.iPkgId = pFileNode->GetOwnerPkgId();
+    work.pPkgFile = this->m_PkgFiles.Get( work.iPkgId );
+    assert( work.pPkgFile != nullptr );
+    work.bKeepResident = true;
 
-    const bool bDataLoaded = this->LoadPkgFileData( pkgParentPath, pPkgFile );
+    outResultPath = this->m_OutPath / pFileNode->GetPath().filename();
 
-    if ( bDataLoaded == false )
+    if ( this->m_pStats != nullptr )
     {
-        return false;
+        this->m_pStats->AddTotalBytes( pFileNode->GetDecryptedSize() );
     }
 
-    const bool bWritten = this->WriteSingleNodeToDisk( outResultPath );
+    auto dataLock = this->m_PkgFiles.LockData( work.iPkgId );
+    auto releaseData =
+        gsl::finally( [&work]() { work.pPkgFile->ReleaseDataBuffer(); } );
 
-    if ( bWritten == false )
+    if ( this->LoadPkgFileData( pkgParentPath, work ) == false )
     {
         return false;
     }
 
-    pPkgFile->ReleaseDataBuffer();
-    this->m_vLoadedPkgFile.clear();
+    EntryTarget target;
+    target.pEntry = GetNodeEntry( work.pPkgFile, pFileNode );
+    target.targetFilePath = outResultPath;
 
-    return true;
+    // no other worker decrypts from this package's work
+    return target.pEntry != nullptr &&
+           this->DecryptPkgEntry( target ) == true &&
+           this->WriteDecryptedEntry( work, target, outResultPath );
 }
@@ -3,23 +3,24 @@
 #include <QDrag>
 #include <QIcon>
 #include <QLabel>
+#include <QLocale>
 #include <QMimeDatabase>
+#include <QStandardPaths>
+
+#include <atomic>
 
 #include "archivefilenode.hpp"
 #include "pkgfilemodelsorter.hpp"
 
-#include "dynindexfilefactory.hpp"
-#include "dynpkgfilefactory.hpp"
 #include "fsutils.hpp"
 #include "miscutils.hpp"
 #include "nodeextractionmgr.hpp"
 #include "widgets/statuswidget.hpp"
 
 PkgFileModel::PkgFileModel( QWidget* pParent /*= nullptr*/ )
-    : QAbstractItemModel( pParent ), m_DirectoryNodes(), m_RootNode( "" ),
-      m_iSortColumn( PFS_FileNameColumn ), m_SortOrder( Qt::AscendingOrder ),
-      m_bForceSort( true ), m_bGenerated( false ), m_bIsBusy( false ),
-      m_bIsIndexLoaded( false )
+    : QAbstractItemModel( pParent ), m_iSortColumn( PFS_FileNameColumn ),
+      m_SortOrder( Qt::AscendingOrder ), m_bForceSort( true ),
+      m_bGenerated( false ), m_bIsBusy( false )
 {
 }
 
@@ -85,7 +86,7 @@ QVariant PkgFileModel::data( const QModelIndex& index, int role ) const
     switch ( role )
     {
         case Qt::DisplayRole:
-            return pNode->GetData( index.column() );
+            return this->GetNodeDisplayData( pNode, index.column() );
         case Qt::DecorationRole:
             if ( index.column() == 0 )
             {
@@ -96,6 +97,45 @@ QVariant PkgFileModel::data( const QModelIndex& index, int role ) const
     return QVariant();
 }
 
+QVariant PkgFileModel::GetNodeDisplayData( ArchiveBaseNode* pNode,
+                                           int column ) const
+{
+    if ( column == PFS_FileNameColumn )
+    {
+        return QString::fromStdString(
+            pNode->GetPath().filename().generic_string() );
+    }
+
+    if ( pNode->IsDirectory() == true )
+    {
+        if ( column == PFS_TypeColumn )
+        {
+            return tr( "Directory" );
+        }
+
+        return QVariant();
+    }
+
+    auto pFileNode = static_cast<ArchiveFileNode*>( pNode );
+
+    switch ( column )
+    {
+        case PFS_TypeColumn:
+            return tr( "%1 file" ).arg( QString::fromStdString(
+                pFileNode->GetPath().extension().generic_string() ) );
+        case PFS_SizeColumn:
+            return QLocale::system().formattedDataSize(
+                gsl::narrow_cast<qint64>( pFileNode->GetDecryptedSize() ) );
+        case PFS_OwnerPkgColumn:
+            return QString::fromUtf8(
+                pFileNode->GetOwnerPkgFilename().data(),
+                gsl::narrow_cast<int>(
+                    pFileNode->GetOwnerPkgFilename().size() ) );
+    }
+
+    return QVariant();
+}
+
 bool PkgFileModel::setData( const QModelIndex& index, const QVariant& value,
                             int role /*= Qt::EditRole*/ )
 {
@@ -156,7 +196,7 @@ QModelIndex PkgFileModel::index( int row, int column,
     const ArchiveDirectoryNode* pParentNode;
 
     if ( !parent.isValid() )
-        pParentNode = &this->m_RootNode;
+        pParentNode = this->m_Tree.GetRootNode();
     else
         pParentNode =
             static_cast<ArchiveDirectoryNode*>( parent.internalPointer() );
@@ -177,7 +217,7 @@ QModelIndex PkgFileModel::index( const ArchiveBaseNode* node, int column ) const
 {
     ArchiveDirectoryNode* pParentNode = node ? node->GetParentNode() : nullptr;
 
-    if ( node == &this->m_RootNode || pParentNode == nullptr )
+    if ( node == this->m_Tree.GetRootNode() || pParentNode == nullptr )
         return QModelIndex();
 
     const int iVisualRow = pParentNode->GetLocationOf( node );
@@ -197,7 +237,7 @@ QModelIndex PkgFileModel::parent( const QModelIndex& index ) const
     auto pChildItem = static_cast<ArchiveBaseNode*>( index.internalPointer() );
     auto pParentItem = pChildItem->GetParentNode();
 
-    if ( pParentItem == &this->m_RootNode )
+    if ( pParentItem == this->m_Tree.GetRootNode() )
         return QModelIndex();
 
     const int iVisualRow =
@@ -217,7 +257,7 @@ int PkgFileModel::rowCount( const QModelIndex& parent ) const
 
     if ( !parent.isValid() )
     {
-        pParentItem = &this->m_RootNode;
+        pParentItem = this->m_Tree.GetRootNode();
     }
     else
     {
@@ -304,7 +344,7 @@ void PkgFileModel::sort( int column, Qt::SortOrder order )
     if ( this->ShouldOrderColumn( column, order ) == true )
     {
         // we sort only from where we are, don't need to sort all the model
-        for ( const auto& node : this->m_DirectoryNodes )
+        for ( const auto& node : this->m_Tree.GetDirectoryNodes() )
         {
             if ( node.second->HasChildren() == true )
             {
@@ -378,7 +418,7 @@ ArchiveBaseNode* PkgFileModel::GetNode( const QModelIndex& index ) const
 {
     if ( !index.isValid() )
     {
-        return const_cast<ArchiveDirectoryNode*>( &this->m_RootNode );
+        return const_cast<ArchiveDirectoryNode*>( this->m_Tree.GetRootNode() );
     }
 
     auto indexNode = static_cast<ArchiveBaseNode*>( index.internalPointer() );
@@ -387,50 +427,26 @@ ArchiveBaseNode* PkgFileModel::GetNode( const QModelIndex& index ) const
     return indexNode;
 }
 
-bool PkgFileModel::LoadPackage( const fs::path& pkgPath, GameProvider provider,
-                                bool bIndependentLoad /*= true*/ )
+bool PkgFileModel::LoadPackage(
+    const fs::path& pkgPath, GameProvider provider,
+    bool bIndependentLoad /*= true*/,
+    IndexMetadataCache* pMetadataCache /*= nullptr*/ )
 {
     this->m_bIsBusy = true;
 
-    uc2::PkgFile::ptr_t pPkgFile;
-
-    try
-    {
-        DynamicPkgFileFactory f( pkgPath, provider );
-        pPkgFile = f.GetPkgFileOwnership();
-
-        Q_ASSERT( pPkgFile != nullptr );
-
-        pPkgFile->Parse();
-        this->CreateChildren( pPkgFile->GetEntries(), pkgPath );
-
-        if ( bIndependentLoad == true )
-        {
-            this->m_CurFileProps.SetPkgFileProperties( f.GetProvider(),
-                                                       pPkgFile.get() );
-        }
-
-        pPkgFile->ReleaseDataBuffer();
-    }
-    catch ( const std::exception& e )
+    if ( this->m_Tree.LoadPackage( pkgPath, provider, bIndependentLoad,
+                                   pMetadataCache ) == false )
     {
-        qDebug() << e.what();
-        this->SetError( e.what() );
+        this->SetError( this->m_Tree.GetError() );
 
         this->m_bIsBusy = false;
         return false;
     }
 
-    std::string szFilename = pkgPath.filename().generic_string();
-    const size_t iPkgFileHash = GenerateHashFromString( szFilename );
-    this->m_PkgFiles[iPkgFileHash] = std::move( pPkgFile );
-
     if ( bIndependentLoad == true )
     {
         this->m_bForceSort = true;
         this->sort( PFS_FileNameColumn );
-
-        this->m_CurrentParentPath = pkgPath.parent_path();
     }
 
     this->m_bIsBusy = false;
@@ -440,77 +456,34 @@ bool PkgFileModel::LoadPackage( const fs::path& pkgPath, GameProvider provider,
 }
 
 bool PkgFileModel::LoadIndex( const fs::path& indexPath, GameProvider provider,
-                              int& outLoadProgress, std::size_t& outPkgNum )
+                              std::atomic<int>& outLoadProgress,
+                              std::atomic<int>& outPkgNum,
+                              const CancellationToken& cancelToken )
 {
-    auto entryFilter = []( const std::vector<std::string_view>& fileEntries ) {
-        std::vector<std::string_view> vFilenames;
-        if ( fileEntries.empty() == false )
-        {
-            auto cur = fileEntries.begin();
-            cur++;  // skip first entry since it's the index file's name
-            for ( ; cur != fileEntries.end(); cur++ )
-            {
-                if ( cur->find( ".pkg" ) != std::string::npos )
-                {
-                    vFilenames.push_back( *cur );
-                }
-            }
-        }
-        return vFilenames;
-    };
-
     this->m_bIsBusy = true;
 
-    auto [bIndexRead, vIndexData] = ReadFileToBuffer( indexPath );
+    // kept next to the settings
+    const fs::path metadataCacheDir =
+        QStandardPaths::writableLocation( QStandardPaths::AppConfigLocation )
+            .toStdString();
 
-    if ( bIndexRead == false )
+    if ( this->m_Tree.LoadIndex( indexPath, provider,
+                                 metadataCacheDir / "indexcache",
+                                 outLoadProgress, outPkgNum,
+                                 cancelToken ) == false )
     {
-        this->SetErrorQstr( tr( "Could not read index file" ) );
+        this->SetError( this->m_Tree.GetError() );
 
-        this->m_bIsBusy = false;
+        this->m_bGenerated = false;
+        this->ResetModel();
         return false;
     }
 
-    DynamicIndexFileFactory f( indexPath, vIndexData );
-    auto pIndex = f.GetPkgIndexOwnership();
-
-    if ( !pIndex )
-    {
-        this->SetErrorQstr( tr( "Could not detect index's game provider" ) );
-
-        this->m_bIsBusy = false;
-        return false;
-    }
-
-    auto fileEntries = entryFilter( pIndex->GetFilenames() );
-    fs::path indexParentPath = indexPath.parent_path();
-
-    outPkgNum = fileEntries.size();
-
-    for ( auto&& entryFilename : fileEntries )
-    {
-        fs::path fullEntryPath = indexParentPath;
-        fullEntryPath /= entryFilename;
-
-        if ( this->LoadPackage( fullEntryPath, provider, false ) == false )
-        {
-            this->m_bGenerated = false;
-            this->ResetModel();
-            return false;
-        }
-
-        outLoadProgress++;
-    }
-
-    this->m_CurFileProps.SetIndexFileProperties( provider, this->m_PkgFiles );
-
     this->m_bForceSort = true;
     this->sort( PFS_FileNameColumn );
 
-    this->m_CurrentParentPath = indexParentPath;
-    this->m_bIsIndexLoaded = true;
-
     this->m_bIsBusy = false;
+    this->m_bGenerated = true;
 
     return true;
 }
@@ -519,13 +492,8 @@ void PkgFileModel::ResetModel()
 {
     this->beginResetModel();
 
-    this->m_DirectoryNodes.clear();
-    this->m_PkgFiles.clear();
-
-    this->m_RootNode.FreeChildren();
-
+    this->m_Tree.Clear();
     this->m_SelectedNodes.clear();
-    this->m_CurrentParentPath.clear();
 
     this->endResetModel();
 
@@ -533,7 +501,6 @@ void PkgFileModel::ResetModel()
 
     this->m_bGenerated = false;
     this->m_bIsBusy = false;
-    this->m_bIsIndexLoaded = false;
 }
 
 Qt::DropActions PkgFileModel::supportedDropActions() const
@@ -588,53 +555,6 @@ QMimeData* PkgFileModel::mimeData( const QModelIndexList& indexes ) const
     return mimeData;
 }
 
-void PkgFileModel::CreateChildren(
-    const std::vector<uc2::PkgFile::entryptr_t>& pEntries,
-    const fs::path& pkgPath )
-{
-    auto pParent = &this->m_RootNode;
-
-    // A PKG file has files from only one directory
-    // But a directory might come from multiple PKG files
-    const fs::path filePath = pEntries[0]->GetFilePath();
-
-    auto pathBegin = filePath.begin();
-    auto pathEnd = filePath.end();
-    auto pathLast = --pathEnd;
-
-    // skip root directory
-    size_t iCurIndex = 1;
-    pathBegin++;
-
-    for ( auto it = pathBegin; it != pathLast; it++ )
-    {
-        const fs::path subPath = *it;
-        std::string szPathName = PathStrFromIterators( pathBegin, it );
-
-        auto search = this->m_DirectoryNodes[szPathName];
-
-        if ( search != nullptr )
-        {
-            pParent = search;
-        }
-        else
-        {
-            auto pNewParent = new ArchiveDirectoryNode( szPathName, pParent );
-            this->m_DirectoryNodes[szPathName] = pNewParent;
-            pParent->AddChild( pNewParent );
-            pParent = pNewParent;
-        }
-
-        iCurIndex++;
-    }
-
-    for ( auto&& pEntry : pEntries )
-    {
-        pParent->AddChild(
-            new ArchiveFileNode( pkgPath, pEntry.get(), pParent ) );
-    }
-}
-
 void PkgFileModel::UpdateNodeChildren( const QModelIndex& modelIndex,
                                        const QVariant& value )
 {
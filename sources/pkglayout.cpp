@@ -0,0 +1,108 @@
+#include "pkglayout.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#include <gsl/gsl>
+
+#include "md5.hpp"
+
+PkgLayout::PkgLayout( GameProvider provider, uint64_t iMaxPkgFileBytes )
+    : m_Provider( provider ), m_iMaxPkgFileBytes( iMaxPkgFileBytes )
+{
+}
+
+bool PkgLayout::AddDirectory( const fs::path& rootDir )
+{
+    std::error_code errorCode;
+    std::vector<PkgLayoutEntry> vEntries;
+
+    for ( fs::recursive_directory_iterator it( rootDir, errorCode ), end;
+          errorCode.value() == 0 && it != end; it.increment( errorCode ) )
+    {
+        if ( it->is_regular_file( errorCode ) == false )
+        {
+            continue;
+        }
+
+        PkgLayoutEntry entry;
+        entry.sourcePath = it->path();
+        entry.szEntryPath =
+            '/' + it->path().lexically_relative( rootDir ).generic_string();
+        entry.iSize = it->file_size( errorCode );
+
+        if ( entry.szEntryPath.size() >= PKG_ENTRY_PATH_MAX_LEN )
+        {
+            this->m_szLastError = "The path is too long for a package: " +
+                                  entry.szEntryPath;
+            return false;
+        }
+
+        vEntries.push_back( std::move( entry ) );
+    }
+
+    if ( errorCode.value() != 0 )
+    {
+        this->m_szLastError = "Could not read " + rootDir.generic_string() +
+                              ": " + errorCode.message();
+        return false;
+    }
+
+    // the same tree always gets the same layout
+    std::sort( vEntries.begin(), vEntries.end(),
+               []( const PkgLayoutEntry& left, const PkgLayoutEntry& right ) {
+                   return left.szEntryPath < right.szEntryPath;
+               } );
+
+    for ( auto&& entry : vEntries )
+    {
+        PkgLayoutFile& pkgFile = this->GetPkgFileWithRoom( entry.iSize );
+        pkgFile.iTotalBytes += entry.iSize;
+        pkgFile.vEntries.push_back( std::move( entry ) );
+    }
+
+    return true;
+}
+
+std::vector<std::string_view> PkgLayout::GetIndexPkgFilenames() const
+{
+    std::vector<std::string_view> vFilenames;
+    vFilenames.reserve( this->m_vPkgFiles.size() );
+
+    for ( auto&& pkgFile : this->m_vPkgFiles )
+    {
+        vFilenames.push_back( pkgFile.szFilename );
+    }
+
+    return vFilenames;
+}
+
+PkgLayoutFile& PkgLayout::GetPkgFileWithRoom( uint64_t iEntrySize )
+{
+    if ( this->m_vPkgFiles.empty() == false )
+    {
+        PkgLayoutFile& lastPkgFile = this->m_vPkgFiles.back();
+
+        if ( lastPkgFile.vEntries.empty() == true ||
+             lastPkgFile.iTotalBytes + iEntrySize <= this->m_iMaxPkgFileBytes )
+        {
+            return lastPkgFile;
+        }
+    }
+
+    PkgLayoutFile newPkgFile;
+    newPkgFile.szFilename =
+        PkgLayout::GetPkgFilename( this->m_vPkgFiles.size() );
+    this->m_vPkgFiles.push_back( std::move( newPkgFile ) );
+
+    return this->m_vPkgFiles.back();
+}
+
+std::string PkgLayout::GetPkgFilename( std::size_t iPkgFileNum )
+{
+    const std::string szSeed = "uc2-layout-" + std::to_string( iPkgFileNum );
+    const Md5Digest digest = Md5::Hash(
+        { reinterpret_cast<const uint8_t*>( szSeed.data() ), szSeed.size() } );
+
+    return Md5::ToHex( digest ) + ".pkg";
+}
@@ -0,0 +1,426 @@
+#include "pkgwriter.hpp"
+
+#include <array>
+#include <limits>
+
+#include <uc2/encryptedfile.hpp>
+#include <uc2/lzmatexture.hpp>
+#include <uc2/pkgentry.hpp>
+
+#include "aes128.hpp"
+#include "binarybuffer.hpp"
+#include "dynindexfilefactory.hpp"
+#include "dynpkgfilefactory.hpp"
+#include "fsutils.hpp"
+#include "indexkeycollections.hpp"
+#include "lzmaencoder.hpp"
+#include "miscutils.hpp"
+#include "pkgkeys.hpp"
+
+//
+// The game only runs on little endian machines, so BinaryBufferWriter's
+// host byte order is the game's byte order
+//
+
+// the header of encrypted files, which the index is too
+constexpr const uint16_t ENCRYPTED_FILE_VERSION = 23;
+constexpr const uint8_t ENCRYPTED_FILE_CIPHER_AES = 4;
+
+// a hex MD5 of the rest of the package comes before its header
+constexpr const std::size_t PKG_FILE_HASH_LEN = 32;
+constexpr const uint16_t PKG_FILE_VERSION = 2;
+
+constexpr const std::array<uint8_t, 4> LZMA_TEXTURE_MAGIC = { 'L', 'Z', 'M',
+                                                              'A' };
+
+static gsl::span<const uint8_t> StrToBytes( std::string_view szView )
+{
+    return { reinterpret_cast<const uint8_t*>( szView.data() ),
+             szView.size() };
+}
+
+static Aes128Key DeriveKey( gsl::span<const uint8_t> keyMaterial,
+                            const std::string& szFilename )
+{
+    Md5 hash;
+    hash.Update( keyMaterial );
+    hash.Update( StrToBytes( szFilename ) );
+    return hash.Finish();
+}
+
+// pads the data after iOffset with zeroes and encrypts it
+static void EncryptFrom( std::vector<uint8_t>& vData, std::size_t iOffset,
+                         const Aes128Key& key )
+{
+    const uint64_t iPaddedSize =
+        Aes128::GetPaddedSize( vData.size() - iOffset );
+    vData.resize( iOffset + iPaddedSize, 0 );
+
+    Aes128( key ).EncryptCbc( { vData.data() + iOffset, iPaddedSize } );
+}
+
+static bool EncodeEncryptedFile( const std::string& szFilename,
+                                 gsl::span<const uint8_t> data,
+                                 const uint8_t ( &keyCollection )[4][16],
+                                 std::vector<uint8_t>& vOut )
+{
+    if ( data.size() > std::numeric_limits<uint32_t>::max() )
+    {
+        return false;
+    }
+
+    // spreads the files over the collection's keys
+    const uint8_t iKeyFlag =
+        static_cast<uint8_t>( Md5::Hash( StrToBytes( szFilename ) )[0] % 4 );
+
+    vOut.clear();
+
+    BinaryBufferWriter writer( vOut );
+    writer.Write( ENCRYPTED_FILE_VERSION );
+    writer.Write( ENCRYPTED_FILE_CIPHER_AES );
+    writer.Write( iKeyFlag );
+    writer.Write( static_cast<uint32_t>( data.size() ) );
+
+    const std::size_t iHeaderSize = vOut.size();
+    vOut.insert( vOut.end(), data.begin(), data.end() );
+
+    const gsl::span<const uint8_t> keyMaterial( keyCollection[iKeyFlag],
+                                                sizeof( keyCollection[0] ) );
+    EncryptFrom( vOut, iHeaderSize, DeriveKey( keyMaterial, szFilename ) );
+    return true;
+}
+
+static void EncodeLzmaTexture( gsl::span<const uint8_t> data,
+                               std::vector<uint8_t>& vOut )
+{
+    vOut.assign( LZMA_TEXTURE_MAGIC.begin(), LZMA_TEXTURE_MAGIC.end() );
+
+    BinaryBufferWriter writer( vOut );
+    writer.Write( static_cast<uint64_t>( data.size() ) );
+    writer.Write( LzmaEncoder::GetProps() );
+
+    LzmaEncoder::Encode( data, vOut );
+}
+
+// like ".etxt", SpecialFileHandler renames them when decrypting them
+static bool HasEncryptedExtension( const fs::path& filePath )
+{
+    const std::string szExtension = filePath.extension().generic_string();
+    return szExtension.size() > 2 && szExtension[1] == 'e';
+}
+
+PkgWriter::PkgWriter( const PkgLayout& layout, fs::path outDir )
+    : m_Layout( layout ), m_OutDir( std::move( outDir ) ),
+      m_bEncodeSpecialFiles( true ), m_bVerify( true ), m_iWrittenBytes( 0 )
+{
+}
+
+bool PkgWriter::Write()
+{
+    this->m_iWrittenBytes = 0;
+
+    if ( CreateDirIfUnexisting( this->m_OutDir ) == false )
+    {
+        this->m_szLastError =
+            "Could not create " + this->m_OutDir.generic_string();
+        return false;
+    }
+
+    for ( auto&& pkgFile : this->m_Layout.GetPkgFiles() )
+    {
+        if ( this->WritePkgFile( pkgFile ) == false )
+        {
+            return false;
+        }
+    }
+
+    return this->WriteIndexFile();
+}
+
+//
+// A package is its hash, then its header and entry table encrypted with the
+// entry key, then each entry's data encrypted with the data key
+//
+// Both keys are hashed with the package's filename, so no two packages are
+// encrypted with the same keys
+//
+bool PkgWriter::WritePkgFile( const PkgLayoutFile& pkgFile )
+{
+    auto [entryKey, dataKey] =
+        GetPackageKeysByProvider( this->m_Layout.GetProvider() );
+
+    const Aes128Key headerAesKey =
+        DeriveKey( StrToBytes( entryKey ), pkgFile.szFilename );
+    const Aes128Key dataAesKey =
+        DeriveKey( StrToBytes( dataKey ), pkgFile.szFilename );
+
+    std::vector<uint8_t> vEntryTable;
+    std::vector<uint8_t> vEntriesData;
+    std::vector<uint8_t> vStoredData;
+    std::vector<Md5Digest> vEntryDigests;
+
+    BinaryBufferWriter tableWriter( vEntryTable );
+    vEntryDigests.reserve( pkgFile.vEntries.size() );
+
+    for ( auto&& entry : pkgFile.vEntries )
+    {
+        if ( this->LoadEntryData( entry, vStoredData ) == false )
+        {
+            return false;
+        }
+
+        vEntryDigests.push_back( Md5::Hash( vStoredData ) );
+
+        const std::size_t iDataOffset = vEntriesData.size();
+        vEntriesData.insert( vEntriesData.end(), vStoredData.begin(),
+                             vStoredData.end() );
+        EncryptFrom( vEntriesData, iDataOffset, dataAesKey );
+
+        std::array<char, PKG_ENTRY_PATH_MAX_LEN> entryPath{};
+        entry.szEntryPath.copy( entryPath.data(), entryPath.size() - 1 );
+
+        tableWriter.Write( entryPath );
+        tableWriter.Write( static_cast<uint64_t>( iDataOffset ) );
+        tableWriter.Write(
+            static_cast<uint64_t>( vEntriesData.size() - iDataOffset ) );
+        tableWriter.Write( static_cast<uint64_t>( vStoredData.size() ) );
+        tableWriter.Write( static_cast<uint8_t>( true ) );
+    }
+
+    std::vector<uint8_t> vPkgData( PKG_FILE_HASH_LEN );
+
+    BinaryBufferWriter headerWriter( vPkgData );
+    headerWriter.Write( PKG_FILE_VERSION );
+    headerWriter.Write( gsl::narrow<uint32_t>( pkgFile.vEntries.size() ) );
+    EncryptFrom( vPkgData, PKG_FILE_HASH_LEN, headerAesKey );
+
+    const std::size_t iTableOffset = vPkgData.size();
+    vPkgData.insert( vPkgData.end(), vEntryTable.begin(), vEntryTable.end() );
+    EncryptFrom( vPkgData, iTableOffset, headerAesKey );
+
+    vPkgData.insert( vPkgData.end(), vEntriesData.begin(),
+                     vEntriesData.end() );
+
+    const gsl::span<const uint8_t> hashedData( vPkgData );
+    const std::string szHash = Md5::ToHex( Md5::Hash( hashedData.subspan(
+        PKG_FILE_HASH_LEN, hashedData.size() - PKG_FILE_HASH_LEN ) ) );
+    szHash.copy( reinterpret_cast<char*>( vPkgData.data() ),
+                 PKG_FILE_HASH_LEN );
+
+    const fs::path pkgPath = this->m_OutDir / pkgFile.szFilename;
+
+    if ( WriteBufferToFile( pkgPath, vPkgData ) == false )
+    {
+        this->m_szLastError = "Could not write " + pkgPath.generic_string();
+        return false;
+    }
+
+    this->m_iWrittenBytes += vPkgData.size();
+
+    if ( this->m_bVerify == true )
+    {
+        return this->VerifyPkgFile( pkgFile, vEntryDigests );
+    }
+
+    return true;
+}
+
+// the index lists its own filename first, then the packages
+bool PkgWriter::WriteIndexFile()
+{
+    const std::string szIndexFilename( INDEX_FILENAME );
+    std::string szIndexText = szIndexFilename + '\n';
+
+    for ( auto&& szPkgFilename : this->m_Layout.GetIndexPkgFilenames() )
+    {
+        szIndexText += szPkgFilename;
+        szIndexText += '\n';
+    }
+
+    const auto& keyCollection = this->m_Layout.IsTfoLayout() == true ?
+                                    TFO_INDEX_KEY_COLLECTION :
+                                    CS_INDEX_KEY_COLLECTION;
+
+    std::vector<uint8_t> vIndexData;
+
+    if ( EncodeEncryptedFile( szIndexFilename, StrToBytes( szIndexText ),
+                              keyCollection, vIndexData ) == false )
+    {
+        this->m_szLastError = "The index is too big";
+        return false;
+    }
+
+    const fs::path indexPath = this->m_OutDir / INDEX_FILENAME;
+
+    if ( WriteBufferToFile( indexPath, vIndexData ) == false )
+    {
+        this->m_szLastError = "Could not write " + indexPath.generic_string();
+        return false;
+    }
+
+    this->m_iWrittenBytes += vIndexData.size();
+
+    if ( this->m_bVerify == true )
+    {
+        return this->VerifyIndexFile();
+    }
+
+    return true;
+}
+
+//
+// .e* files are always encrypted with CS's keys, whatever the provider,
+// since SpecialFileHandler decrypts them with those
+//
+bool PkgWriter::LoadEntryData( const PkgLayoutEntry& entry,
+                               std::vector<uint8_t>& vOutData )
+{
+    auto [bFileRead, vFileData] = ReadFileToBuffer( entry.sourcePath );
+
+    if ( bFileRead == false )
+    {
+        this->m_szLastError =
+            "Could not read " + entry.sourcePath.generic_string();
+        return false;
+    }
+
+    const fs::path entryPath = entry.szEntryPath;
+
+    if ( this->m_bEncodeSpecialFiles == false )
+    {
+        vOutData = std::move( vFileData );
+    }
+    else if ( HasEncryptedExtension( entryPath ) == true &&
+              uc2::EncryptedFile::IsEncryptedFile(
+                  vFileData.data(), vFileData.size() ) == false )
+    {
+        if ( EncodeEncryptedFile( entryPath.filename().generic_string(),
+                                  vFileData, CS_INDEX_KEY_COLLECTION,
+                                  vOutData ) == false )
+        {
+            this->m_szLastError =
+                "The file is too big to be encrypted: " + entry.szEntryPath;
+            return false;
+        }
+    }
+    else if ( entryPath.extension() == ".vtf" &&
+              uc2::LzmaTexture::IsLzmaTexture( vFileData.data(),
+                                               vFileData.size() ) == false )
+    {
+        EncodeLzmaTexture( vFileData, vOutData );
+    }
+    else
+    {
+        vOutData = std::move( vFileData );
+    }
+
+    return true;
+}
+
+bool PkgWriter::VerifyPkgFile( const PkgLayoutFile& pkgFile,
+                               const std::vector<Md5Digest>& vEntryDigests )
+{
+    const fs::path pkgPath = this->m_OutDir / pkgFile.szFilename;
+    const std::string szPkgPath = pkgPath.generic_string();
+
+    // outlives the package, which reads from it
+    auto [bPkgRead, vPkgData] = ReadFileToBuffer( pkgPath );
+
+    if ( bPkgRead == false )
+    {
+        this->m_szLastError = "Could not read back " + szPkgPath;
+        return false;
+    }
+
+    try
+    {
+        DynamicPkgFileFactory factory(
+            pkgPath, this->m_Layout.GetProvider(),
+            DynamicPkgFileFactory::LoadMode::BaseHeader );
+        uc2::PkgFile::ptr_t pPkgFile = factory.GetPkgFileOwnership();
+
+        pPkgFile->SetDataBuffer( vPkgData );
+
+        if ( pPkgFile->DecryptHeader() == false ||
+             pPkgFile->Parse() == false )
+        {
+            this->m_szLastError = "libuncso2 could not parse " + szPkgPath;
+            return false;
+        }
+
+        auto& vEntries = pPkgFile->GetEntries();
+
+        if ( vEntries.size() != pkgFile.vEntries.size() )
+        {
+            this->m_szLastError =
+                "libuncso2 read the wrong number of entries from " +
+                szPkgPath;
+            return false;
+        }
+
+        for ( std::size_t i = 0; i < vEntries.size(); i++ )
+        {
+            const std::string& szEntryPath = pkgFile.vEntries[i].szEntryPath;
+
+            if ( vEntries[i]->GetFilePath() != szEntryPath )
+            {
+                this->m_szLastError =
+                    "libuncso2 read the wrong path instead of " + szEntryPath;
+                return false;
+            }
+
+            auto decrypted = PairToSpan( vEntries[i]->DecryptFile() );
+
+            if ( Md5::Hash( decrypted ) != vEntryDigests[i] )
+            {
+                this->m_szLastError =
+                    "libuncso2 decrypted the wrong data for " + szEntryPath;
+                return false;
+            }
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        this->m_szLastError =
+            "libuncso2 could not read " + szPkgPath + ": " + e.what();
+        return false;
+    }
+
+    return true;
+}
+
+bool PkgWriter::VerifyIndexFile()
+{
+    const fs::path indexPath = this->m_OutDir / INDEX_FILENAME;
+    const std::string szIndexPath = indexPath.generic_string();
+
+    auto [bIndexRead, vIndexData] = ReadFileToBuffer( indexPath );
+
+    if ( bIndexRead == false )
+    {
+        this->m_szLastError = "Could not read back " + szIndexPath;
+        return false;
+    }
+
+    try
+    {
+        DynamicIndexFileFactory factory( indexPath, vIndexData );
+        uc2::PkgIndex::ptr_t pIndex = factory.GetPkgIndexOwnership();
+
+        if ( DynamicIndexFileFactory::GetPkgFilenames( pIndex.get() ) !=
+             this->m_Layout.GetIndexPkgFilenames() )
+        {
+            this->m_szLastError =
+                "libuncso2 read the wrong packages from " + szIndexPath;
+            return false;
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        this->m_szLastError =
+            "libuncso2 could not read " + szIndexPath + ": " + e.what();
+        return false;
+    }
+
+    return true;
+}
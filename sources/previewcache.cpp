@@ -0,0 +1,141 @@
+#include "previewcache.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+
+#include <gsl/gsl>
+
+PreviewCache::PreviewCache(
+    fs::path rootDir,
+    std::uint64_t iMaxBytes /*= DEFAULT_MAX_BYTES*/ )
+    : m_RootDir( std::move( rootDir ) ), m_iCachedBytes( 0 ),
+      m_iMaxBytes( iMaxBytes )
+{
+}
+
+fs::path PreviewCache::Find( const std::string& szKey )
+{
+    auto it = this->m_PreviewsByKey.find( szKey );
+
+    if ( it == this->m_PreviewsByKey.end() )
+    {
+        return {};
+    }
+
+    auto previewIt = it->second;
+
+    // the user may have deleted it from the temporary directory
+    std::error_code errorCode;
+
+    if ( fs::exists( previewIt->filePath, errorCode ) == false )
+    {
+        this->Remove( szKey );
+        return {};
+    }
+
+    this->m_Previews.splice( this->m_Previews.begin(), this->m_Previews,
+                             previewIt );
+    return previewIt->filePath;
+}
+
+fs::path PreviewCache::GetPreviewDir( const std::string& szKey ) const
+{
+    return this->m_RootDir / szKey;
+}
+
+void PreviewCache::Insert( const std::string& szKey,
+                           const fs::path& filePath )
+{
+    std::error_code errorCode;
+    const std::uint64_t iFileSize = fs::file_size( filePath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return;
+    }
+
+    auto it = this->m_PreviewsByKey.find( szKey );
+
+    if ( it != this->m_PreviewsByKey.end() )
+    {
+        // extracted again to the same place, only the record gets replaced
+        this->m_iCachedBytes -= it->second->iSize;
+        this->m_Previews.erase( it->second );
+        this->m_PreviewsByKey.erase( it );
+    }
+
+    this->m_Previews.push_front( { szKey, filePath, iFileSize } );
+    this->m_PreviewsByKey[szKey] = this->m_Previews.begin();
+    this->m_iCachedBytes += iFileSize;
+
+    this->Evict();
+}
+
+bool PreviewCache::MakeKey( const fs::path& pkgPath,
+                            std::string_view entryPath, bool bDecrypt,
+                            bool bDecompress, std::string& outKey )
+{
+    std::error_code errorCode;
+
+    const std::uint64_t iPkgSize = fs::file_size( pkgPath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    const auto pkgModifiedTime = fs::last_write_time( pkgPath, errorCode );
+
+    if ( errorCode.value() != 0 )
+    {
+        return false;
+    }
+
+    const std::int64_t iPkgModifiedTime =
+        pkgModifiedTime.time_since_epoch().count();
+    const std::string szPkgPath = pkgPath.generic_string();
+    const char options[2] = { static_cast<char>( bDecrypt ),
+                              static_cast<char>( bDecompress ) };
+
+    QCryptographicHash hash( QCryptographicHash::Md5 );
+    hash.addData( szPkgPath.data(), gsl::narrow<int>( szPkgPath.size() ) );
+    hash.addData( reinterpret_cast<const char*>( &iPkgSize ),
+                  sizeof( iPkgSize ) );
+    hash.addData( reinterpret_cast<const char*>( &iPkgModifiedTime ),
+                  sizeof( iPkgModifiedTime ) );
+    hash.addData( entryPath.data(), gsl::narrow<int>( entryPath.size() ) );
+    hash.addData( options, sizeof( options ) );
+
+    outKey = hash.result().toHex().toStdString();
+    return true;
+}
+
+void PreviewCache::Remove( const std::string& szKey )
+{
+    auto it = this->m_PreviewsByKey.find( szKey );
+
+    if ( it == this->m_PreviewsByKey.end() )
+    {
+        return;
+    }
+
+    this->m_iCachedBytes -= it->second->iSize;
+    this->m_Previews.erase( it->second );
+    this->m_PreviewsByKey.erase( it );
+
+    // it may still be open in a viewer, the error is not worth reporting
+    std::error_code errorCode;
+    fs::remove_all( this->GetPreviewDir( szKey ), errorCode );
+}
+
+void PreviewCache::Evict()
+{
+    // the newest preview is kept even if it's bigger than the limit
+    while ( this->m_iCachedBytes > this->m_iMaxBytes &&
+            this->m_Previews.size() > 1 )
+    {
+        const std::string szOldestKey = this->m_Previews.back().szKey;
+        qDebug() << "Evicting preview" << szOldestKey.c_str();
+        this->Remove( szOldestKey );
+    }
+}
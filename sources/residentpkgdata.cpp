@@ -0,0 +1,83 @@
+#include "residentpkgdata.hpp"
+
+#include <iterator>
+
+ResidentPkgData::ResidentPkgData(
+    std::uint64_t iMaxBytes /*= DEFAULT_MAX_BYTES*/ )
+    : m_iResidentBytes( 0 ), m_iMaxBytes( iMaxBytes )
+{
+}
+
+ResidentPkgData::data_t ResidentPkgData::Find( PkgFileId pkgId,
+                                               const PkgFileStamp& stamp )
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    auto it = this->m_PkgFilesById.find( pkgId );
+
+    if ( it == this->m_PkgFilesById.end() )
+    {
+        return nullptr;
+    }
+
+    // the package was patched since, its data is of no use anymore
+    if ( ( it->second->stamp == stamp ) == false )
+    {
+        this->Erase( it->second );
+        return nullptr;
+    }
+
+    this->m_PkgFiles.splice( this->m_PkgFiles.begin(), this->m_PkgFiles,
+                             it->second );
+    return it->second->pData;
+}
+
+void ResidentPkgData::Insert( PkgFileId pkgId, const PkgFileStamp& stamp,
+                              data_t pData )
+{
+    // bigger than the whole cache, it would only evict everything else
+    if ( pData->size() > this->m_iMaxBytes )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    auto it = this->m_PkgFilesById.find( pkgId );
+
+    if ( it != this->m_PkgFilesById.end() )
+    {
+        // loaded by two extractions at once
+        this->Erase( it->second );
+    }
+
+    this->m_iResidentBytes += pData->size();
+    this->m_PkgFiles.push_front( { pkgId, stamp, std::move( pData ) } );
+    this->m_PkgFilesById[pkgId] = this->m_PkgFiles.begin();
+
+    this->Evict();
+}
+
+void ResidentPkgData::Clear() noexcept
+{
+    std::lock_guard<std::mutex> lock( this->m_Lock );
+
+    this->m_PkgFiles.clear();
+    this->m_PkgFilesById.clear();
+    this->m_iResidentBytes = 0;
+}
+
+void ResidentPkgData::Evict()
+{
+    while ( this->m_iResidentBytes > this->m_iMaxBytes )
+    {
+        this->Erase( std::prev( this->m_PkgFiles.end() ) );
+    }
+}
+
+void ResidentPkgData::Erase( std::list<ResidentPkgFile>::iterator it )
+{
+    this->m_iResidentBytes -= it->pData->size();
+    this->m_PkgFilesById.erase( it->pkgId );
+    this->m_PkgFiles.erase( it );
+}
@@ -5,29 +5,46 @@
 #include <uc2/encryptedfile.hpp>
 #include <uc2/lzmatexture.hpp>
 
-#include <QDebug>
-
+#include "corelog.hpp"
 #include "indexkeycollections.hpp"
 #include "miscutils.hpp"
 
 SpecialFileHandler::SpecialFileHandler( gsl::span<std::uint8_t> fileData,
                                         fs::path filePath, bool canDecrypt,
-                                        bool canDecompress )
+                                        bool canDecompress,
+                                        BufferPool& texBufferPool )
     : m_FileData( fileData ), m_FilePath( filePath ),
-      m_bAllowDecryption( canDecrypt ), m_bAllowDecompression( canDecompress )
+      m_TexBufferPool( texBufferPool ), m_bAllowDecryption( canDecrypt ),
+      m_bAllowDecompression( canDecompress )
 {
 }
 
 SpecialFileHandler::~SpecialFileHandler() {}
 
 gsl::span<std::uint8_t> SpecialFileHandler::ProcessData()
+{
+    this->ProcessDecryption();
+    return this->ProcessDecompression();
+}
+
+gsl::span<std::uint8_t> SpecialFileHandler::ProcessDecryption()
 {
     if ( this->m_bAllowDecryption && this->IsFileEncrypted() )
     {
         this->m_FileData = this->DecryptFile();
     }
 
-    if ( this->m_bAllowDecompression && this->IsTextureCompressed() )
+    return this->m_FileData;
+}
+
+bool SpecialFileHandler::ShouldDecompress() const
+{
+    return this->m_bAllowDecompression && this->IsTextureCompressed();
+}
+
+gsl::span<std::uint8_t> SpecialFileHandler::ProcessDecompression()
+{
+    if ( this->ShouldDecompress() )
     {
         this->m_FileData = this->DecompressTexture();
     }
@@ -67,13 +84,13 @@ gsl::span<std::uint8_t> SpecialFileHandler::DecryptFile()
     }
     catch ( const std::exception& e )
     {
-        qDebug() << e.what();
+        LogDebug( e.what() );
     }
 
     return {};
 }
 
-gsl::span<std::uint8_t> SpecialFileHandler::DecompressTexture() const
+gsl::span<std::uint8_t> SpecialFileHandler::DecompressTexture()
 {
     try
     {
@@ -81,20 +98,21 @@ gsl::span<std::uint8_t> SpecialFileHandler::DecompressTexture() const
             this->m_FileData.data(), this->m_FileData.size_bytes() );
 
         uint64_t iNewTexSize = pTexFile->GetOriginalSize();
-        uint8_t* pNewTexBuffer = new uint8_t[iNewTexSize];
+        this->m_TexBuffer = this->m_TexBufferPool.Acquire( iNewTexSize );
 
-        if ( pTexFile->Decompress( pNewTexBuffer, iNewTexSize ) == true )
+        if ( pTexFile->Decompress( this->m_TexBuffer.GetData(),
+                                   iNewTexSize ) == true )
         {
-            return { pNewTexBuffer, iNewTexSize };
+            return this->m_TexBuffer.GetSpan();
         }
         else
         {
-            delete[] pNewTexBuffer;
+            this->m_TexBuffer.Reset();
         }
     }
     catch ( const std::exception& e )
     {
-        qDebug() << e.what();
+        LogDebug( e.what() );
     }
 
     return {};
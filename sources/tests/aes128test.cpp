@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aes128.hpp"
+#include "tests/testcheck.hpp"
+
+static std::vector<uint8_t> FromHex( std::string_view hex )
+{
+    std::vector<uint8_t> vBytes;
+
+    for ( std::size_t i = 0; i + 1 < hex.size(); i += 2 )
+    {
+        const std::string szByte( hex.substr( i, 2 ) );
+        vBytes.push_back(
+            static_cast<uint8_t>( std::stoul( szByte, nullptr, 16 ) ) );
+    }
+
+    return vBytes;
+}
+
+static Aes128Key KeyFromHex( std::string_view hex )
+{
+    const std::vector<uint8_t> vBytes = FromHex( hex );
+
+    Aes128Key key = {};
+    std::copy( vBytes.begin(), vBytes.end(), key.begin() );
+    return key;
+}
+
+// FIPS-197's appendix B and C.1 examples
+static void TestBlock()
+{
+    {
+        const Aes128 aes( KeyFromHex( "2b7e151628aed2a6abf7158809cf4f3c" ) );
+        std::vector<uint8_t> vBlock =
+            FromHex( "3243f6a8885a308d313198a2e0370734" );
+
+        aes.EncryptBlock( vBlock.data() );
+        UC2_CHECK( vBlock == FromHex( "3925841d02dc09fbdc118597196a0b32" ) );
+    }
+
+    {
+        const Aes128 aes( KeyFromHex( "000102030405060708090a0b0c0d0e0f" ) );
+        std::vector<uint8_t> vBlock =
+            FromHex( "00112233445566778899aabbccddeeff" );
+
+        aes.EncryptBlock( vBlock.data() );
+        UC2_CHECK( vBlock == FromHex( "69c4e0d86a7b0430d8cdb78070b4c55a" ) );
+    }
+}
+
+// SP 800-38A's F.2.1 CBC-AES128 example, its first two blocks
+static void TestCbc()
+{
+    const Aes128 aes( KeyFromHex( "2b7e151628aed2a6abf7158809cf4f3c" ) );
+    const Aes128Key iv = KeyFromHex( "000102030405060708090a0b0c0d0e0f" );
+
+    std::vector<uint8_t> vData =
+        FromHex( "6bc1bee22e409f96e93d7e117393172a"
+                 "ae2d8a571e03ac9c9eb76fac45af8e51" );
+
+    aes.EncryptCbc( vData, iv );
+    UC2_CHECK( vData == FromHex( "7649abac8119b246cee98e9b12e9197d"
+                                 "5086cb9b507219ee95db113a917678b2" ) );
+}
+
+static void TestPaddedSize()
+{
+    UC2_CHECK( Aes128::GetPaddedSize( 0 ) == 0 );
+    UC2_CHECK( Aes128::GetPaddedSize( 1 ) == 16 );
+    UC2_CHECK( Aes128::GetPaddedSize( 16 ) == 16 );
+    UC2_CHECK( Aes128::GetPaddedSize( 17 ) == 32 );
+}
+
+int main()
+{
+    TestBlock();
+    TestCbc();
+    TestPaddedSize();
+
+    return GetTestResult();
+}
@@ -0,0 +1,92 @@
+#include <cstdint>
+#include <utility>
+
+#include "bufferpool.hpp"
+#include "tests/testcheck.hpp"
+
+constexpr const std::uint64_t KIB = 1024;
+
+static void TestSameClassIsReused()
+{
+    BufferPool pool;
+
+    BufferPool::Buffer buffer = pool.Acquire( 100 * KIB );
+    UC2_CHECK( buffer.IsValid() == true );
+    UC2_CHECK( buffer.GetSize() == 100 * KIB );
+
+    const std::uint8_t* pData = buffer.GetData();
+    buffer.Reset();
+    UC2_CHECK( buffer.IsValid() == false );
+
+    // both fit in the 128 KiB class
+    BufferPool::Buffer sameClassBuffer = pool.Acquire( 128 * KIB );
+    UC2_CHECK( sameClassBuffer.GetData() == pData );
+    UC2_CHECK( sameClassBuffer.GetSize() == 128 * KIB );
+}
+
+static void TestOtherClassIsNotReused()
+{
+    BufferPool pool;
+
+    BufferPool::Buffer buffer = pool.Acquire( 100 * KIB );
+    const std::uint8_t* pData = buffer.GetData();
+    buffer.Reset();
+
+    // the released buffer is still held by the pool, so it can't be handed
+    // out again without being reused
+    BufferPool::Buffer smallerBuffer = pool.Acquire( 10 * KIB );
+    BufferPool::Buffer biggerBuffer = pool.Acquire( 200 * KIB );
+    UC2_CHECK( smallerBuffer.GetData() != pData );
+    UC2_CHECK( biggerBuffer.GetData() != pData );
+
+    BufferPool::Buffer sameClassBuffer = pool.Acquire( 100 * KIB );
+    UC2_CHECK( sameClassBuffer.GetData() == pData );
+}
+
+static void TestRetentionLimit()
+{
+    // room for a single buffer of the smallest class
+    BufferPool pool( 64 * KIB );
+
+    BufferPool::Buffer firstBuffer = pool.Acquire( 64 * KIB );
+    BufferPool::Buffer secondBuffer = pool.Acquire( 64 * KIB );
+    const std::uint8_t* pFirstData = firstBuffer.GetData();
+
+    firstBuffer.Reset();
+    // freed, the pool is full
+    secondBuffer.Reset();
+
+    // the last released buffer would be handed out first if it was kept
+    BufferPool::Buffer buffer = pool.Acquire( 64 * KIB );
+    UC2_CHECK( buffer.GetData() == pFirstData );
+}
+
+static void TestMovedBufferIsReleasedOnce()
+{
+    BufferPool pool;
+
+    BufferPool::Buffer buffer = pool.Acquire( 64 * KIB );
+    const std::uint8_t* pData = buffer.GetData();
+
+    BufferPool::Buffer movedBuffer = std::move( buffer );
+    UC2_CHECK( movedBuffer.GetData() == pData );
+    UC2_CHECK( buffer.IsValid() == false );
+
+    buffer.Reset();
+    movedBuffer.Reset();
+
+    BufferPool::Buffer firstBuffer = pool.Acquire( 64 * KIB );
+    BufferPool::Buffer secondBuffer = pool.Acquire( 64 * KIB );
+    UC2_CHECK( firstBuffer.GetData() == pData );
+    UC2_CHECK( secondBuffer.GetData() != pData );
+}
+
+int main()
+{
+    TestSameClassIsReused();
+    TestOtherClassIsNotReused();
+    TestRetentionLimit();
+    TestMovedBufferIsReleasedOnce();
+
+    return GetTestResult();
+}
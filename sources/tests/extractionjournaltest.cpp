@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "extractionjournal.hpp"
+#include "fsutils.hpp"
+#include "tests/testcheck.hpp"
+
+// where ExtractionJournal keeps itself in the output directory
+constexpr const char JOURNAL_FILENAME[] = ".uncso2journal";
+
+constexpr const char TEST_PKG_FILENAME[] = "test.pkg";
+
+static PkgFileStamp GetTestStamp()
+{
+    PkgFileStamp stamp{};
+    stamp.iFileSize = 1234;
+    stamp.iModifiedTime = 5678;
+    stamp.baseHeaderMd5[0] = 0xAB;
+    return stamp;
+}
+
+static ExtractionJournal::JournaledFile GetTestFile( const std::string& szName )
+{
+    ExtractionJournal::JournaledFile file;
+    file.szTargetPath = "/data/" + szName;
+    file.source.szPkgFilename = TEST_PKG_FILENAME;
+    file.source.pkgStamp = GetTestStamp();
+    file.source.szEntryPath = file.szTargetPath;
+    file.source.iEntryBytes = 42;
+    file.source.iOptions = EO_Decrypt;
+    file.szResultPath = "data/" + szName;
+    return file;
+}
+
+static bool IsJournaled( ExtractionJournal& journal,
+                         const ExtractionJournal::JournaledFile& file )
+{
+    std::string szResultPath;
+    return journal.IsFileDone( file.szTargetPath, file.source,
+                               szResultPath ) == true &&
+           szResultPath == file.szResultPath;
+}
+
+// a crash while a record was being written leaves a part of it behind
+static void TestTornTailIsDropped()
+{
+    TestDirectory testDir( "journal-torn" );
+    const fs::path journalPath = testDir.GetPath() / JOURNAL_FILENAME;
+
+    const auto firstFile = GetTestFile( "first.txt" );
+    const auto tornFile = GetTestFile( "torn.txt" );
+    const auto laterFile = GetTestFile( "later.txt" );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        journal.AddFile( firstFile );
+        journal.AddPkgFile( TEST_PKG_FILENAME, GetTestStamp(), EO_Decrypt );
+        journal.AddFile( tornFile );
+    }
+
+    std::error_code errorCode;
+    const uintmax_t iJournalSize = fs::file_size( journalPath, errorCode );
+    UC2_CHECK( errorCode.value() == 0 );
+
+    fs::resize_file( journalPath, iJournalSize - 3, errorCode );
+    UC2_CHECK( errorCode.value() == 0 );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        UC2_CHECK( IsJournaled( journal, firstFile ) == true );
+        UC2_CHECK( journal.IsPkgFileDone( TEST_PKG_FILENAME, GetTestStamp(),
+                                          EO_Decrypt ) == true );
+        UC2_CHECK( IsJournaled( journal, tornFile ) == false );
+
+        journal.AddFile( laterFile );
+    }
+
+    // the new record went where the torn one was, not after it
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+
+    UC2_CHECK( IsJournaled( journal, firstFile ) == true );
+    UC2_CHECK( IsJournaled( journal, tornFile ) == false );
+    UC2_CHECK( IsJournaled( journal, laterFile ) == true );
+}
+
+// a damaged record can't be trusted, nor anything written after it
+static void TestCorruptRecordDropsTheRest()
+{
+    TestDirectory testDir( "journal-corrupt" );
+    const fs::path journalPath = testDir.GetPath() / JOURNAL_FILENAME;
+
+    const auto firstFile = GetTestFile( "first.txt" );
+    const auto secondFile = GetTestFile( "second.txt" );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        journal.AddFile( firstFile );
+        journal.AddFile( secondFile );
+    }
+
+    auto [bJournalRead, vJournalData] = ReadFileToBuffer( journalPath );
+    UC2_CHECK( bJournalRead == true );
+
+    // in the first record's payload, past the journal's magic and version,
+    // the record's size and checksum, and its type
+    constexpr const std::size_t CORRUPT_BYTE_OFFSET = 12 + 8 + 1;
+    UC2_CHECK( vJournalData.size() > CORRUPT_BYTE_OFFSET );
+
+    vJournalData[CORRUPT_BYTE_OFFSET] ^= 0xFF;
+    UC2_CHECK( WriteBufferToFile( journalPath, vJournalData ) == true );
+
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+
+    UC2_CHECK( IsJournaled( journal, firstFile ) == false );
+    UC2_CHECK( IsJournaled( journal, secondFile ) == false );
+}
+
+static void TestFilesNeedTheSameSource()
+{
+    TestDirectory testDir( "journal-source" );
+
+    auto file = GetTestFile( "file.txt" );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        journal.AddFile( file );
+        journal.AddPkgFile( TEST_PKG_FILENAME, GetTestStamp(), EO_Decrypt );
+    }
+
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+
+    UC2_CHECK( journal.IsPkgFileDone( TEST_PKG_FILENAME, GetTestStamp(),
+                                      EO_Decrypt | EO_Decompress ) == false );
+    UC2_CHECK( journal.GetPkgFileFiles( TEST_PKG_FILENAME ).size() == 1 );
+
+    // the package was patched since
+    file.source.pkgStamp.iModifiedTime++;
+    UC2_CHECK( IsJournaled( journal, file ) == false );
+}
+
+static void TestFailedPkgFiles()
+{
+    TestDirectory testDir( "journal-failed" );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        journal.AddFailedPkgFile( TEST_PKG_FILENAME, "corrupt header" );
+    }
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        const auto failedPkgFiles = journal.GetFailedPkgFiles();
+        UC2_CHECK( failedPkgFiles.size() == 1 );
+        UC2_CHECK( failedPkgFiles.count( TEST_PKG_FILENAME ) == 1 &&
+                   failedPkgFiles.at( TEST_PKG_FILENAME ) ==
+                       "corrupt header" );
+
+        // a later extraction got through it
+        journal.AddPkgFile( TEST_PKG_FILENAME, GetTestStamp(), EO_Decrypt );
+    }
+
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+
+    UC2_CHECK( journal.GetFailedPkgFiles().empty() == true );
+    UC2_CHECK( journal.IsPkgFileDone( TEST_PKG_FILENAME, GetTestStamp(),
+                                      EO_Decrypt ) == true );
+}
+
+// the same journal opened again only knows of what's in its file
+static void TestReopen()
+{
+    TestDirectory testDir( "journal-reopen" );
+    const auto file = GetTestFile( "file.txt" );
+
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+
+    journal.AddFailedPkgFile( TEST_PKG_FILENAME, "corrupt header" );
+    // not written out yet
+    journal.AddFile( file );
+
+    UC2_CHECK( journal.Open() == true );
+    UC2_CHECK( journal.GetFailedPkgFiles().size() == 1 );
+    UC2_CHECK( IsJournaled( journal, file ) == true );
+
+    std::error_code errorCode;
+    fs::remove( testDir.GetPath() / JOURNAL_FILENAME, errorCode );
+    UC2_CHECK( errorCode.value() == 0 );
+
+    UC2_CHECK( journal.Open() == true );
+    UC2_CHECK( journal.GetFailedPkgFiles().empty() == true );
+    UC2_CHECK( IsJournaled( journal, file ) == false );
+}
+
+static void TestRemove()
+{
+    TestDirectory testDir( "journal-remove" );
+    const auto file = GetTestFile( "file.txt" );
+
+    {
+        ExtractionJournal journal( testDir.GetPath() );
+        UC2_CHECK( journal.Open() == true );
+
+        journal.AddFile( file );
+        journal.Flush();
+        journal.Remove();
+    }
+
+    std::error_code errorCode;
+    UC2_CHECK( fs::exists( testDir.GetPath() / JOURNAL_FILENAME,
+                           errorCode ) == false );
+
+    ExtractionJournal journal( testDir.GetPath() );
+    UC2_CHECK( journal.Open() == true );
+    UC2_CHECK( IsJournaled( journal, file ) == false );
+}
+
+int main()
+{
+    TestTornTailIsDropped();
+    TestCorruptRecordDropsTheRest();
+    TestFilesNeedTheSameSource();
+    TestFailedPkgFiles();
+    TestReopen();
+    TestRemove();
+
+    return GetTestResult();
+}
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fsutils.hpp"
+#include "tests/testcheck.hpp"
+
+static std::vector<uint8_t> GetBuffer( std::string_view content )
+{
+    return std::vector<uint8_t>( content.begin(), content.end() );
+}
+
+static std::string ReadFileContent( const fs::path& filePath )
+{
+    auto [bRead, vData] = ReadFileToBuffer( filePath );
+    UC2_CHECK( bRead == true );
+    return std::string( vData.begin(), vData.end() );
+}
+
+static void TestReplaceFile()
+{
+    TestDirectory testDir( "fsutils-replace" );
+    const fs::path filePath = testDir.GetPath() / "file.bin";
+    const fs::path tempFilePath = testDir.GetPath() / "file.bin.tmp";
+
+    auto vOldData = GetBuffer( "the old and longer content" );
+    auto vNewData = GetBuffer( "new content" );
+
+    // there's nothing to replace yet
+    UC2_CHECK( ReplaceFileWithBuffer( filePath, vOldData ) == true );
+    UC2_CHECK( ReadFileContent( filePath ) == "the old and longer content" );
+
+    UC2_CHECK( ReplaceFileWithBuffer( filePath, vNewData ) == true );
+    UC2_CHECK( ReadFileContent( filePath ) == "new content" );
+
+    std::error_code errorCode;
+    UC2_CHECK( fs::exists( tempFilePath, errorCode ) == false );
+}
+
+static void TestReplaceFileFailure()
+{
+    TestDirectory testDir( "fsutils-replace-fail" );
+    auto vData = GetBuffer( "content" );
+
+    UC2_CHECK( ReplaceFileWithBuffer( testDir.GetPath() / "missing" /
+                                          "file.bin",
+                                      vData ) == false );
+
+    // a directory that isn't empty can't be renamed over
+    const fs::path dirPath = testDir.GetPath() / "dir";
+    UC2_CHECK( CreateDirIfUnexisting( dirPath / "child" ) == true );
+    UC2_CHECK( ReplaceFileWithBuffer( dirPath, vData ) == false );
+
+    std::error_code errorCode;
+    UC2_CHECK( fs::is_directory( dirPath / "child", errorCode ) == true );
+    UC2_CHECK( fs::exists( testDir.GetPath() / "dir.tmp", errorCode ) ==
+               false );
+}
+
+static void TestReadFile()
+{
+    TestDirectory testDir( "fsutils-read" );
+    const fs::path filePath = testDir.GetPath() / "file.bin";
+
+    auto vData = GetBuffer( "0123456789" );
+    UC2_CHECK( WriteBufferToFile( filePath, vData ) == true );
+
+    {
+        auto [bRead, vReadData] = ReadFileToBuffer( filePath, 4 );
+        UC2_CHECK( bRead == true );
+        UC2_CHECK( std::string( vReadData.begin(), vReadData.end() ) ==
+                   "0123" );
+    }
+
+    {
+        auto [bRead, vReadData] = ReadFileToBuffer( filePath, 11 );
+        UC2_CHECK( bRead == false );
+        UC2_CHECK( vReadData.empty() == true );
+    }
+
+    {
+        auto [bRead, vReadData] =
+            ReadFileToBuffer( testDir.GetPath() / "missing.bin" );
+        UC2_CHECK( bRead == false );
+    }
+
+    // not a regular file
+    {
+        auto [bRead, vReadData] = ReadFileToBuffer( testDir.GetPath() );
+        UC2_CHECK( bRead == false );
+    }
+}
+
+int main()
+{
+    TestReplaceFile();
+    TestReplaceFileFailure();
+    TestReadFile();
+
+    return GetTestResult();
+}
@@ -0,0 +1,155 @@
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "archivetree.hpp"
+#include "cancellationtoken.hpp"
+#include "fsutils.hpp"
+#include "indexdelta.hpp"
+#include "nodeextractionmgr.hpp"
+#include "pkglayout.hpp"
+#include "pkgwriter.hpp"
+#include "tests/testcheck.hpp"
+
+static bool WriteTreeFile( const fs::path& treeDir, std::string_view name,
+                           std::string_view content )
+{
+    std::vector<uint8_t> vData( content.begin(), content.end() );
+    return WriteBufferToFile( treeDir / name, vData );
+}
+
+static bool WriteArchive( const fs::path& treeDir, const fs::path& outDir )
+{
+    PkgLayout layout( GameProvider::Nexon );
+
+    if ( layout.AddDirectory( treeDir ) == false )
+    {
+        std::cerr << layout.GetError() << '\n';
+        return false;
+    }
+
+    PkgWriter writer( layout, outDir );
+
+    if ( writer.Write() == false )
+    {
+        std::cerr << writer.GetError() << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+static void TestDelta()
+{
+    TestDirectory testDir( "index-delta" );
+
+    const fs::path baseTreeDir = testDir.GetPath() / "basetree";
+    const fs::path newTreeDir = testDir.GetPath() / "newtree";
+    const fs::path baseArchiveDir = testDir.GetPath() / "base";
+    const fs::path newArchiveDir = testDir.GetPath() / "new";
+    const fs::path outDir = testDir.GetPath() / "out";
+
+    UC2_CHECK( CreateDirIfUnexisting( baseTreeDir ) == true );
+    UC2_CHECK( CreateDirIfUnexisting( newTreeDir ) == true );
+    UC2_CHECK( CreateDirIfUnexisting( outDir ) == true );
+
+    UC2_CHECK( WriteTreeFile( baseTreeDir, "same.bin", "unchanged" ) == true );
+    UC2_CHECK( WriteTreeFile( baseTreeDir, "patched.bin", "version 1" ) ==
+               true );
+    UC2_CHECK( WriteTreeFile( baseTreeDir, "grown.bin", "short" ) == true );
+    UC2_CHECK( WriteTreeFile( baseTreeDir, "removed.bin", "gone" ) == true );
+
+    UC2_CHECK( WriteTreeFile( newTreeDir, "same.bin", "unchanged" ) == true );
+    // only their digests tell these apart
+    UC2_CHECK( WriteTreeFile( newTreeDir, "patched.bin", "version 2" ) ==
+               true );
+    UC2_CHECK( WriteTreeFile( newTreeDir, "grown.bin", "a lot longer" ) ==
+               true );
+    UC2_CHECK( WriteTreeFile( newTreeDir, "added.bin", "new" ) == true );
+
+    UC2_CHECK( WriteArchive( baseTreeDir, baseArchiveDir ) == true );
+    UC2_CHECK( WriteArchive( newTreeDir, newArchiveDir ) == true );
+
+    ArchiveTree tree;
+    std::atomic<int> iLoadProgress = 0;
+    std::atomic<int> iPkgNum = 0;
+    CancellationToken cancelToken;
+
+    const bool bIndexLoaded = tree.LoadIndex(
+        newArchiveDir / INDEX_FILENAME, GameProvider::Nexon, fs::path(),
+        iLoadProgress, iPkgNum, cancelToken );
+    UC2_CHECK( bIndexLoaded == true );
+
+    if ( bIndexLoaded == false )
+    {
+        std::cerr << tree.GetError() << '\n';
+        return;
+    }
+
+    std::vector<ArchiveBaseNode*> vNodes = { tree.GetRootNode() };
+    auto snapshot = NodeExtractionMgr::TakeSnapshot(
+        vNodes, tree.GetLoadedPkgFiles().GetCount() );
+    UC2_CHECK( snapshot.iFilesNum == 4 );
+
+    IndexDelta delta( tree.GetLoadedPkgFiles(), cancelToken );
+    UC2_CHECK( delta.Compute( baseArchiveDir / INDEX_FILENAME,
+                              GameProvider::Nexon, snapshot,
+                              tree.GetParentPath() ) == true );
+
+    UC2_CHECK( delta.GetAddedNum() == 1 );
+    UC2_CHECK( delta.GetChangedNum() == 2 );
+    UC2_CHECK( delta.GetUnchangedNum() == 1 );
+
+    const std::vector<std::string> vExpectedRemoved = { "removed.bin" };
+    UC2_CHECK( delta.GetRemovedPaths() == vExpectedRemoved );
+
+    // the unchanged file was left out
+    UC2_CHECK( snapshot.iFilesNum == 3 );
+
+    UC2_CHECK( delta.WriteRemovedList( outDir ) == true );
+
+    auto [bListRead, vListData] =
+        ReadFileToBuffer( outDir / "removed_files.txt" );
+    UC2_CHECK( bListRead == true );
+    UC2_CHECK( std::string( vListData.begin(), vListData.end() ) ==
+               "removed.bin\n" );
+}
+
+// doesn't need PkgWriter, a base index that can't be loaded is reported
+// and nothing is left out of the snapshot
+static void TestUnloadableBaseIndex()
+{
+    TestDirectory testDir( "index-delta-unloadable" );
+    const fs::path notIndexPath = testDir.GetPath() / INDEX_FILENAME;
+
+    UC2_CHECK( WriteTreeFile( testDir.GetPath(), INDEX_FILENAME,
+                              "not an index" ) == true );
+
+    LoadedPkgFiles pkgFiles;
+    CancellationToken cancelToken;
+    IndexDelta delta( pkgFiles, cancelToken );
+
+    NodeExtractionMgr::Snapshot snapshot;
+
+    UC2_CHECK( delta.Compute( testDir.GetPath() / "missing" / INDEX_FILENAME,
+                              GameProvider::Nexon, snapshot,
+                              testDir.GetPath() ) == false );
+    UC2_CHECK( delta.Compute( notIndexPath, GameProvider::Nexon, snapshot,
+                              testDir.GetPath() ) == false );
+
+    UC2_CHECK( delta.GetRemovedPaths().empty() == true );
+    UC2_CHECK( delta.GetAddedNum() == 0 );
+    UC2_CHECK( delta.GetChangedNum() == 0 );
+    UC2_CHECK( delta.GetUnchangedNum() == 0 );
+    UC2_CHECK( snapshot.iFilesNum == 0 );
+}
+
+int main()
+{
+    TestUnloadableBaseIndex();
+    TestDelta();
+    return GetTestResult();
+}
@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <vector>
+
+#include "nodeextractionmgr.hpp"
+#include "tests/testcheck.hpp"
+
+constexpr const uint64_t KIB = 1024;
+constexpr const uint64_t MIB = 1024 * KIB;
+
+static std::vector<std::size_t> SplitEntries(
+    const std::vector<uint64_t>& vEntrySizes )
+{
+    return NodeExtractionMgr::SplitIntoBatches(
+        vEntrySizes.size(),
+        [&vEntrySizes]( std::size_t i ) { return vEntrySizes[i]; } );
+}
+
+static void TestNoEntries()
+{
+    UC2_CHECK( SplitEntries( {} ).empty() == true );
+}
+
+// small entries are batched by their count
+static void TestSmallEntries()
+{
+    const std::vector<uint64_t> vEntrySizes( 300, 1 );
+    const std::vector<std::size_t> vExpected = { 128, 256, 300 };
+
+    UC2_CHECK( SplitEntries( vEntrySizes ) == vExpected );
+}
+
+// and the bigger ones by their size
+static void TestBatchesBySize()
+{
+    {
+        const std::vector<std::size_t> vExpected = { 2 };
+        UC2_CHECK( SplitEntries( { 512 * KIB, 512 * KIB } ) == vExpected );
+    }
+
+    {
+        const std::vector<std::size_t> vExpected = { 1, 2, 3 };
+        UC2_CHECK( SplitEntries( { 600 * KIB, 600 * KIB, 600 * KIB } ) ==
+                   vExpected );
+    }
+}
+
+static void TestBigEntryIsAlone()
+{
+    const std::vector<std::size_t> vExpected = { 1, 2, 3 };
+    UC2_CHECK( SplitEntries( { 10, 5 * MIB, 10 } ) == vExpected );
+}
+
+int main()
+{
+    TestNoEntries();
+    TestSmallEntries();
+    TestBatchesBySize();
+    TestBigEntryIsAlone();
+
+    return GetTestResult();
+}
@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fsutils.hpp"
+#include "pkglayout.hpp"
+#include "tests/testcheck.hpp"
+
+static bool WriteTreeFile( const fs::path& filePath, std::size_t iSize )
+{
+    std::vector<uint8_t> vData( iSize, 0x55 );
+    return CreateDirIfUnexisting( filePath.parent_path() ) == true &&
+           WriteBufferToFile( filePath, vData ) == true;
+}
+
+static bool IsPkgFilename( std::string_view filename )
+{
+    constexpr const std::string_view PKG_EXTENSION = ".pkg";
+    constexpr const std::size_t HEX_DIGITS_NUM = 32;
+
+    if ( filename.size() != HEX_DIGITS_NUM + PKG_EXTENSION.size() ||
+         filename.substr( HEX_DIGITS_NUM ) != PKG_EXTENSION )
+    {
+        return false;
+    }
+
+    return filename.substr( 0, HEX_DIGITS_NUM ).find_first_not_of(
+               "0123456789abcdef" ) == std::string_view::npos;
+}
+
+static void TestSplitBySize()
+{
+    TestDirectory testDir( "layout-split" );
+    const fs::path treeDir = testDir.GetPath();
+
+    UC2_CHECK( WriteTreeFile( treeDir / "b" / "second.bin", 40 ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "a" / "first.bin", 40 ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "c" / "big.bin", 250 ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "d" / "last.bin", 10 ) == true );
+
+    PkgLayout layout( GameProvider::Nexon, 100 );
+    UC2_CHECK( layout.AddDirectory( treeDir ) == true );
+
+    const auto& vPkgFiles = layout.GetPkgFiles();
+    UC2_CHECK( vPkgFiles.size() == 3 );
+
+    if ( vPkgFiles.size() != 3 )
+    {
+        return;
+    }
+
+    // the entries are sorted by their path
+    UC2_CHECK( vPkgFiles[0].vEntries.size() == 2 );
+    UC2_CHECK( vPkgFiles[0].vEntries[0].szEntryPath == "/a/first.bin" );
+    UC2_CHECK( vPkgFiles[0].vEntries[1].szEntryPath == "/b/second.bin" );
+    UC2_CHECK( vPkgFiles[0].iTotalBytes == 80 );
+
+    // bigger than the maximum, so it's alone
+    UC2_CHECK( vPkgFiles[1].vEntries.size() == 1 );
+    UC2_CHECK( vPkgFiles[1].vEntries[0].szEntryPath == "/c/big.bin" );
+    UC2_CHECK( vPkgFiles[1].iTotalBytes == 250 );
+
+    UC2_CHECK( vPkgFiles[2].vEntries.size() == 1 );
+    UC2_CHECK( vPkgFiles[2].vEntries[0].szEntryPath == "/d/last.bin" );
+
+    const std::vector<std::string_view> vIndexFilenames =
+        layout.GetIndexPkgFilenames();
+    UC2_CHECK( vIndexFilenames.size() == vPkgFiles.size() );
+
+    for ( std::size_t i = 0; i < vPkgFiles.size(); i++ )
+    {
+        UC2_CHECK( IsPkgFilename( vPkgFiles[i].szFilename ) == true );
+        UC2_CHECK( vIndexFilenames[i] == vPkgFiles[i].szFilename );
+    }
+
+    UC2_CHECK( vPkgFiles[0].szFilename != vPkgFiles[1].szFilename );
+}
+
+// the same tree always gets the same package names
+static void TestSameLayout()
+{
+    TestDirectory testDir( "layout-same" );
+    UC2_CHECK( WriteTreeFile( testDir.GetPath() / "file.bin", 16 ) == true );
+
+    PkgLayout firstLayout( GameProvider::Tfo );
+    PkgLayout secondLayout( GameProvider::Tfo );
+    UC2_CHECK( firstLayout.AddDirectory( testDir.GetPath() ) == true );
+    UC2_CHECK( secondLayout.AddDirectory( testDir.GetPath() ) == true );
+
+    UC2_CHECK( firstLayout.IsTfoLayout() == true );
+    UC2_CHECK( firstLayout.GetIndexPkgFilenames() ==
+               secondLayout.GetIndexPkgFilenames() );
+}
+
+static void TestPathTooLong()
+{
+    TestDirectory testDir( "layout-long" );
+
+    // with its slashes, the entry path fills the whole header field. It's
+    // split in two, since file systems limit the names' length too
+    const std::string szDirName( PKG_ENTRY_PATH_MAX_LEN / 2 - 1, 'x' );
+    const std::string szFilename( PKG_ENTRY_PATH_MAX_LEN / 2 - 1, 'y' );
+    UC2_CHECK( WriteTreeFile( testDir.GetPath() / szDirName / szFilename,
+                              1 ) == true );
+
+    PkgLayout layout( GameProvider::Nexon );
+    UC2_CHECK( layout.AddDirectory( testDir.GetPath() ) == false );
+    UC2_CHECK( layout.GetError().empty() == false );
+}
+
+int main()
+{
+    TestSplitBySize();
+    TestSameLayout();
+    TestPathTooLong();
+
+    return GetTestResult();
+}
@@ -0,0 +1,232 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <uc2/encryptedfile.hpp>
+#include <uc2/lzmatexture.hpp>
+#include <uc2/pkgentry.hpp>
+#include <uc2/pkgfile.hpp>
+
+#include "dynindexfilefactory.hpp"
+#include "dynpkgfilefactory.hpp"
+#include "fsutils.hpp"
+#include "indexkeycollections.hpp"
+#include "miscutils.hpp"
+#include "pkglayout.hpp"
+#include "pkgwriter.hpp"
+#include "tests/testcheck.hpp"
+
+static bool WriteTreeFile( const fs::path& filePath, std::string_view content )
+{
+    std::vector<uint8_t> vData( content.begin(), content.end() );
+    return CreateDirIfUnexisting( filePath.parent_path() ) == true &&
+           WriteBufferToFile( filePath, vData ) == true;
+}
+
+static uint64_t GetDirectorySize( const fs::path& dirPath )
+{
+    std::error_code errorCode;
+    uint64_t iDirSize = 0;
+
+    for ( auto&& entry : fs::directory_iterator( dirPath, errorCode ) )
+    {
+        iDirSize += entry.file_size( errorCode );
+    }
+
+    return iDirSize;
+}
+
+// every package and the index are read back through libuncso2 by the
+// writer, so a successful write is one libuncso2 can load
+static void TestWriteProvider( GameProvider provider, std::string_view name )
+{
+    TestDirectory testDir( "pkgwriter-" + std::string( name ) );
+    const fs::path treeDir = testDir.GetPath() / "tree";
+    const fs::path outDir = testDir.GetPath() / "archive";
+
+    UC2_CHECK( WriteTreeFile( treeDir / "data" / "plain.txt",
+                              "some plain text" ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "data" / "secret.etxt",
+                              "some text encrypted on its own" ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "materials" / "texture.vtf",
+                              std::string( 512, 'v' ) ) == true );
+
+    // small enough to get more than a single package
+    PkgLayout layout( provider, 64 );
+    UC2_CHECK( layout.AddDirectory( treeDir ) == true );
+    UC2_CHECK( layout.GetPkgFiles().size() > 1 );
+
+    PkgWriter writer( layout, outDir );
+    const bool bWritten = writer.Write();
+    UC2_CHECK( bWritten == true );
+
+    if ( bWritten == false )
+    {
+        std::cerr << name << ": " << writer.GetError() << '\n';
+        return;
+    }
+
+    std::error_code errorCode;
+    UC2_CHECK( fs::is_regular_file( outDir / INDEX_FILENAME, errorCode ) ==
+               true );
+
+    for ( auto&& pkgFile : layout.GetPkgFiles() )
+    {
+        UC2_CHECK( fs::is_regular_file( outDir / pkgFile.szFilename,
+                                        errorCode ) == true );
+    }
+
+    UC2_CHECK( writer.GetWrittenBytes() == GetDirectorySize( outDir ) );
+}
+
+// undoes what PkgWriter encoded special files with, as extractions do
+static std::vector<uint8_t> DecodeEntryData( const fs::path& entryPath,
+                                             gsl::span<uint8_t> entryData )
+{
+    if ( entryPath.extension() == ".etxt" )
+    {
+        auto pEncFile = uc2::EncryptedFile::Create(
+            entryPath.filename().generic_string(), entryData.data(),
+            entryData.size_bytes(), CS_INDEX_KEY_COLLECTION );
+        auto decrypted = PairToSpan( pEncFile->Decrypt() );
+        return { decrypted.begin(), decrypted.end() };
+    }
+
+    if ( entryPath.extension() == ".vtf" )
+    {
+        auto pTexFile = uc2::LzmaTexture::Create( entryData.data(),
+                                                  entryData.size_bytes() );
+        std::vector<uint8_t> vTexData( pTexFile->GetOriginalSize() );
+
+        if ( pTexFile->Decompress( vTexData.data(), vTexData.size() ) == false )
+        {
+            return {};
+        }
+
+        return vTexData;
+    }
+
+    return { entryData.begin(), entryData.end() };
+}
+
+//
+// Loads a written archive the way ArchiveTree and NodeExtractionMgr do,
+// with the provider detected from the packages, and checks every entry
+// extracts back to its source file
+//
+// The writer's own verification is turned off, so this doesn't rely on it
+//
+static void TestRoundTrip( GameProvider provider, std::string_view name )
+{
+    TestDirectory testDir( "pkgwriter-roundtrip-" + std::string( name ) );
+    const fs::path treeDir = testDir.GetPath() / "tree";
+    const fs::path outDir = testDir.GetPath() / "archive";
+
+    UC2_CHECK( WriteTreeFile( treeDir / "data" / "plain.txt",
+                              "some plain text" ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "data" / "secret.etxt",
+                              "some text encrypted on its own" ) == true );
+    UC2_CHECK( WriteTreeFile( treeDir / "materials" / "texture.vtf",
+                              std::string( 512, 'v' ) ) == true );
+
+    PkgLayout layout( provider, 64 );
+    UC2_CHECK( layout.AddDirectory( treeDir ) == true );
+
+    PkgWriter writer( layout, outDir );
+    writer.SetVerification( false );
+
+    if ( writer.Write() == false )
+    {
+        std::cerr << name << ": " << writer.GetError() << '\n';
+        UC2_CHECK( false );
+        return;
+    }
+
+    try
+    {
+        const fs::path indexPath = outDir / INDEX_FILENAME;
+        auto [bIndexRead, vIndexData] = ReadFileToBuffer( indexPath );
+        UC2_CHECK( bIndexRead == true );
+
+        DynamicIndexFileFactory indexFactory( indexPath, vIndexData );
+        uc2::PkgIndex::ptr_t pIndex = indexFactory.GetPkgIndexOwnership();
+        UC2_CHECK( DynamicIndexFileFactory::GetPkgFilenames( pIndex.get() ) ==
+                   layout.GetIndexPkgFilenames() );
+
+        std::size_t iCheckedEntries = 0;
+
+        for ( auto&& pkgFile : layout.GetPkgFiles() )
+        {
+            const fs::path pkgPath = outDir / pkgFile.szFilename;
+
+            DynamicPkgFileFactory pkgFactory( pkgPath );
+            uc2::PkgFile::ptr_t pPkgFile = pkgFactory.GetPkgFileOwnership();
+
+            auto [bPkgRead, vPkgData] = ReadFileToBuffer( pkgPath );
+            UC2_CHECK( bPkgRead == true );
+
+            pPkgFile->SetDataBuffer( vPkgData );
+            UC2_CHECK( pPkgFile->DecryptHeader() == true );
+            UC2_CHECK( pPkgFile->Parse() == true );
+
+            auto& vEntries = pPkgFile->GetEntries();
+            UC2_CHECK( vEntries.size() == pkgFile.vEntries.size() );
+
+            for ( std::size_t i = 0;
+                  i < vEntries.size() && i < pkgFile.vEntries.size(); i++ )
+            {
+                const PkgLayoutEntry& layoutEntry = pkgFile.vEntries[i];
+                UC2_CHECK( vEntries[i]->GetFilePath() ==
+                           layoutEntry.szEntryPath );
+
+                auto [bSourceRead, vSourceData] =
+                    ReadFileToBuffer( layoutEntry.sourcePath );
+                UC2_CHECK( bSourceRead == true );
+
+                auto entryData = PairToSpan( vEntries[i]->DecryptFile() );
+                UC2_CHECK( DecodeEntryData( layoutEntry.szEntryPath,
+                                            entryData ) == vSourceData );
+
+                iCheckedEntries++;
+            }
+        }
+
+        UC2_CHECK( iCheckedEntries == 3 );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << name << ": " << e.what() << '\n';
+        UC2_CHECK( false );
+    }
+}
+
+static void TestWriteFailure()
+{
+    TestDirectory testDir( "pkgwriter-fail" );
+    const fs::path treeDir = testDir.GetPath() / "tree";
+    // a file is in the way of the output directory
+    const fs::path outPath = testDir.GetPath() / "archive";
+
+    UC2_CHECK( WriteTreeFile( treeDir / "file.txt", "text" ) == true );
+    UC2_CHECK( WriteTreeFile( outPath, "not a directory" ) == true );
+
+    PkgLayout layout( GameProvider::Nexon );
+    UC2_CHECK( layout.AddDirectory( treeDir ) == true );
+
+    PkgWriter writer( layout, outPath );
+    UC2_CHECK( writer.Write() == false );
+    UC2_CHECK( writer.GetError().empty() == false );
+}
+
+int main()
+{
+    TestWriteProvider( GameProvider::Nexon, "nexon" );
+    TestWriteProvider( GameProvider::Tfo, "tfo" );
+    TestRoundTrip( GameProvider::Nexon, "nexon" );
+    TestRoundTrip( GameProvider::Tfo, "tfo" );
+    TestWriteFailure();
+
+    return GetTestResult();
+}
@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "residentpkgdata.hpp"
+#include "tests/testcheck.hpp"
+
+static PkgFileStamp GetTestStamp()
+{
+    PkgFileStamp stamp{};
+    stamp.iFileSize = 1234;
+    stamp.iModifiedTime = 5678;
+    stamp.baseHeaderMd5[0] = 0xAB;
+    return stamp;
+}
+
+static ResidentPkgData::data_t GetTestData( std::size_t iSize )
+{
+    return std::make_shared<const std::vector<std::uint8_t>>( iSize, 0x5A );
+}
+
+static void TestSameStampIsFound()
+{
+    ResidentPkgData residentData;
+    const auto pData = GetTestData( 16 );
+
+    residentData.Insert( 1, GetTestStamp(), pData );
+
+    UC2_CHECK( residentData.Find( 1, GetTestStamp() ) == pData );
+    UC2_CHECK( residentData.Find( 2, GetTestStamp() ) == nullptr );
+}
+
+static void TestChangedPkgFileIsDropped()
+{
+    ResidentPkgData residentData;
+    residentData.Insert( 1, GetTestStamp(), GetTestData( 16 ) );
+
+    // the package was patched since it was read
+    PkgFileStamp patchedStamp = GetTestStamp();
+    patchedStamp.iModifiedTime++;
+    UC2_CHECK( residentData.Find( 1, patchedStamp ) == nullptr );
+
+    // and its old data is gone for good
+    UC2_CHECK( residentData.Find( 1, GetTestStamp() ) == nullptr );
+}
+
+static void TestLeastRecentlyUsedIsEvicted()
+{
+    ResidentPkgData residentData( 32 );
+
+    residentData.Insert( 1, GetTestStamp(), GetTestData( 16 ) );
+    residentData.Insert( 2, GetTestStamp(), GetTestData( 16 ) );
+
+    // the first package is now the most recently used
+    UC2_CHECK( residentData.Find( 1, GetTestStamp() ) != nullptr );
+
+    residentData.Insert( 3, GetTestStamp(), GetTestData( 16 ) );
+
+    UC2_CHECK( residentData.Find( 1, GetTestStamp() ) != nullptr );
+    UC2_CHECK( residentData.Find( 2, GetTestStamp() ) == nullptr );
+    UC2_CHECK( residentData.Find( 3, GetTestStamp() ) != nullptr );
+}
+
+static void TestOversizedIsNotKept()
+{
+    ResidentPkgData residentData( 32 );
+
+    residentData.Insert( 1, GetTestStamp(), GetTestData( 16 ) );
+    residentData.Insert( 2, GetTestStamp(), GetTestData( 64 ) );
+
+    UC2_CHECK( residentData.Find( 1, GetTestStamp() ) != nullptr );
+    UC2_CHECK( residentData.Find( 2, GetTestStamp() ) == nullptr );
+}
+
+int main()
+{
+    TestSameStampIsFound();
+    TestChangedPkgFileIsDropped();
+    TestLeastRecentlyUsedIsEvicted();
+    TestOversizedIsNotKept();
+
+    return GetTestResult();
+}
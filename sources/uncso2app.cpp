@@ -3,10 +3,35 @@
 #include <QDebug>
 #include <QResource>
 
+#include <gsl/gsl>
+
+#include "corelog.hpp"
 #include "uc2_version.hpp"
 
+// the archive core's messages go with ours
+static void WriteCoreLogToQt( LogLevel level, std::string_view message )
+{
+    const QString convertedMessage = QString::fromUtf8(
+        message.data(), gsl::narrow_cast<int>( message.size() ) );
+
+    switch ( level )
+    {
+        case LogLevel::Warning:
+            qWarning().noquote() << convertedMessage;
+            break;
+        case LogLevel::Critical:
+            qCritical().noquote() << convertedMessage;
+            break;
+        default:
+            qDebug().noquote() << convertedMessage;
+            break;
+    }
+}
+
 CUnCSO2App::CUnCSO2App( int& argc, char** argv ) : QApplication( argc, argv )
 {
+    SetLogSink( &WriteCoreLogToQt );
+
     this->SetupSettingsInfo();
 
     if ( CUnCSO2App::ShouldLoadOwnIcons() == true )
@@ -0,0 +1,215 @@
+#include "widgets/extractionqueuewidget.hpp"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "extractionqueue.hpp"
+#include "extractionstats.hpp"
+#include "widgets/statuswidget.hpp"
+
+enum ExtractionQueueColumns
+{
+    EQC_NameColumn = 0,
+    EQC_StatusColumn,
+    EQC_ProgressColumn,
+    EQC_ColumnCount
+};
+
+// where an item's job id and whether it's done are kept
+constexpr const int JOB_ID_ROLE = Qt::UserRole;
+constexpr const int JOB_DONE_ROLE = Qt::UserRole + 1;
+
+ExtractionQueueWidget::ExtractionQueueWidget( ExtractionQueue& queue,
+                                              QWidget* pParent /*= nullptr*/ )
+    : QDockWidget( tr( "Extractions" ), pParent ), m_Queue( queue )
+{
+    this->setObjectName( QStringLiteral( "extractionQueueDock" ) );
+
+    auto pContents = new QWidget( this );
+    auto pLayout = new QVBoxLayout( pContents );
+
+    this->m_pJobList = new QTreeWidget( pContents );
+    this->m_pJobList->setColumnCount( EQC_ColumnCount );
+    this->m_pJobList->setHeaderLabels(
+        { tr( "Extraction" ), tr( "Status" ), tr( "Progress" ) } );
+    this->m_pJobList->setRootIsDecorated( false );
+    this->m_pJobList->header()->setSectionResizeMode(
+        EQC_NameColumn, QHeaderView::Stretch );
+    pLayout->addWidget( this->m_pJobList );
+
+    auto pButtonsLayout = new QHBoxLayout();
+    pButtonsLayout->addStretch();
+
+    this->m_pCancelButton = new QPushButton( tr( "Cancel" ), pContents );
+    this->m_pClearButton = new QPushButton( tr( "Clear finished" ), pContents );
+    pButtonsLayout->addWidget( this->m_pCancelButton );
+    pButtonsLayout->addWidget( this->m_pClearButton );
+    pLayout->addLayout( pButtonsLayout );
+
+    this->setWidget( pContents );
+
+    this->connect( &this->m_Queue, &ExtractionQueue::jobQueued, this,
+                   &ExtractionQueueWidget::OnJobQueued );
+    this->connect( &this->m_Queue, &ExtractionQueue::jobStarted, this,
+                   &ExtractionQueueWidget::OnJobStarted );
+    this->connect( &this->m_Queue, &ExtractionQueue::jobProgress, this,
+                   &ExtractionQueueWidget::OnJobProgress );
+    this->connect( &this->m_Queue, &ExtractionQueue::jobMaxProgress, this,
+                   &ExtractionQueueWidget::OnJobMaxProgress );
+    this->connect( &this->m_Queue, &ExtractionQueue::jobThroughput, this,
+                   &ExtractionQueueWidget::OnJobThroughput );
+    this->connect( &this->m_Queue, &ExtractionQueue::jobFinished, this,
+                   &ExtractionQueueWidget::OnJobFinished );
+
+    this->connect( this->m_pCancelButton, &QPushButton::clicked, this,
+                   &ExtractionQueueWidget::OnCancelClick );
+    this->connect( this->m_pClearButton, &QPushButton::clicked, this,
+                   &ExtractionQueueWidget::OnClearFinishedClick );
+}
+
+void ExtractionQueueWidget::OnJobQueued( int iJobId, const QString& szName,
+                                         int iFilesNum )
+{
+    auto pItem = new QTreeWidgetItem( this->m_pJobList );
+    pItem->setText( EQC_NameColumn, szName );
+    pItem->setText( EQC_StatusColumn, tr( "Queued" ) );
+    pItem->setData( EQC_NameColumn, JOB_ID_ROLE, iJobId );
+    pItem->setData( EQC_NameColumn, JOB_DONE_ROLE, false );
+
+    auto pProgressBar = new QProgressBar( this->m_pJobList );
+    pProgressBar->setRange( 0, iFilesNum );
+    pProgressBar->setValue( 0 );
+    this->m_pJobList->setItemWidget( pItem, EQC_ProgressColumn, pProgressBar );
+
+    this->show();
+}
+
+void ExtractionQueueWidget::OnJobStarted( int iJobId )
+{
+    QTreeWidgetItem* pItem = this->FindJobItem( iJobId );
+
+    if ( pItem != nullptr )
+    {
+        pItem->setText( EQC_StatusColumn, tr( "Extracting" ) );
+    }
+}
+
+void ExtractionQueueWidget::OnJobProgress( int iJobId, int iProgress )
+{
+    QTreeWidgetItem* pItem = this->FindJobItem( iJobId );
+
+    if ( pItem != nullptr )
+    {
+        this->GetJobProgressBar( pItem )->setValue( iProgress );
+    }
+}
+
+void ExtractionQueueWidget::OnJobMaxProgress( int iJobId, int iMaxProgress )
+{
+    QTreeWidgetItem* pItem = this->FindJobItem( iJobId );
+
+    if ( pItem != nullptr )
+    {
+        this->GetJobProgressBar( pItem )->setMaximum( iMaxProgress );
+    }
+}
+
+void ExtractionQueueWidget::OnJobThroughput( int iJobId,
+                                             const ThroughputSample& sample )
+{
+    QTreeWidgetItem* pItem = this->FindJobItem( iJobId );
+
+    if ( pItem != nullptr &&
+         pItem->data( EQC_NameColumn, JOB_DONE_ROLE ).toBool() == false )
+    {
+        pItem->setText( EQC_StatusColumn,
+                        tr( "Extracting, %1" )
+                            .arg( StatusWidget::FormatThroughput( sample ) ) );
+    }
+}
+
+void ExtractionQueueWidget::OnJobFinished( int iJobId, bool bSucceeded,
+                                           bool bCancelled,
+                                           const QString& szError )
+{
+    QTreeWidgetItem* pItem = this->FindJobItem( iJobId );
+
+    if ( pItem == nullptr )
+    {
+        return;
+    }
+
+    QString szStatus;
+
+    if ( bCancelled == true )
+    {
+        szStatus = tr( "Cancelled" );
+    }
+    else if ( bSucceeded == true )
+    {
+        szStatus = tr( "Done" );
+
+        QProgressBar* pProgressBar = this->GetJobProgressBar( pItem );
+        pProgressBar->setValue( pProgressBar->maximum() );
+    }
+    else
+    {
+        szStatus = tr( "Failed" );
+        pItem->setToolTip( EQC_StatusColumn, szError );
+    }
+
+    pItem->setText( EQC_StatusColumn, szStatus );
+    pItem->setData( EQC_NameColumn, JOB_DONE_ROLE, true );
+}
+
+void ExtractionQueueWidget::OnCancelClick()
+{
+    for ( auto&& pItem : this->m_pJobList->selectedItems() )
+    {
+        if ( pItem->data( EQC_NameColumn, JOB_DONE_ROLE ).toBool() == false )
+        {
+            pItem->setText( EQC_StatusColumn, tr( "Cancelling" ) );
+            this->m_Queue.Cancel(
+                pItem->data( EQC_NameColumn, JOB_ID_ROLE ).toInt() );
+        }
+    }
+}
+
+void ExtractionQueueWidget::OnClearFinishedClick()
+{
+    for ( int i = this->m_pJobList->topLevelItemCount() - 1; i >= 0; i-- )
+    {
+        QTreeWidgetItem* pItem = this->m_pJobList->topLevelItem( i );
+
+        if ( pItem->data( EQC_NameColumn, JOB_DONE_ROLE ).toBool() == true )
+        {
+            delete this->m_pJobList->takeTopLevelItem( i );
+        }
+    }
+}
+
+QTreeWidgetItem* ExtractionQueueWidget::FindJobItem( int iJobId ) const
+{
+    for ( int i = 0; i < this->m_pJobList->topLevelItemCount(); i++ )
+    {
+        QTreeWidgetItem* pItem = this->m_pJobList->topLevelItem( i );
+
+        if ( pItem->data( EQC_NameColumn, JOB_ID_ROLE ).toInt() == iJobId )
+        {
+            return pItem;
+        }
+    }
+
+    return nullptr;
+}
+
+QProgressBar* ExtractionQueueWidget::GetJobProgressBar(
+    QTreeWidgetItem* pItem ) const
+{
+    return static_cast<QProgressBar*>(
+        this->m_pJobList->itemWidget( pItem, EQC_ProgressColumn ) );
+}
@@ -2,10 +2,17 @@
 
 #include <QLabel>
 #include <QProgressBar>
+#include <QLocale>
+#include <QPushButton>
+
+#include "extractionstats.hpp"
 
 StatusWidget::StatusWidget( gsl::not_null<QLabel*> pLabel,
-                            gsl::not_null<QProgressBar*> pProgressBar )
-    : m_pLabel( pLabel ), m_pProgressBar( pProgressBar )
+                            gsl::not_null<QLabel*> pThroughputLabel,
+                            gsl::not_null<QProgressBar*> pProgressBar,
+                            gsl::not_null<QPushButton*> pCancelButton )
+    : m_pLabel( pLabel ), m_pThroughputLabel( pThroughputLabel ),
+      m_pProgressBar( pProgressBar ), m_pCancelButton( pCancelButton )
 {
 }
 
@@ -25,8 +32,55 @@ void StatusWidget::SetProgressNum( int iNewProgress )
     this->m_pProgressBar->setValue( iNewProgress );
 }
 
+void StatusWidget::SetThroughput( const ThroughputSample& sample )
+{
+    this->m_pThroughputLabel->setText(
+        StatusWidget::FormatThroughput( sample ) );
+    this->m_pThroughputLabel->setVisible( true );
+}
+
+void StatusWidget::SetCancelable( bool bCancelable )
+{
+    this->m_pCancelButton->setEnabled( bCancelable );
+    this->m_pCancelButton->setVisible( bCancelable );
+}
+
 void StatusWidget::SetVisible( bool bVisible )
 {
     this->m_pLabel->setVisible( bVisible );
     this->m_pProgressBar->setVisible( bVisible );
-}
\ No newline at end of file
+
+    // only shown once a job sends its throughput
+    this->m_pThroughputLabel->clear();
+    this->m_pThroughputLabel->setVisible( false );
+
+    if ( bVisible == false )
+    {
+        this->m_pCancelButton->setVisible( false );
+    }
+}
+
+QString StatusWidget::FormatThroughput( const ThroughputSample& sample )
+{
+    const QLocale locale;
+
+    QString szResult =
+        tr( "%1/s read, %2/s written, %3 files/s" )
+            .arg( locale.formattedDataSize(
+                static_cast<qint64>( sample.fReadBytesPerSec ) ) )
+            .arg( locale.formattedDataSize(
+                static_cast<qint64>( sample.fWrittenBytesPerSec ) ) )
+            .arg( sample.fFilesPerSec, 0, 'f', 0 );
+
+    if ( sample.fSecondsLeft >= 0.0 )
+    {
+        const qint64 iSecondsLeft = static_cast<qint64>( sample.fSecondsLeft );
+
+        szResult += tr( ", %1:%2:%3 left" )
+                        .arg( iSecondsLeft / 3600 )
+                        .arg( iSecondsLeft / 60 % 60, 2, 10, QChar( '0' ) )
+                        .arg( iSecondsLeft % 60, 2, 10, QChar( '0' ) );
+    }
+
+    return szResult;
+}
@@ -0,0 +1,205 @@
+#include "workerpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+static std::atomic<std::size_t> s_iSharedThreadsNum = 0;
+
+WorkerPool::WorkerPool( std::size_t iThreadsNum )
+    : m_iThreadsNum( std::max<std::size_t>( iThreadsNum, 1 ) ),
+      m_iBackgroundWorkers( 0 ), m_bStopping( false )
+{
+    for ( std::size_t i = 0; i < this->m_iThreadsNum; i++ )
+    {
+        this->m_vThreads.emplace_back( &WorkerPool::WorkerLoop, this );
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( this->m_Lock );
+        this->m_bStopping = true;
+    }
+
+    this->m_WorkCond.notify_all();
+
+    for ( auto&& thread : this->m_vThreads )
+    {
+        thread.join();
+    }
+}
+
+WorkerPool& WorkerPool::GetShared()
+{
+    static WorkerPool sharedPool( [] {
+        const std::size_t iRequestedThreads = s_iSharedThreadsNum;
+
+        if ( iRequestedThreads != 0 )
+        {
+            return iRequestedThreads;
+        }
+
+        return std::max<std::size_t>( std::thread::hardware_concurrency(),
+                                      1 );
+    }() );
+
+    return sharedPool;
+}
+
+void WorkerPool::SetSharedThreadsNum( std::size_t iThreadsNum ) noexcept
+{
+    s_iSharedThreadsNum = iThreadsNum;
+}
+
+void WorkerPool::RunConcurrently( std::size_t iCopiesNum, WorkPriority priority,
+                                  const std::function<void()>& job )
+{
+    if ( iCopiesNum == 0 )
+    {
+        return;
+    }
+
+    // the calling thread's own copy isn't counted
+    JobGroup group{ job, priority, iCopiesNum - 1, iCopiesNum - 1, nullptr };
+
+    if ( group.iUnstartedCopies != 0 )
+    {
+        {
+            std::lock_guard<std::mutex> lock( this->m_Lock );
+            this->m_Lanes[static_cast<std::size_t>( priority )].push_back(
+                &group );
+        }
+
+        this->m_WorkCond.notify_all();
+    }
+
+    this->RunCopy( group );
+
+    std::unique_lock<std::mutex> lock( this->m_Lock );
+
+    while ( group.iUnfinishedCopies != 0 )
+    {
+        if ( group.iUnstartedCopies != 0 )
+        {
+            if ( --group.iUnstartedCopies == 0 )
+            {
+                this->RemoveGroup( &group );
+            }
+
+            lock.unlock();
+            this->RunCopy( group );
+            lock.lock();
+
+            group.iUnfinishedCopies--;
+            continue;
+        }
+
+        this->m_WorkCond.wait( lock );
+    }
+
+    lock.unlock();
+
+    if ( group.pFirstError != nullptr )
+    {
+        std::rethrow_exception( group.pFirstError );
+    }
+}
+
+void WorkerPool::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock( this->m_Lock );
+
+    while ( this->m_bStopping == false )
+    {
+        JobGroup* pGroup = this->TakeNextCopy();
+
+        if ( pGroup == nullptr )
+        {
+            this->m_WorkCond.wait( lock );
+            continue;
+        }
+
+        const bool bBackground = pGroup->priority == WorkPriority::Background;
+
+        if ( bBackground == true )
+        {
+            this->m_iBackgroundWorkers++;
+        }
+
+        lock.unlock();
+        this->RunCopy( *pGroup );
+        lock.lock();
+
+        if ( bBackground == true )
+        {
+            this->m_iBackgroundWorkers--;
+        }
+
+        // the group may be gone as soon as its last copy is finished
+        const bool bGroupFinished = --pGroup->iUnfinishedCopies == 0;
+
+        if ( bGroupFinished == true || bBackground == true )
+        {
+            this->m_WorkCond.notify_all();
+        }
+    }
+}
+
+WorkerPool::JobGroup* WorkerPool::TakeNextCopy()
+{
+    for ( std::size_t i = 0; i < this->m_Lanes.size(); i++ )
+    {
+        auto& lane = this->m_Lanes[i];
+
+        if ( lane.empty() == true )
+        {
+            continue;
+        }
+
+        if ( static_cast<WorkPriority>( i ) == WorkPriority::Background &&
+             this->m_iBackgroundWorkers >= this->GetMaxBackgroundWorkers() )
+        {
+            continue;
+        }
+
+        JobGroup* pGroup = lane.front();
+
+        if ( --pGroup->iUnstartedCopies == 0 )
+        {
+            lane.pop_front();
+        }
+
+        return pGroup;
+    }
+
+    return nullptr;
+}
+
+void WorkerPool::RemoveGroup( JobGroup* pGroup )
+{
+    auto& lane = this->m_Lanes[static_cast<std::size_t>( pGroup->priority )];
+    lane.erase( std::remove( lane.begin(), lane.end(), pGroup ), lane.end() );
+}
+
+void WorkerPool::RunCopy( JobGroup& group ) noexcept
+{
+    try
+    {
+        group.job();
+    }
+    catch ( ... )
+    {
+        std::lock_guard<std::mutex> lock( this->m_Lock );
+
+        if ( group.pFirstError == nullptr )
+        {
+            group.pFirstError = std::current_exception();
+        }
+    }
+}
+
+std::size_t WorkerPool::GetMaxBackgroundWorkers() const noexcept
+{
+    return std::max<std::size_t>( this->m_iThreadsNum - 1, 1 );
+}